@@ -0,0 +1,313 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "actual_epmd_server.h"
+#include "tinch_pp/exceptions.h"
+#include "utils.h"
+#include <boost/bind.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/locks.hpp>
+
+using namespace tinch_pp;
+using namespace boost;
+namespace asio = boost::asio;
+using boost::asio::ip::tcp;
+
+namespace tinch_pp {
+
+// Serves the request on one connection.
+class epmd_session : public enable_shared_from_this<epmd_session>
+{
+public:
+  epmd_session(asio::io_service& io_service, actual_epmd_server& a_server)
+    : connection(io_service),
+      server(a_server)
+  {
+  }
+
+  tcp::socket& socket()
+  {
+    return connection;
+  }
+
+  void start()
+  {
+    asio::async_read(connection, asio::buffer(header), 
+                     bind(&epmd_session::header_read, shared_from_this(), asio::placeholders::error));
+  }
+
+private:
+  void header_read(const system::error_code& error)
+  {
+    if(error)
+      return;
+
+    const size_t request_length = (header[0] << 8) | header[1];
+
+    if(request_length == 0)
+      return;
+
+    request.resize(request_length);
+
+    asio::async_read(connection, asio::buffer(request), 
+                     bind(&epmd_session::request_read, shared_from_this(), asio::placeholders::error));
+  }
+
+  void request_read(const system::error_code& error)
+  {
+    if(error)
+      return;
+
+    const int alive2_req = 120;
+    const int port_please2_req = 122;
+    const int names_req = 110;
+
+    // Malformed requests are ignored; the connection is closed as the session goes away.
+    try {
+      switch(static_cast<unsigned char>(request[0])) {
+      case alive2_req:
+        register_node();
+        break;
+      case port_please2_req:
+        port_please();
+        break;
+      case names_req:
+        names();
+        break;
+      }
+    } catch(const tinch_pp_exception&) {
+    }
+  }
+
+  void register_node()
+  {
+    epmd::node_registration node;
+    epmd::alive2_req_parser alive2_req_p;
+
+    utils::parse(request, alive2_req_p, node);
+
+    const optional<creation_number_type> creation = server.register_node(node);
+
+    epmd::alive2_resp_result result = {creation ? 0 : 1, static_cast<uint16_t>(creation ? *creation : 0)};
+    epmd::alive2_resp_generator alive2_resp_g;
+    utils::generate(response, alive2_resp_g, result);
+
+    if(!creation) {
+      reply_and_close();
+      return;
+    }
+
+    registered_name = node.node_name;
+    asio::async_write(connection, asio::buffer(response), 
+                      bind(&epmd_session::registered, shared_from_this(), asio::placeholders::error));
+  }
+
+  // The node stays registered until it closes the connection.
+  void registered(const system::error_code& error)
+  {
+    if(error) {
+      server.unregister_node(registered_name);
+      return;
+    }
+
+    asio::async_read(connection, asio::buffer(header, 1), 
+                     bind(&epmd_session::node_gone, shared_from_this(), asio::placeholders::error));
+  }
+
+  void node_gone(const system::error_code& error)
+  {
+    server.unregister_node(registered_name);
+  }
+
+  void port_please()
+  {
+    std::string node_name;
+    epmd::port_please2_req_parser port_please2_req_p;
+
+    utils::parse(request, port_please2_req_p, node_name);
+
+    const optional<epmd::node_registration> node = server.registration_of(node_name);
+
+    if(node) {
+      epmd::port2_resp_generator port2_resp_g;
+      utils::generate(response, port2_resp_g, *node);
+    } else {
+      const char port2_resp = 119;
+      const char failure = 1;
+      response.push_back(port2_resp);
+      response.push_back(failure);
+    }
+
+    reply_and_close();
+  }
+
+  void names()
+  {
+    epmd::names_resp_generator names_resp_g;
+
+    utils::generate(response, karma::big_dword, static_cast<uint32_t>(server.port()));
+    utils::generate(response, names_resp_g, server.names());
+
+    reply_and_close();
+  }
+
+  void reply_and_close()
+  {
+    // The session keeps itself alive until the response is written.
+    asio::async_write(connection, asio::buffer(response), 
+                      bind(&epmd_session::replied, shared_from_this(), asio::placeholders::error));
+  }
+
+  void replied(const system::error_code& error)
+  {
+    system::error_code ignored;
+    connection.shutdown(tcp::socket::shutdown_both, ignored);
+  }
+
+  tcp::socket connection;
+  actual_epmd_server& server;
+
+  unsigned char header[2];
+  msg_seq request;
+  msg_seq response;
+
+  std::string registered_name;
+};
+
+}
+
+actual_epmd_server::actual_epmd_server(port_number_type port)
+  : acceptor(io_service),
+    last_creation(0)
+{
+  const tcp::endpoint endpoint(tcp::v4(), port);
+  system::error_code error;
+
+  acceptor.open(endpoint.protocol(), error);
+
+  if(!error)
+    acceptor.set_option(tcp::acceptor::reuse_address(true), error);
+
+  if(!error)
+    acceptor.bind(endpoint, error);
+
+  if(!error)
+    acceptor.listen(asio::socket_base::max_connections, error);
+
+  if(error)
+    throw tinch_pp_exception("Failed to start the name server at port = " + 
+                             lexical_cast<std::string>(port) + " (" + error.message() + ")");
+
+  trigger_accept();
+
+  async_io_runner = thread(bind(&actual_epmd_server::run_async_io, this));
+}
+
+actual_epmd_server::~actual_epmd_server()
+{
+  io_service.stop();
+  async_io_runner.join();
+}
+
+port_number_type actual_epmd_server::port() const
+{
+  return acceptor.local_endpoint().port();
+}
+
+std::vector<epmd_server::registered_node_type> actual_epmd_server::registered_nodes() const
+{
+  lock_guard<mutex> lock(registrations_mutex);
+
+  std::vector<registered_node_type> nodes;
+
+  for(registrations_type::const_iterator i = registrations.begin(); i != registrations.end(); ++i)
+    nodes.push_back(registered_node_type(i->first, i->second.port));
+
+  return nodes;
+}
+
+optional<creation_number_type> actual_epmd_server::register_node(const epmd::node_registration& node)
+{
+  lock_guard<mutex> lock(registrations_mutex);
+
+  if(!registrations.insert(registrations_type::value_type(node.node_name, node)).second)
+    return optional<creation_number_type>();
+
+  last_creation = (last_creation % 3) + 1;
+
+  return last_creation;
+}
+
+void actual_epmd_server::unregister_node(const std::string& node_name)
+{
+  lock_guard<mutex> lock(registrations_mutex);
+
+  registrations.erase(node_name);
+}
+
+optional<epmd::node_registration> actual_epmd_server::registration_of(const std::string& node_name) const
+{
+  lock_guard<mutex> lock(registrations_mutex);
+
+  registrations_type::const_iterator registered = registrations.find(node_name);
+
+  if(registered == registrations.end())
+    return optional<epmd::node_registration>();
+
+  return registered->second;
+}
+
+epmd::names_type actual_epmd_server::names() const
+{
+  lock_guard<mutex> lock(registrations_mutex);
+
+  epmd::names_type registered;
+
+  for(registrations_type::const_iterator i = registrations.begin(); i != registrations.end(); ++i)
+    registered.push_back(epmd::names_type::value_type(i->first, i->second.port));
+
+  return registered;
+}
+
+void actual_epmd_server::trigger_accept()
+{
+  const shared_ptr<epmd_session> session(new epmd_session(io_service, *this));
+
+  acceptor.async_accept(session->socket(), 
+                        bind(&actual_epmd_server::handle_accept, this, session, asio::placeholders::error));
+}
+
+void actual_epmd_server::handle_accept(shared_ptr<epmd_session> session, const system::error_code& error)
+{
+  if(error == asio::error::operation_aborted)
+    return;
+
+  if(!error)
+    session->start();
+
+  trigger_accept();
+}
+
+void actual_epmd_server::run_async_io()
+{
+  io_service.run();
+}
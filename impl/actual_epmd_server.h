@@ -0,0 +1,96 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef ACTUAL_EPMD_SERVER_H
+#define ACTUAL_EPMD_SERVER_H
+
+#include "tinch_pp/epmd_server.h"
+#include "impl/epmd_protocol.h"
+
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+#include <boost/utility.hpp>
+#include <boost/optional.hpp>
+#include <string>
+#include <map>
+
+namespace tinch_pp {
+
+class epmd_session;
+
+/// Implements the name server on top of asynchronous TCP/IP.
+/// Each request arrives on a connection of its own. A node stays registered as 
+/// long as it keeps the connection of its ALIVE2_REQ; the other requests are 
+/// one-shot (see epmd_protocol.h).
+///
+/// Threading:
+/// A separate thread serves all connections. The registered nodes are protected 
+/// by a mutex, since they may be inspected from other threads.
+class actual_epmd_server : public epmd_server,
+                           boost::noncopyable
+{
+public:
+  explicit actual_epmd_server(port_number_type port);
+
+  ~actual_epmd_server();
+
+  // Implementation of the epmd_server interface:
+  //
+  virtual port_number_type port() const;
+
+  virtual std::vector<registered_node_type> registered_nodes() const;
+
+  // Used by the connections serving the requests:
+  //
+
+  // Returns the creation of the node, or an empty optional in case the name is taken.
+  boost::optional<creation_number_type> register_node(const epmd::node_registration& node);
+
+  void unregister_node(const std::string& node_name);
+
+  boost::optional<epmd::node_registration> registration_of(const std::string& node_name) const;
+
+  epmd::names_type names() const;
+
+private:
+  void trigger_accept();
+
+  void handle_accept(boost::shared_ptr<epmd_session> session, const boost::system::error_code& error);
+
+  void run_async_io();
+
+  boost::asio::io_service io_service;
+  boost::asio::ip::tcp::acceptor acceptor;
+
+  typedef std::map<std::string /* node name */, epmd::node_registration> registrations_type;
+  registrations_type registrations;
+
+  // As EPMD, we cycle through the creations 1..3; a restarted node gets a new one.
+  creation_number_type last_creation;
+
+  mutable boost::mutex registrations_mutex;
+
+  boost::thread async_io_runner;
+};
+
+}
+
+#endif
@@ -92,6 +92,11 @@ void actual_mailbox::unlink(const e_pid& e_pido_unlink)
   node.unlink(self(), e_pido_unlink);
 }
 
+void actual_mailbox::monitor_nodes(bool on)
+{
+  node.monitor_nodes(self(), on);
+}
+
 tinch_pp::e_pid actual_mailbox::self() const
 {
   return own_pid;
@@ -151,7 +156,7 @@ void actual_mailbox::wait_for_at_least_one_message(unique_lock<mutex>& lock)
     message_received_cond.wait(lock);
 }
 
-msg_seq actual_mailbox::pick_first_msg()
+received_msg actual_mailbox::pick_first_msg()
 {
   message_ready = false;
 
@@ -161,16 +166,16 @@ msg_seq actual_mailbox::pick_first_msg()
   if(received_msgs.empty())
     throw mailbox_receive_tmo();
 
-  const msg_seq msg(received_msgs.front());
+  const received_msg msg(received_msgs.front());
 
   received_msgs.pop_front();
 
   return msg;
 }
 
-void actual_mailbox::on_incoming(const msg_seq& msg)
+void actual_mailbox::on_incoming(const received_msg& msg)
 {
-  notify_receive(bind(&received_msgs_type::push_front, ref(received_msgs), cref(msg)));
+  notify_receive(bind(&received_msgs_type::push_back, ref(received_msgs), cref(msg)));
 }
 
 void actual_mailbox::on_link_broken(const std::string& reason, const e_pid& pid)
@@ -220,6 +225,7 @@ namespace {
 msg_seq serialized(const erl::object& message)
 {
   msg_seq s;
+  s.reserve(message.encoded_size());
   msg_seq_out_iter out(s);
 
   message.serialize(out);
@@ -23,6 +23,7 @@
 #define ACTUAL_MAILBOX_H
 
 #include "tinch_pp/mailbox.h"
+#include "received_msg.h"
 #include <boost/thread.hpp>
 #include <boost/asio.hpp>
 #include <boost/system/error_code.hpp>
@@ -72,9 +73,11 @@ public:
 
   virtual void unlink(const e_pid& e_pido_unlink);
 
+  virtual void monitor_nodes(bool on);
+
   // The public interface for the implementation (i.e. the owning node):
   //
-  void on_incoming(const msg_seq& msg);
+  void on_incoming(const received_msg& msg);
 
   // Invoked as a linked (remote) process exits.
   void on_link_broken(const std::string& reason, const e_pid& pid);
@@ -86,7 +89,7 @@ private:
 
   void wait_for_at_least_one_message(boost::unique_lock<boost::mutex>& lock);
 
-  msg_seq pick_first_msg();
+  received_msg pick_first_msg();
 
   void receive_tmo(const boost::system::error_code& error);
 
@@ -98,7 +101,7 @@ private:
   boost::asio::io_service& service;
   std::string own_name;
 
-  typedef std::list<msg_seq> received_msgs_type;
+  typedef std::list<received_msg> received_msgs_type;
   received_msgs_type received_msgs;
 
   // The client typically blocks in a receive until a message arrives.
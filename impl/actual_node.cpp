@@ -24,12 +24,16 @@
 #include "actual_mailbox.h"
 #include "link_policies.h"
 #include "tinch_pp/exceptions.h"
+#include "tinch_pp/erlang_types.h"
 #include "control_msg_send.h"
 #include "control_msg_reg_send.h"
+#include "term_compression.h"
 #include "ScopeGuard.h"
 #include <boost/bind.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 #include <iostream>
+#include <algorithm>
 #include <cassert>
 
 using namespace tinch_pp;
@@ -82,6 +86,64 @@ shared_ptr<actual_mailbox> fetch_mailbox(const Key& name,
   return destination;
 }
 
+// Collects the outcomes of the parallel connection attempts in node::preconnect.
+class preconnect_progress
+{
+public:
+  explicit preconnect_progress(const std::vector<std::string>& nodes)
+    : started(now()),
+      results(nodes.size()),
+      remaining(nodes.size())
+  {
+    for(size_t i = 0; i < nodes.size(); ++i)
+      results[i].node_name = nodes[i];
+  }
+
+  // Invoked in the I/O context (or at once, for an already connected node).
+  void attempt_done(size_t index, bool connected)
+  {
+    {
+      const mutex_guard guard(progress_lock);
+
+      results[index].connected = connected;
+      results[index].elapsed_ms = static_cast<boost::uint32_t>((now() - started).total_milliseconds());
+      --remaining;
+    }
+    all_done_cond.notify_one();
+  }
+
+  preconnect_results_type wait()
+  {
+    boost::unique_lock<boost::mutex> lock(progress_lock);
+
+    while(remaining != 0)
+      all_done_cond.wait(lock);
+
+    return results;
+  }
+
+private:
+  static posix_time::ptime now() { return posix_time::microsec_clock::universal_time(); }
+
+  const posix_time::ptime started;
+  preconnect_results_type results;
+  size_t remaining;
+
+  boost::mutex progress_lock;
+  boost::condition_variable all_done_cond;
+};
+
+// {nodeup, Node} or {nodedown, Node}, serialized as a local send would.
+msg_seq node_event(const std::string& event, const std::string& peer_node)
+{
+  msg_seq s;
+  msg_seq_out_iter out(s);
+
+  tinch_pp::erl::make_e_tuple(tinch_pp::erl::atom(event), tinch_pp::erl::atom(peer_node)).serialize(out);
+
+  return s;
+}
+
 }
 
 namespace tinch_pp {
@@ -90,15 +152,18 @@ namespace tinch_pp {
 
 }
 
-actual_node::actual_node(const std::string& a_node_name, const std::string& a_cookie)
+actual_node::actual_node(const std::string& a_node_name, const std::string& a_cookie, port_number_type epmd_port)
   : work(io_service),
-    epmd(io_service, "127.0.0.1", 4369),
+    epmd(io_service, "127.0.0.1", epmd_port),
     node_name_(valid_node_name(a_node_name)),
     cookie_(a_cookie),
-    connector(*this, io_service),
+    connector(*this, io_service, epmd_port),
+    reconnector(io_service, bind(&node_connector::connect_in_background, &connector, _1, _2)),
     async_io_runner(&actual_node::run_async_io, this),
     // variabled used to build pids:
     pid_id(1), serial(0), creation(0),
+    compression_threshold(0),
+    pending_bytes_limit(16 * 1024 * 1024),
     mailbox_linker(*this),
     remote_link_dispatcher(make_remote_link_dispatcher(*this, mailbox_linker, bind(&actual_node::request, this, _1, _2))),
     local_link_dispatcher(make_local_link_dispatcher(*this))
@@ -185,6 +250,8 @@ void actual_node::close_mailbox(const e_pid& id, const std::string& name, const
   // action might result in a call to self => ensure the mutex isn't locked.
   mailbox_linker.close_links_for_local(id, reason);
 
+  monitor_nodes(id, false);
+
   {
     const mutex_guard guard(mailboxes_lock);
 
@@ -207,6 +274,72 @@ std::vector<std::string> actual_node::connected_nodes() const
   return connector.connected_nodes();
 }
 
+void actual_node::set_compression_threshold(size_t payload_size)
+{
+  const mutex_guard guard(compression_lock);
+
+  compression_threshold = payload_size;
+}
+
+void actual_node::set_max_pending_bytes(size_t bytes)
+{
+  const mutex_guard guard(pending_bytes_lock);
+
+  pending_bytes_limit = bytes;
+}
+
+void actual_node::set_reconnect_backoff(boost::uint32_t initial_delay_ms, boost::uint32_t max_delay_ms)
+{
+  reconnector.set_backoff(initial_delay_ms, max_delay_ms);
+}
+
+preconnect_results_type actual_node::preconnect(const std::vector<std::string>& nodes, bool keep_retrying)
+{
+  const shared_ptr<preconnect_progress> progress(new preconnect_progress(nodes));
+
+  // The node_connector runs all attempts in parallel, in the I/O context.
+  for(size_t i = 0; i < nodes.size(); ++i) {
+    try {
+      connector.connect_in_background(nodes[i], bind(&preconnect_progress::attempt_done, progress, i, ::_1));
+    } catch(const tinch_pp_exception&) {
+      progress->attempt_done(i, false);
+    }
+  }
+
+  const preconnect_results_type results = progress->wait();
+
+  if(keep_retrying) {
+    for(preconnect_results_type::const_iterator i = results.begin(); i != results.end(); ++i) {
+      if(!i->connected)
+        reconnector.connection_lost(i->node_name);
+    }
+  }
+
+  return results;
+}
+
+size_t actual_node::max_pending_bytes() const
+{
+  const mutex_guard guard(pending_bytes_lock);
+
+  return pending_bytes_limit;
+}
+
+msg_seq actual_node::outgoing_payload(const msg_seq& msg)
+{
+  size_t threshold = 0;
+  {
+    const mutex_guard guard(compression_lock);
+    threshold = compression_threshold;
+  }
+
+  msg_seq compressed;
+  const bool compress = (threshold != 0) && (msg.size() > threshold);
+
+  // Some terms (e.g. binaries of random data) don't compress => send them as they are.
+  return (compress && deflate_term(msg, compressed)) ? compressed : msg;
+}
+
 void actual_node::remove(mailbox_ptr mailbox)
 {
   remove(mailbox->self(), mailbox->name());
@@ -221,40 +354,45 @@ void actual_node::remove(const e_pid& id, const std::string& name)
 
 void actual_node::deliver(const msg_seq& msg, const e_pid& to_pid)
 {
-  node_connection_ptr connection = connector.get_connection_to(to_pid.node_name);
-  control_msg_send send_msg(msg, to_pid);
+  node_connection_ptr connection = connector.queueing_connection_to(to_pid.node_name);
+  control_msg_send send_msg(outgoing_payload(msg), to_pid);
 
   connection->request(send_msg);
 }
 
 void actual_node::deliver(const msg_seq& msg, const std::string& to_name)
 {
-  this->receive_incoming(msg, to_name);
+  this->receive_incoming(received_msg(msg), to_name);
 }
 
 void actual_node::deliver(const msg_seq& msg, const std::string& to_name, 
 		                 const std::string& given_node, const e_pid& from_pid)
 {
   
-  node_connection_ptr connection = connector.get_connection_to(given_node);
-  control_msg_reg_send reg_send_msg(msg, to_name, from_pid);
+  node_connection_ptr connection = connector.queueing_connection_to(given_node);
+  control_msg_reg_send reg_send_msg(outgoing_payload(msg), to_name, from_pid);
 
   connection->request(reg_send_msg);
 }
 
-void actual_node::receive_incoming(const msg_seq& msg, const e_pid& to)
+void actual_node::receive_incoming(const received_msg& msg, const e_pid& to)
 {
+  // Declared before the guard: if the mailbox got closed meanwhile, we hold the last
+  // reference and its destructor takes the mailboxes lock.
+  shared_ptr<actual_mailbox> destination;
   const mutex_guard guard(mailboxes_lock);
 
-  shared_ptr<actual_mailbox> destination = fetch_mailbox(to, mailboxes);
+  destination = fetch_mailbox(to, mailboxes);
   destination->on_incoming(msg);
 }
 
-void actual_node::receive_incoming(const msg_seq& msg, const std::string& to)
+void actual_node::receive_incoming(const received_msg& msg, const std::string& to)
 {
+  // Declared before the guard, see above.
+  shared_ptr<actual_mailbox> destination;
   const mutex_guard guard(mailboxes_lock);
 
-  shared_ptr<actual_mailbox> destination = fetch_mailbox(to, registered_mailboxes);
+  destination = fetch_mailbox(to, registered_mailboxes);
   destination->on_incoming(msg);
 }
 
@@ -270,9 +408,11 @@ void actual_node::incoming_unlink(const e_pid& from, const e_pid& to)
 
 void actual_node::incoming_exit(const e_pid& from, const e_pid& to, const std::string& reason)
 {
+  // Declared before the guard, see receive_incoming.
+  shared_ptr<actual_mailbox> linked_mailbox;
   const mutex_guard guard(mailboxes_lock);
 
-  shared_ptr<actual_mailbox> linked_mailbox = fetch_mailbox(to, mailboxes);
+  linked_mailbox = fetch_mailbox(to, mailboxes);
 
   linked_mailbox->on_link_broken(reason, from);
 
@@ -286,9 +426,79 @@ void actual_node::incoming_exit2(const e_pid& from, const e_pid& to, const std::
   incoming_exit(from, to, reason);
 }
 
+void actual_node::node_up(const std::string& peer_node)
+{
+  reconnector.connection_established(peer_node);
+
+  notify_node_monitors("nodeup", peer_node);
+}
+
+void actual_node::node_unreachable(const std::string& peer_node)
+{
+  break_links_to(peer_node);
+}
+
+void actual_node::node_down(const std::string& peer_node)
+{
+  break_links_to(peer_node);
+
+  notify_node_monitors("nodedown", peer_node);
+
+  reconnector.connection_lost(peer_node);
+}
+
+void actual_node::break_links_to(const std::string& peer_node)
+{
+  const linker::links_type broken_links = mailbox_linker.remove_links_to_node(peer_node);
+
+  for(linker::links_type::const_iterator i = broken_links.begin(); i != broken_links.end(); ++i) {
+    // Declared before the guard, see receive_incoming.
+    shared_ptr<actual_mailbox> linked_mailbox;
+    const mutex_guard guard(mailboxes_lock);
+
+    try {
+      linked_mailbox = fetch_mailbox(i->first, mailboxes);
+      linked_mailbox->on_link_broken("noconnection", i->second);
+    } catch(const tinch_pp_exception&) {
+      // The mailbox is closing => nobody to tell.
+    }
+  }
+}
+
+void actual_node::monitor_nodes(const e_pid& subscriber, bool on)
+{
+  const mutex_guard guard(node_monitors_lock);
+
+  node_monitors.remove(subscriber);
+
+  if(on)
+    node_monitors.push_back(subscriber);
+}
+
+void actual_node::notify_node_monitors(const std::string& event, const std::string& peer_node)
+{
+  node_monitors_type subscribers;
+  {
+    const mutex_guard guard(node_monitors_lock);
+    subscribers = node_monitors;
+  }
+
+  if(subscribers.empty())
+    return;
+
+  const msg_seq msg = node_event(event, peer_node);
+
+  for(node_monitors_type::const_iterator subscriber = subscribers.begin(); subscriber != subscribers.end(); ++subscriber) {
+    try {
+      receive_incoming(received_msg(msg), *subscriber);
+    } catch(const tinch_pp_exception&) {
+      // Closed meanwhile.
+    }
+  }}
+
 void actual_node::request(control_msg& distributed_operation, const std::string& destination)
 {
-  node_connection_ptr connection = connector.get_connection_to(destination);
+  node_connection_ptr connection = connector.queueing_connection_to(destination);
 
   connection->request(distributed_operation);
 }
@@ -319,8 +529,9 @@ void actual_node::run_async_io()
     } catch(const connection_io_error& io_error) {
       std::cerr << "I/O error for " << io_error.node() << " error: "<< io_error.what() << std::endl;
 
-      // TODO: consider linked mailboxes?
-      connector.drop_connection_to(io_error.node());
+      // Both directions of a connection may fail => only the first error takes the node down.
+      if(connector.drop_connection_to(io_error.node()))
+        node_down(io_error.node());
     } catch(const tinch_pp_exception& e) {
       std::cerr << e.what() << std::endl; // TODO: cleaner...
     }
@@ -24,6 +24,7 @@
 
 #include "tinch_pp/node.h"
 #include "impl/node_connector.h"
+#include "impl/node_reconnector.h"
 #include "impl/epmd_requestor.h"
 #include "impl/node_access.h"
 #include "impl/linker.h"
@@ -34,6 +35,7 @@
 #include <boost/utility.hpp>
 #include <boost/weak_ptr.hpp>
 #include <string>
+#include <list>
 #include <map>
 
 namespace tinch_pp {
@@ -54,7 +56,8 @@ typedef boost::shared_ptr<link_operation_dispatcher_type> link_operation_dispatc
 /// responsible for listening to incoming connections at that port (case 2 above).
 /// 
 /// Networking strategy:
-/// Calls to EPMD are rare. Thus, all communication with EPMD is synchronous.
+/// Calls to EPMD are rare. Thus, the registration at EPMD is synchronous. The ports of 
+/// other nodes are looked up asynchronously, and cached, by the node_connector.
 /// The communication between connected nodes uses asynchronous TCP/IP.
 ///
 /// Threading:
@@ -69,7 +72,7 @@ public:
   // Creates a node using the default cookie (read from your user.home).
   //node(const std::string& node_name);
 
-  actual_node(const std::string& node_name, const std::string& cookie);
+  actual_node(const std::string& node_name, const std::string& cookie, port_number_type epmd_port);
 
   ~actual_node();
 
@@ -95,6 +98,18 @@ public:
   /// Returns a vector with the names of all nodes connected to this one.
   virtual std::vector<std::string> connected_nodes() const;
 
+  /// Payloads larger than the given number of bytes are compressed before sent.
+  virtual void set_compression_threshold(size_t payload_size);
+
+  /// Limits the number of bytes queued per node while connecting to it.
+  virtual void set_max_pending_bytes(size_t bytes);
+
+  /// Controls the background reconnects of lost nodes.
+  virtual void set_reconnect_backoff(boost::uint32_t initial_delay_ms, boost::uint32_t max_delay_ms);
+
+  /// Connects to all the given nodes in parallel.
+  virtual preconnect_results_type preconnect(const std::vector<std::string>& nodes, bool keep_retrying);
+
 private:
   // Take care - order of initialization matters (io_service always first).
   boost::asio::io_service io_service;
@@ -109,6 +124,8 @@ private:
  
   node_connector connector;
 
+  node_reconnector reconnector;
+
    // A separate thread that runs the io_service in order to perform aynchronous requests...
   boost::thread async_io_runner;
   // ...and executes the following function:
@@ -133,8 +150,30 @@ private:
 
   boost::mutex mailboxes_lock;
 
+  // Zero means no compression of outgoing payloads.
+  size_t compression_threshold;
+  boost::mutex compression_lock;
+
+  size_t pending_bytes_limit;
+  mutable boost::mutex pending_bytes_lock;
+
+  virtual size_t max_pending_bytes() const;
+
+  // Returns the payload to send, compressed in case it's large enough.
+  msg_seq outgoing_payload(const msg_seq& msg);
+
   linker mailbox_linker;
 
+  // The mailboxes subscribing to nodeup/nodedown.
+  typedef std::list<e_pid> node_monitors_type;
+  node_monitors_type node_monitors;
+  boost::mutex node_monitors_lock;
+
+  void notify_node_monitors(const std::string& event, const std::string& peer_node);
+
+  // As in Erlang, the links to the processes on a lost, or unreachable, node break with reason noconnection.
+  void break_links_to(const std::string& peer_node);
+
   link_operation_dispatcher_type_ptr remote_link_dispatcher;
   link_operation_dispatcher_type_ptr local_link_dispatcher;
 
@@ -170,9 +209,9 @@ private:
   virtual void deliver(const msg_seq& msg, const std::string& to_name, 
 		                     const std::string& on_given_node, const e_pid& from_pid);
 
-  virtual void receive_incoming(const msg_seq& msg, const e_pid& to);
+  virtual void receive_incoming(const received_msg& msg, const e_pid& to);
 
-  virtual void receive_incoming(const msg_seq& msg, const std::string& to);
+  virtual void receive_incoming(const received_msg& msg, const std::string& to);
 
   virtual void incoming_link(const e_pid& from, const e_pid& to);
 
@@ -182,6 +221,13 @@ private:
 
   virtual void incoming_exit2(const e_pid& from, const e_pid& to, const std::string& reason);
 
+  virtual void node_up(const std::string& peer_node);
+
+  virtual void node_unreachable(const std::string& peer_node);
+
+  virtual void node_down(const std::string& peer_node);
+
+  virtual void monitor_nodes(const e_pid& subscriber, bool on);
   // Implementation of mailbox_controller_type.
   //
   virtual void request_exit(const e_pid& from_pid, const e_pid& to_pid, const std::string& reason);
@@ -36,6 +36,14 @@ namespace constants {
   const int node_type = 72; // hidden node (i.e. not native Erlang)
   const boost::uint16_t supported_version = 5; // R6B and later
   const boost::uint32_t capabilities = extended_references | extended_pid_ports | support_bit_binaries;
+  const long handshake_timeout_sec = 7; // an incoming connection
+  const long net_setuptime_sec = 7;     // an outgoing one: EPMD lookup, connect and handshake (as in Erlang)
+  const int epmd_port = 4369; // the default
+  const long epmd_port_ttl_sec = 60;
+  const long epmd_negative_ttl_sec = 2; // a node that's down is retried soon
+  const boost::uint32_t reconnect_initial_delay_ms = 100; // doubled for each failed attempt...
+  const boost::uint32_t reconnect_max_delay_ms = 30000;   // ...up to this limit
+  const boost::uint32_t reconnect_max_attempts = 20;      // in a row, then the node is given up
 
   const int magic_version = 131;
   const int pass_through = 112;
@@ -31,6 +31,14 @@ namespace constants {
   extern const int node_type;
   extern const boost::uint16_t supported_version;
   extern const boost::uint32_t capabilities;
+  extern const long handshake_timeout_sec;
+  extern const long net_setuptime_sec;
+  extern const int epmd_port;
+  extern const long epmd_port_ttl_sec;
+  extern const long epmd_negative_ttl_sec;
+  extern const boost::uint32_t reconnect_initial_delay_ms;
+  extern const boost::uint32_t reconnect_max_delay_ms;
+  extern const boost::uint32_t reconnect_max_attempts;
 
   // Constants used for message exchange with nodes.
   extern const int magic_version;
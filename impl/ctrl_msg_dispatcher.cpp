@@ -25,6 +25,8 @@
 #include "constants.h"
 #include "matchable_range.h"
 #include "node_connection_access.h"
+#include "term_compression.h"
+#include "received_msg.h"
 #include "utils.h"
 #include <boost/lexical_cast.hpp>
 
@@ -80,6 +82,22 @@ public:
 
   virtual bool handle(msg_seq_iter& first, const msg_seq_iter& last) const = 0;
 
+protected:
+  // Refers to the payload following a ctrl-message in the frame being dispatched.
+  // A compressed payload is inflated into a buffer of its own.
+  received_msg payload(const msg_seq_iter& f, const msg_seq_iter& l) const
+  {
+    if(is_compressed_term(f, l))
+      return inflated_payload(f, l);
+
+    const char* data = (f != l) ? &*f : 0;
+
+    if(const frame_ptr frame = frame_scope::frame_containing(data, l - f))
+      return received_msg(frame, f - frame->begin());
+
+    return received_msg(msg_seq(f, l));
+  }
+
 private:
   void try_next_in_chain(msg_seq_iter& first, const msg_seq_iter& last) const
   {
@@ -95,6 +113,21 @@ protected:
 
 private:
   dispatcher_ptr next;
+
+  received_msg inflated_payload(const msg_seq_iter& f, const msg_seq_iter& l) const
+  {
+    // The buffer is reused unless a previous message inflated into it is still 
+    // referenced (e.g. waiting in a mailbox). There's one dispatcher per 
+    // connection, executing in the I/O thread => no need to lock.
+    if(!inflate_buffer || !inflate_buffer.unique())
+      inflate_buffer.reset(new msg_seq());
+
+    inflate_term(f, l, *inflate_buffer);
+
+    return received_msg(inflate_buffer, 0);
+  }
+
+  mutable frame_ptr inflate_buffer;
 };
 
 // SEND operation:  tuple of {2, Cookie, ToPid} 
@@ -113,8 +146,7 @@ public:
     if(matchable_range(f, l).match(make_e_tuple(int_(constants::ctrl_msg_send), atom(any()), pid(&to_pid)))) {
       check_term_version(f, l);
       
-      const msg_seq payload(f, l);
-      access->deliver_received(payload, to_pid);
+      access->deliver_received(payload(f, l), to_pid);
       handled = true;
     }
 
@@ -143,8 +175,7 @@ public:
     if(matchable_range(f, l).match(make_e_tuple(int_(constants::ctrl_msg_reg_send), pid(&from_pid), atom(any()), atom(&to_name)))) {
       check_term_version(f, l);
       
-      const msg_seq payload(f, l);
-      access->deliver_received(payload, to_name);
+      access->deliver_received(payload(f, l), to_name);
       handled = true;
     }
 
@@ -277,11 +308,14 @@ ctrl_msg_dispatcher::ctrl_msg_dispatcher(access_ptr access)
 {
 }
 
-void ctrl_msg_dispatcher::dispatch(msg_seq& msg) const
+void ctrl_msg_dispatcher::dispatch(const frame_ptr& msg) const
 {
+  // Allows the payload to be delivered without copying it out of the frame.
+  const frame_scope scope(msg);
+
   // On each successfully parsed element, the first-iterator is advanced.
-  msg_seq_iter first = msg.begin();
-  msg_seq_iter last = msg.end();
+  msg_seq_iter first = msg->begin();
+  msg_seq_iter last = msg->end();
 
   parse_header(first, last);
 
@@ -0,0 +1,117 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "epmd_port_cache.h"
+#include "utils.h"
+#include <boost/bind.hpp>
+#include <boost/thread/locks.hpp>
+
+using namespace tinch_pp;
+using namespace boost;
+namespace posix_time = boost::posix_time;
+
+namespace {
+
+posix_time::ptime now()
+{
+  return posix_time::microsec_clock::universal_time();
+}
+
+}
+
+epmd_port_cache::epmd_port_cache(asio::io_service& a_io_service, 
+                                 port_number_type an_epmd_port,
+                                 const posix_time::time_duration& a_ttl,
+                                 const posix_time::time_duration& a_negative_ttl)
+  : io_service(a_io_service),
+    epmd_port(an_epmd_port),
+    ttl(a_ttl),
+    negative_ttl(a_negative_ttl)
+{
+}
+
+void epmd_port_cache::async_lookup(const std::string& peer_node, const lookup_handler& handler)
+{
+  {
+    lock_guard<mutex> lock(cache_mutex);
+
+    cached_ports_type::const_iterator cached = cached_ports.find(peer_node);
+
+    if((cached != cached_ports.end()) && (now() < cached->second.expires)) {
+      io_service.post(bind(handler, cached->second.port, cached->second.failure));
+      return;
+    }
+
+    lookups_type::iterator on_its_way = lookups.find(peer_node);
+
+    if(on_its_way != lookups.end()) {
+      on_its_way->second.push_back(handler);
+      return;
+    }
+
+    lookups[peer_node].push_back(handler);
+  }
+
+  try {
+    // The request keeps running after the requestor goes out of scope.
+    epmd_requestor epmd(io_service, utils::node_host(peer_node), epmd_port);
+
+    epmd.async_port_please2_request(utils::node_name(peer_node), 
+                                    bind(&epmd_port_cache::lookup_done, this, peer_node, ::_1, ::_2));
+  } catch(const std::exception& e) {
+    // E.g. an invalid node name.
+    io_service.post(bind(&epmd_port_cache::lookup_done, this, peer_node, 
+                         optional<port_number_type>(), std::string(e.what())));
+  }
+}
+
+void epmd_port_cache::forget(const std::string& peer_node)
+{
+  lock_guard<mutex> lock(cache_mutex);
+
+  cached_ports.erase(peer_node);
+}
+
+void epmd_port_cache::lookup_done(const std::string& peer_node, 
+                                  const optional<port_number_type>& port, 
+                                  const std::string& failure)
+{
+  std::vector<lookup_handler> waiting;
+
+  {
+    lock_guard<mutex> lock(cache_mutex);
+
+    cached_port& cached = cached_ports[peer_node];
+    cached.port = port;
+    cached.failure = failure;
+    cached.expires = now() + (port ? ttl : negative_ttl);
+
+    lookups_type::iterator done = lookups.find(peer_node);
+
+    if(done != lookups.end()) {
+      waiting.swap(done->second);
+      lookups.erase(done);
+    }
+  }
+
+  for(std::vector<lookup_handler>::const_iterator h = waiting.begin(); h != waiting.end(); ++h)
+    (*h)(port, failure);
+}
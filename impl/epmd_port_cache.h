@@ -0,0 +1,90 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef EPMD_PORT_CACHE_H
+#define EPMD_PORT_CACHE_H
+
+// Before connecting to another node, we ask EPMD on the node's host for its port.
+// A reconnect storm (e.g. after a network glitch) would hit EPMD with one request 
+// per connection attempt. Instead, the node keeps the looked up ports in this cache:
+// - a port is reused for constants::epmd_port_ttl_sec,
+// - a failed lookup is remembered for constants::epmd_negative_ttl_sec, and
+// - concurrent lookups of the same node share a single PORT_PLEASE2_REQ.
+// All lookups execute asynchronously in the I/O context.
+#include "epmd_requestor.h"
+#include "types.h"
+#include <boost/asio.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/utility.hpp>
+#include <string>
+#include <vector>
+#include <map>
+
+namespace tinch_pp {
+
+class epmd_port_cache : boost::noncopyable
+{
+public:
+  typedef epmd_requestor::port_please2_handler lookup_handler;
+
+  epmd_port_cache(boost::asio::io_service& io_service, 
+                  port_number_type epmd_port,
+                  const boost::posix_time::time_duration& ttl,
+                  const boost::posix_time::time_duration& negative_ttl);
+
+  // Returns at once. The handler is always invoked in the I/O context, also for cached ports.
+  void async_lookup(const std::string& peer_node, const lookup_handler& handler);
+
+  // Invoked as a connection to a cached port fails: the node may have been restarted on another port.
+  void forget(const std::string& peer_node);
+
+private:
+  void lookup_done(const std::string& peer_node, 
+                   const boost::optional<port_number_type>& port, 
+                   const std::string& failure);
+
+  boost::asio::io_service& io_service;
+  const port_number_type epmd_port;
+  const boost::posix_time::time_duration ttl;
+  const boost::posix_time::time_duration negative_ttl;
+
+  struct cached_port
+  {
+    boost::optional<port_number_type> port; // empty for a failed lookup
+    std::string failure;
+    boost::posix_time::ptime expires;
+  };
+
+  typedef std::map<std::string /* node name */, cached_port> cached_ports_type;
+  cached_ports_type cached_ports;
+
+  // The lookups in progress, each one with the handlers waiting for it.
+  typedef std::map<std::string /* node name */, std::vector<lookup_handler> > lookups_type;
+  lookups_type lookups;
+
+  // Protects both containers. Never held while invoking a handler.
+  boost::mutex cache_mutex;
+};
+
+}
+
+#endif
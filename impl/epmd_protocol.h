@@ -41,6 +41,9 @@
 // 3) read the reply, and
 // 4 close the socket connection.
 //
+// The same protocol is served by our embedded name server (see tinch_pp/epmd_server.h), 
+// which also answers NAMES_REQ.
+//
 // Implementation
 // ==============
 // EPMD uses a binary protocol (see reference http://ftp.sunet.se/pub/lang/erlang/doc/apps/erts/erl_dist_protocol.html).
@@ -55,6 +58,8 @@
 #include <boost/spirit/include/phoenix_core.hpp>
 #include <boost/spirit/include/phoenix_operator.hpp>
 #include <boost/spirit/include/phoenix_fusion.hpp>
+#include <boost/spirit/include/phoenix_stl.hpp>
+#include <boost/fusion/include/std_pair.hpp>
 #include <vector>
 #include <string>
 
@@ -163,6 +168,116 @@ struct port2_resp_result : qi::grammar<msg_seq_iter, int()>
   qi::rule<msg_seq_iter, int()> start;
 };
 
+// The server side of the protocol.
+// =====================================================
+
+// A node, as registered through an ALIVE2_REQ.
+struct node_registration
+{
+  int port;
+  int node_type;
+  int protocol;
+  int highest_version;
+  int lowest_version;
+  std::string node_name;
+};
+
+}
+}
+
+// Adapt in the global namespace.
+BOOST_FUSION_ADAPT_STRUCT(
+   tinch_pp::epmd::node_registration,
+   (int, port)
+   (int, node_type)
+   (int, protocol)
+   (int, highest_version)
+   (int, lowest_version)
+   (std::string, node_name))
+
+namespace tinch_pp {
+namespace epmd {
+
+// Parses an ALIVE2_REQ (the length header excluded). The extra field is ignored.
+struct alive2_req_parser : qi::grammar<msg_seq_iter, node_registration(), qi::locals<boost::uint16_t> >
+{
+  alive2_req_parser() : base_type(start)
+    {
+      using namespace qi;
+      using qi::_1;
+
+      start %= omit[byte_(120)] >> big_word >> byte_ >> byte_ >> big_word >> big_word >> 
+	omit[big_word[_a = _1]] >> repeat(_a)[char_];
+    }
+
+  qi::rule<msg_seq_iter, node_registration(), qi::locals<boost::uint16_t> > start;
+};
+
+// Parses a PORT_PLEASE2_REQ (the length header excluded) into the requested node name.
+struct port_please2_req_parser : qi::grammar<msg_seq_iter, std::string()>
+{
+  port_please2_req_parser() : base_type(start)
+    {
+      using namespace qi;
+
+      start %= omit[byte_(122)] >> *char_;
+    }
+
+  qi::rule<msg_seq_iter, std::string()> start;
+};
+
+struct alive2_resp_generator : karma::grammar<msg_seq_out_iter, alive2_resp_result()>
+{
+  alive2_resp_generator() : base_type(start)
+    {
+      using phoenix::at_c;
+      using namespace karma;
+
+      start = byte_(121) << byte_[_1 = at_c<0>(_val)] << big_word[_1 = at_c<1>(_val)];
+    }
+
+  karma::rule<msg_seq_out_iter, alive2_resp_result()> start;
+};
+
+// The PORT2_RESP for a registered node. A failure is simply byte_(119) << byte_(1).
+struct port2_resp_generator : karma::grammar<msg_seq_out_iter, node_registration()>
+{
+  port2_resp_generator() : base_type(start)
+    {
+      using phoenix::at_c;
+      using boost::spirit::ascii::string;
+      using namespace karma;
+
+      const int success = 0;
+      const int extra_length = 0;
+
+      start = byte_(119) << byte_(success) << big_word[_1 = at_c<0>(_val)] << 
+	byte_[_1 = at_c<1>(_val)] << byte_[_1 = at_c<2>(_val)] <<
+	big_word[_1 = at_c<3>(_val)] << big_word[_1 = at_c<4>(_val)] <<
+	big_word[_1 = phoenix::size(at_c<5>(_val))] << string[_1 = at_c<5>(_val)] << 
+	big_word(extra_length);
+    }
+
+  karma::rule<msg_seq_out_iter, node_registration()> start;
+};
+
+// The NAMES_RESP is the port of EPMD (big_dword) followed by a line of text per 
+// registered node. This generates the lines.
+typedef std::vector<std::pair<std::string, int> > names_type;
+
+struct names_resp_generator : karma::grammar<msg_seq_out_iter, names_type()>
+{
+  names_resp_generator() : base_type(start)
+    {
+      using boost::spirit::ascii::string;
+      using namespace karma;
+
+      start = *(lit("name ") << string << lit(" at port ") << int_ << lit('\n'));
+    }
+
+  karma::rule<msg_seq_out_iter, names_type()> start;
+};
+
 }
 }
 
@@ -22,7 +22,11 @@
 #include "epmd_requestor.h"
 #include "epmd_protocol.h"
 #include "tinch_pp/exceptions.h"
+#include "constants.h"
 #include "utils.h"
+#include <boost/bind.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/shared_ptr.hpp>
 
 using namespace tinch_pp;
 namespace asio = boost::asio;
@@ -41,6 +45,8 @@ namespace {
   msg_seq port_please2_req(const std::string& peer_node);
 
   port_number_type receive_port_resp(tcp::socket& one_shot, const std::string& peer_node);
+
+  class port_please2_query;
 }
 
 epmd_requestor::epmd_requestor(boost::asio::io_service& a_io_service, 
@@ -77,6 +83,134 @@ port_number_type epmd_requestor::port_please2_request(const std::string& peer_no
 
 namespace {
 
+// The asynchronous PORT_PLEASE2_REQ keeps itself alive through its pending operations.
+// Contrary to the synchronous version, we read exactly the part of the response we 
+// need: the result and, on success, the port number.
+// An EPMD that doesn't answer within constants::net_setuptime_sec (e.g. a blackholed 
+// host) fails the query, instead of leaving it to the OS timeouts.
+class port_please2_query : public boost::enable_shared_from_this<port_please2_query>
+{
+public:
+  port_please2_query(asio::io_service& a_io_service, 
+                     const std::string& a_peer_node, 
+                     const epmd_requestor::port_please2_handler& a_handler)
+    : io_service(a_io_service),
+      one_shot(a_io_service),
+      deadline(a_io_service),
+      peer_node(a_peer_node),
+      handler(a_handler),
+      finished(false),
+      response(4)
+  {
+  }
+
+  void start(const std::string& epmd_host, port_number_type epmd_port)
+  {
+    deadline.expires_from_now(boost::posix_time::seconds(constants::net_setuptime_sec));
+    deadline.async_wait(boost::bind(&port_please2_query::timed_out, shared_from_this(), asio::placeholders::error));
+
+    utils::async_connect_socket(io_service, one_shot, epmd_host, epmd_port,
+                                boost::bind(&port_please2_query::connected, shared_from_this(), ::_1));
+  }
+
+private:
+  void timed_out(const boost::system::error_code& error)
+  {
+    if(error == asio::error::operation_aborted)
+      return;
+
+    failed("EPMD didn't answer the port request for the node = " + peer_node + " in time");
+  }
+
+  void connected(const boost::system::error_code& error)
+  {
+    // The name resolution isn't cancelled by the deadline => a late connect may follow.
+    if(finished) {
+      boost::system::error_code ignored;
+      one_shot.close(ignored);
+      return;
+    }
+
+    if(error)
+      return failed("Failed to connect to EPMD");
+
+    request = port_please2_req(peer_node);
+
+    asio::async_write(one_shot, asio::buffer(request), 
+                      boost::bind(&port_please2_query::written, shared_from_this(), asio::placeholders::error));
+  }
+
+  void written(const boost::system::error_code& error)
+  {
+    if(error)
+      return failed("Write failure to EPMD");
+
+    asio::async_read(one_shot, asio::buffer(&response[0], 2), 
+                     boost::bind(&port_please2_query::result_read, shared_from_this(), asio::placeholders::error));
+  }
+
+  void result_read(const boost::system::error_code& error)
+  {
+    if(error)
+      return failed("Failed to read PORT2_RESP from EPMD");
+
+    // Parse in two steps, as the synchronous request; in case we failed, nothing more 
+    // than a result code is returned.
+    int result = 1; // failure
+    epmd::port2_resp_result port2_resp_result;
+    msg_seq_iter f = response.begin();
+
+    if(!qi::parse(f, response.begin() + 2, port2_resp_result, result) || (result != 0))
+      return failed("EPMD denies the port number for the node = " + peer_node + ". Connection aborted.");
+
+    asio::async_read(one_shot, asio::buffer(&response[2], 2), 
+                     boost::bind(&port_please2_query::port_read, shared_from_this(), asio::placeholders::error));
+  }
+
+  void port_read(const boost::system::error_code& error)
+  {
+    if(error)
+      return failed("Failed to read PORT2_RESP from EPMD");
+
+    int port = 0;
+    epmd::port2_resp_result port2_resp_result;
+    utils::parse(response, qi::omit[port2_resp_result] >> qi::big_word, port);
+
+    finish(port_number_type(port), "");
+  }
+
+  void failed(const std::string& reason)
+  {
+    finish(boost::none, reason);
+  }
+
+  // Closing the socket aborts any operation still pending => the handler is invoked once.
+  void finish(const boost::optional<port_number_type>& port, const std::string& failure)
+  {
+    if(finished)
+      return;
+
+    finished = true;
+
+    deadline.cancel();
+
+    boost::system::error_code ignored;
+    one_shot.close(ignored);
+
+    handler(port, failure);
+  }
+
+  asio::io_service& io_service;
+  tcp::socket one_shot;
+  asio::deadline_timer deadline;
+  const std::string peer_node;
+  const epmd_requestor::port_please2_handler handler;
+  bool finished;
+
+  msg_seq request;
+  msg_seq response;
+};
+
 void send_to_epmd(tcp::socket& epmd_socket, const msg_seq& epmd_msg)
 {
   boost::system::error_code error;
@@ -159,3 +293,10 @@ port_number_type receive_port_resp(tcp::socket& one_shot, const std::string& pee
 }
 
 }
+
+void epmd_requestor::async_port_please2_request(const std::string& peer_node, const port_please2_handler& handler)
+{
+  const boost::shared_ptr<port_please2_query> query(new port_please2_query(io_service, peer_node, handler));
+
+  query->start(epmd_host, epmd_port);
+}
@@ -23,11 +23,14 @@
 #define EPMD_REQUESTOR_H
 
 // Encapsulates the communication with EPMD (Erlang Port Mapper Daemon).
-// EPMD requests are rare so, for simplicity, all requests are modelled 
-// as syncrhonous.
+// EPMD requests are rare so, for simplicity, most requests are modelled 
+// as syncrhonous. The exception is PORT_PLEASE2_REQ, which is issued as 
+// connections are established, and thus also executes asynchronously.
 #include "types.h"
 #include <boost/asio.hpp>
 #include <boost/utility.hpp>
+#include <boost/function.hpp>
+#include <boost/optional.hpp>
 #include <string>
 
 namespace tinch_pp {
@@ -43,6 +46,14 @@ public:
 
   port_number_type port_please2_request(const std::string& peer_node);
 
+  // Invoked with the port of the node or, in case the lookup failed, with the reason.
+  typedef boost::function<void (const boost::optional<port_number_type>& port, 
+                                const std::string& failure)> port_please2_handler;
+
+  // Returns at once. The handler is invoked exactly once, in the I/O context.
+  // The request is independent of this object (i.e. it may be destroyed meanwhile).
+  void async_port_please2_request(const std::string& peer_node, const port_please2_handler& handler);
+
 private:
   boost::asio::io_service& io_service;
   boost::asio::ip::tcp::socket epmd_socket;
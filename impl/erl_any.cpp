@@ -24,16 +24,14 @@
 #include "tinch_pp/exceptions.h"
 #include "term_conversions.h"
 #include "ext_term_grammar.h"
+#include "term_decoder.h"
 #include "matchable_seq.h"
-#include <boost/bind.hpp>
-#include <boost/optional.hpp>
-#include <boost/assign/list_of.hpp>
-#include <cassert>
+#include "received_msg.h"
+#include <algorithm>
 
 using namespace tinch_pp;
 using namespace tinch_pp::erl;
 using namespace boost;
-using namespace boost::assign;
 
 namespace {
 
@@ -72,31 +70,30 @@ bool match_binary(msg_seq_iter& f, const msg_seq_iter& l, const any& instance)
    return binary(instance).match(f, l);
 }
 
-bool match_tuple(msg_seq_iter& f, const msg_seq_iter& l, const any& instance)
+bool match_map(msg_seq_iter& f, const msg_seq_iter& l, const any& instance)
 {
    msg_seq_iter start = f;
 
-   size_t parsed_length = 0;
-   bool match = binary_to_term<small_tuple_head_ext>(f, l, parsed_length);
-   assert(match); // already checked in the previous dispatch-mechanism
+   size_t parsed_arity = 0;
+   bool match = binary_to_term<map_head_ext>(f, l, parsed_arity);
 
-   instance.save_matched_bytes(msg_seq(start, f));
+   match = match && instance.save_matched_bytes(start, f);
 
-   for(size_t i = 0; match && (i < parsed_length); ++i)
+   // Each association is encoded as a key followed by its value.
+   for(size_t i = 0; match && (i < 2 * parsed_arity); ++i)
       match &= instance.match(f, l);
 
    return match;
 }
 
-bool match_list(msg_seq_iter& f, const msg_seq_iter& l, const any& instance)
+bool match_tuple(msg_seq_iter& f, const msg_seq_iter& l, const any& instance)
 {
    msg_seq_iter start = f;
 
    size_t parsed_length = 0;
-   bool match = binary_to_term<list_head_ext>(f, l, parsed_length);
-   assert(match); // already checked in the previous dispatch-mechanism
+   bool match = decoder::decode_small_tuple_head(f, l, parsed_length);
 
-   instance.save_matched_bytes(msg_seq(start, f));
+   match = match && instance.save_matched_bytes(start, f);
 
    for(size_t i = 0; match && (i < parsed_length); ++i)
       match &= instance.match(f, l);
@@ -104,69 +101,139 @@ bool match_list(msg_seq_iter& f, const msg_seq_iter& l, const any& instance)
    return match;
 }
 
-optional<int> extract_type_tag(msg_seq_iter& f, const msg_seq_iter& l)
+bool match_list(msg_seq_iter& f, const msg_seq_iter& l, const any& instance)
 {
-   optional<int> tag;
+   msg_seq_iter start = f;
+
+   size_t parsed_length = 0;
+   bool match = decoder::decode_list_head(f, l, parsed_length);
 
-   if(f != l)
-      tag = static_cast<int>(*f);
+   match = match && instance.save_matched_bytes(start, f);
 
-   return tag;
+   // The elements are followed by the tail (nil for a proper list).
+   for(size_t i = 0; match && (i < parsed_length + 1); ++i)
+      match &= instance.match(f, l);
+
+   return match;
 }
 
+bool match_nil(msg_seq_iter& f, const msg_seq_iter& l, const any& instance)
+{
+   msg_seq_iter start = f++;
+
+   return instance.save_matched_bytes(start, f);
 }
 
-const any::dynamic_element_matcher_type any::dynamic_element_matcher = 
-   map_list_of
-      //    Type                    Match function
-      (type_tag::small_integer,     bind(match_int,        ::_1, ::_2, ::_3))
-      (type_tag::integer,           bind(match_int,        ::_1, ::_2, ::_3))
-      (type_tag::atom_ext,          bind(match_atom,       ::_1, ::_2, ::_3))
-      (type_tag::small_tuple,       bind(match_tuple,      ::_1, ::_2, ::_3))
-      (type_tag::list,              bind(match_list,       ::_1, ::_2, ::_3))
-      (type_tag::string_ext,        bind(match_string,     ::_1, ::_2, ::_3))
-      (type_tag::pid,               bind(match_pid,        ::_1, ::_2, ::_3))
-      (type_tag::new_reference_ext, bind(match_reference,  ::_1, ::_2, ::_3))
-      (type_tag::float_ext,         bind(match_float,      ::_1, ::_2, ::_3))
-      (type_tag::binary_ext,        bind(match_binary,     ::_1, ::_2, ::_3))
-      (type_tag::bit_binary_ext,    bind(match_binary,     ::_1, ::_2, ::_3));
+typedef bool (*term_matcher_type)(msg_seq_iter& f, const msg_seq_iter& l, const any& instance);
 
-bool any::match_dynamically(msg_seq_iter& f, const msg_seq_iter& l, const any& instance)
+// The matchers are indexed directly by the type tag (one byte); unsupported tags have none.
+struct dynamic_element_matcher_table
 {
-   bool matched = false;
+   dynamic_element_matcher_table()
+   {
+      std::fill(matchers, matchers + table_size, static_cast<term_matcher_type>(0));
+
+      //        Type                          Match function
+      matchers[type_tag::small_integer]     = match_int;
+      matchers[type_tag::integer]           = match_int;
+      matchers[type_tag::atom_ext]          = match_atom;
+      matchers[type_tag::small_tuple]       = match_tuple;
+      matchers[type_tag::list]              = match_list;
+      matchers[type_tag::nil_ext]           = match_nil;
+      matchers[type_tag::map_ext]           = match_map;
+      matchers[type_tag::string_ext]        = match_string;
+      matchers[type_tag::pid]               = match_pid;
+      matchers[type_tag::new_reference_ext] = match_reference;
+      matchers[type_tag::float_ext]         = match_float;
+      matchers[type_tag::binary_ext]        = match_binary;
+      matchers[type_tag::bit_binary_ext]    = match_binary;
+   }
+
+   enum { table_size = 256 };
+
+   term_matcher_type matchers[table_size];
+};
 
-   if(const optional<term_id_type> tag = extract_type_tag(f, l)) {
-      dynamic_element_matcher_type::const_iterator m = dynamic_element_matcher.find(*tag);
+const dynamic_element_matcher_table dynamic_element_matcher;
 
-      // TODO: Once we support all types, this should be considered an erronoues term (raise exception).
-      if(m != dynamic_element_matcher.end()) {
-         const term_matcher_type matcher = m->second;
-         matched = matcher(f, l, instance);
-      }
+// A term captured within a received message refers to the frame of the message.
+// Otherwise (e.g. when matching a plain msg_seq), the captured bytes are copied.
+matchable_ptr make_capture(const msg_seq_iter& start, size_t length)
+{
+   if(length > 0) {
+      const char* data = &*start;
+
+      if(const frame_ptr frame = frame_scope::frame_containing(data, length))
+         return matchable_ptr(new matchable_seq(frame, data - &(*frame)[0], length));
    }
 
-   return matched;
+   return matchable_ptr(new matchable_seq(msg_seq(start, start + length)));
+}
+
+}
+
+bool any::match_dynamically(msg_seq_iter& f, const msg_seq_iter& l, const any& instance)
+{
+   // TODO: Once we support all types, an unknown tag should be considered an erronoues term (raise exception).
+   const term_matcher_type matcher = (f != l) ? dynamic_element_matcher.matchers[static_cast<boost::uint8_t>(*f)] : 0;
+
+   return matcher ? matcher(f, l, instance) : false;
 }
 
 any::any()
-   : to_assign(&placeholder)
+   : to_assign(&placeholder),
+     captured_length(0),
+     capturing(false)
 {}
 
 any::any(matchable_ptr* a_to_assign)
-   : to_assign(a_to_assign)
+   : to_assign(a_to_assign),
+     captured_length(0),
+     capturing(false)
 {}
 
+any::any(const any& other)
+   : to_assign((other.to_assign == &other.placeholder) ? &placeholder : other.to_assign),
+     captured_length(0),
+     capturing(false)
+{}
+
+any& any::operator=(const any& other)
+{
+   to_assign = (other.to_assign == &other.placeholder) ? &placeholder : other.to_assign;
+   captured_length = 0;
+
+   return *this;
+}
+
 bool any::match(msg_seq_iter& f, const msg_seq_iter& l) const
 {
-   const bool res = match_dynamically(f, l, *this);
-   to_assign->reset(new matchable_seq(matched_raw_bytes));
+   // The elements of compound terms are matched recursively through this instance; 
+   // only the outermost match starts (and assigns) a new capture. That allows a 
+   // pattern to be matched against several messages.
+   if(capturing)
+      return match_dynamically(f, l, *this);
+
+   capture_start = f;
+   captured_length = 0;
+   capturing = true;
+
+   // Within a matched message, the end of the term is found in its index =>
+   // it is captured as a whole instead of element by element.
+   const bool res = frame_scope::skip_indexed_term(f, l) ? save_matched_bytes(capture_start, f) : 
+                                                           match_dynamically(f, l, *this);
+   capturing = false;
+
+   *to_assign = make_capture(capture_start, captured_length);
 
    return res;
 }
 
-bool any::save_matched_bytes(const msg_seq& raw_msg_part) const
+bool any::save_matched_bytes(const msg_seq_iter& first, const msg_seq_iter& last) const
 {
-   matched_raw_bytes.insert(matched_raw_bytes.end(), raw_msg_part.begin(), raw_msg_part.end());
+   // The elements of a term are matched in order => the capture is contiguous.
+   if(capturing)
+      captured_length = last - capture_start;
 
    return true;
 }
@@ -0,0 +1,262 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "tinch_pp/erl_map.h"
+#include "tinch_pp/erl_any.h"
+#include "ext_term_grammar.h"
+#include "term_conversions.h"
+#include "term_skipper.h"
+#include "matchable_seq.h"
+#include "received_msg.h"
+#include <boost/bind.hpp>
+#include <boost/thread/locks.hpp>
+#include <algorithm>
+#include <cassert>
+
+using namespace tinch_pp;
+using namespace tinch_pp::erl;
+using namespace boost;
+
+namespace {
+
+typedef erl::detail::map_association association;
+typedef erl::detail::map_index_type index_type;
+
+// Locates (without decoding) the keys and values of the map starting at f.
+// The locations are given as offsets from f. Upon a successful return, f refers 
+// to the first position after the map.
+bool index_map(msg_seq_iter& f, const msg_seq_iter& l, index_type& index)
+{
+  const msg_seq_iter start = f;
+  size_t arity = 0;
+
+  if(!binary_to_term<map_head_ext>(f, l, arity))
+    return false;
+
+  // Each association takes at least two bytes => a corrupt arity doesn't make us 
+  // reserve more than the rest of the map could hold.
+  index.reserve(std::min(arity, static_cast<size_t>(l - f) / 2));
+
+  bool located = true;
+
+  for(size_t i = 0; located && (i < arity); ++i) {
+    association a;
+
+    a.key = f - start;
+    located = skip_term(f, l);
+    a.value = f - start;
+    located = located && skip_term(f, l);
+    a.end = f - start;
+
+    index.push_back(a);
+  }
+
+  return located;
+}
+
+// The whole range has to be consumed; otherwise we only matched a prefix of the key or value.
+bool match_exactly(const object& pattern, msg_seq_iter f, const msg_seq_iter& l)
+{
+  return pattern.match(f, l) && (f == l);
+}
+
+const association* find_key(const index_type& index, const msg_seq_iter& start, const object& key)
+{
+  for(index_type::const_iterator a = index.begin(); a != index.end(); ++a) {
+    if(match_exactly(key, start + a->key, start + a->value))
+      return &*a;
+  }
+
+  return 0;
+}
+
+bool match_association(const index_type& index, 
+                       const msg_seq_iter& start, 
+                       const e_map::association_type& wanted)
+{
+  const association* found = find_key(index, start, *wanted.first);
+
+  return (0 != found) && match_exactly(*wanted.second, start + found->value, start + found->end);
+}
+
+// In Erlang, a map pattern matches as long as the given keys are present (and their values match).
+bool match_map_value(msg_seq_iter& f, const msg_seq_iter& l, const e_map::value_type& val)
+{
+  const msg_seq_iter start = f;
+  index_type index;
+
+  return index_map(f, l, index) &&
+         (val.end() == std::find_if(val.begin(), val.end(), 
+                                    bind(match_association, cref(index), cref(start), ::_1) == false));
+}
+
+// A map is kept in its encoded form until the client asks for a specific key.
+bool skip_map(msg_seq_iter& f, const msg_seq_iter& l)
+{
+  const bool is_map = (f != l) && (type_tag::map_ext == static_cast<boost::uint8_t>(*f));
+
+  return is_map && skip_term(f, l);
+}
+
+bool assign_matched_map(msg_seq_iter& f, const msg_seq_iter& l, map_view* to_assign)
+{
+  assert(to_assign != 0);
+  msg_seq_iter start = f;
+
+  if(!skip_map(f, l))
+    return false;
+
+  const char* data = &*start;
+  const size_t length = f - start;
+
+  // Within a received message, the view refers to the message instead of a copy.
+  if(const frame_ptr frame = frame_scope::frame_containing(data, length))
+    to_assign->assign(frame, data - &(*frame)[0], length);
+  else
+    to_assign->assign(msg_seq(start, f));
+
+  return true;
+}
+
+bool match_any_map(msg_seq_iter& f, const msg_seq_iter& l, const any& match_any)
+{
+  msg_seq_iter start = f;
+
+  return skip_map(f, l) ? match_any.save_matched_bytes(start, f) : false;
+}
+
+void serialize_association(const e_map::association_type& association, msg_seq_out_iter& out)
+{
+  association.first->serialize(out);
+  association.second->serialize(out);
+}
+
+}
+
+e_map::e_map(const value_type& associations)
+  : val(associations),
+    to_assign(0) {}
+
+e_map::e_map(map_view* a_to_assign)
+  : to_assign(a_to_assign),
+    match_fn(bind(assign_matched_map, ::_1, ::_2, to_assign)) {}
+
+e_map::e_map(const any& match_any)
+  : to_assign(0),
+    match_fn(bind(match_any_map, ::_1, ::_2, cref(match_any))) {}
+
+void e_map::serialize(msg_seq_out_iter& out) const
+{
+  map_head_g g;
+  karma::generate(out, g, val.size());
+
+  std::for_each(val.begin(), val.end(), bind(serialize_association, ::_1, boost::ref(out)));
+}
+
+size_t e_map::encoded_size() const
+{
+  size_t size = 5;
+
+  for(value_type::const_iterator a = val.begin(); a != val.end(); ++a)
+    size += a->first->encoded_size() + a->second->encoded_size();
+
+  return size;
+}
+
+bool e_map::match(msg_seq_iter& f, const msg_seq_iter& l) const
+{
+  return match_fn ? match_fn(f, l) : match_map_value(f, l, val);
+}
+
+// map_view
+//
+map_view::map_view()
+  : frame(new msg_seq()),
+    offset(0),
+    length(0),
+    index(new erl::detail::lazy_map_index()) {}
+
+void map_view::assign(const msg_seq& encoded_map)
+{
+  assign(frame_ptr(new msg_seq(encoded_map)), 0, encoded_map.size());
+}
+
+void map_view::assign(const frame_ptr& a_frame, size_t an_offset, size_t a_length)
+{
+  frame = a_frame;
+  offset = an_offset;
+  length = a_length;
+  index.reset(new erl::detail::lazy_map_index());
+}
+
+size_t map_view::size() const
+{
+  msg_seq_iter f = first();
+  size_t arity = 0;
+
+  binary_to_term<map_head_ext>(f, last(), arity);
+
+  return arity;
+}
+
+bool map_view::has_key(const object& key) const
+{
+  return 0 != locate(key);
+}
+
+bool map_view::match(const object& key, const object& value) const
+{
+  const association* found = locate(key);
+
+  // Allow the value pattern to refer to our frame (e.g. binary views).
+  const frame_scope scope(frame);
+
+  return (0 != found) && match_exactly(value, first() + found->value, first() + found->end);
+}
+
+matchable_ptr map_view::find(const object& key) const
+{
+  matchable_ptr value;
+
+  if(const association* found = locate(key))
+    value.reset(new matchable_seq(frame, offset + found->value, found->end - found->value));
+
+  return value;
+}
+
+const association* map_view::locate(const object& key) const
+{
+  {
+    // The index is built once, on the first access.
+    boost::lock_guard<boost::mutex> lock(index->build_mutex);
+
+    if(!index->built) {
+      msg_seq_iter f = first();
+
+      if(!index_map(f, last(), index->associations))
+        index->associations.clear();
+
+      index->built = true;
+    }
+  }
+
+  return find_key(index->associations, first(), key);
+}
@@ -21,12 +21,11 @@
 // ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "tinch_pp/erl_string.h"
 #include "tinch_pp/erl_any.h"
-#include "string_matcher.h"
 #include "ext_term_grammar.h"
 #include "term_conversions.h"
+#include "term_decoder.h"
 #include <boost/bind.hpp>
-#include <list>
-#include <algorithm>
+#include <cstring>
 #include <cassert>
 
 using namespace tinch_pp;
@@ -36,55 +35,64 @@ using namespace std;
 
 namespace {
 
-typedef tinch_pp::detail::string_matcher matcher_s;
-
-erl::int_ create_int(char val)
+// Locates the characters of a string. Upon success, f refers to the first character.
+bool parse_string_head(msg_seq_iter& f, const msg_seq_iter& l, size_t& length)
 {
-  const uint32_t int_val = val;
-  return erl::int_(int_val);
+  return decoder::decode_string_head(f, l, length) && (decoder::available(f, l) >= length);
 }
 
+// The characters of a string are encoded as one byte each => we compare and 
+// copy them in one go instead of matching them as a list of integers.
 bool match_string_value(msg_seq_iter& f, const msg_seq_iter& l, const string& val)
 {
-  // We're reusing the list implementation:
-  std::list<int_> as_ints;
-  std::transform(val.begin(), val.end(), back_inserter(as_ints), create_int);
+  size_t length = 0;
 
-  return matcher_s::match(as_ints, f, l);
-}
+  if(!parse_string_head(f, l, length) || (val.size() != length))
+    return false;
 
-char shrink_int(const erl::int_& val)
-{
-  return static_cast<char>(val.value());
+  const bool matched = (0 == length) || (0 == std::memcmp(val.data(), &*f, length));
+  f += length;
+
+  return matched;
 }
 
 bool assign_matched_string(msg_seq_iter& f, const msg_seq_iter& l, string* to_assign)
 {
   assert(to_assign != 0);
   
-  std::list<int_> as_ints;
-  const bool res = matcher_s::assign_match(&as_ints, f, l);
+  size_t length = 0;
+
+  if(!parse_string_head(f, l, length))
+    return false;
+
+  if(0 == length)
+    to_assign->clear();
+  else
+    to_assign->assign(&*f, length);
 
-  for_each(as_ints.begin(), as_ints.end(), bind(&string::push_back, to_assign,
-                                                bind(shrink_int, ::_1)));
+  f += length;
 
-  return res;
+  return true;
 }
 
 bool match_any_string(msg_seq_iter& f, const msg_seq_iter& l, const any& match_any)
 {
-  std::string ignore;
+  size_t length = 0;
   msg_seq_iter start = f;
 
-  return assign_matched_string(f, l, &ignore) ? match_any.save_matched_bytes(msg_seq(start, f)) : false;
+  if(!parse_string_head(f, l, length))
+    return false;
+
+  f += length;
+
+  return match_any.save_matched_bytes(start, f);
 }
 
 }
 
 e_string::e_string(const std::string& a_val)
   : val(a_val),
-    to_assign(0),
-    match_fn(bind(match_string_value, ::_1, ::_2, cref(val))) {}
+    to_assign(0) {}
 
 e_string::e_string(std::string* a_to_assign)
  : to_assign(a_to_assign),
@@ -101,7 +109,12 @@ void e_string::serialize(msg_seq_out_iter& out) const
   term_to_binary<string_ext_g>(out, s);
 }
 
+size_t e_string::encoded_size() const
+{
+  return 3 + val.size();
+}
+
 bool e_string::match(msg_seq_iter& f, const msg_seq_iter& l) const
 {
-  return match_fn(f, l);
+  return match_fn ? match_fn(f, l) : match_string_value(f, l, val);
 }
@@ -23,10 +23,13 @@
 #include "ext_term_grammar.h"
 #include "tinch_pp/erl_any.h"
 #include "term_conversions.h"
+#include "term_decoder.h"
+#include "received_msg.h"
 #include <boost/bind.hpp>
 #include <boost/format.hpp>
 #include <limits>
 #include <cassert>
+#include <cstring>
 #include <cstdio>
 #include <cmath>
 #include <iostream>
@@ -37,27 +40,12 @@ using namespace boost;
 
 namespace {
 
-bool match_int_value(msg_seq_iter& f, const msg_seq_iter& l, int32_t val)
-{
-  boost::int32_t res = 0;
-
-  const bool success = binary_to_term<tinch_pp::integer>(f, l, res);
-
-  return success && (val == res);
-}
-
-bool assign_matched_int(msg_seq_iter& f, const msg_seq_iter& l, int32_t* to_assign)
-{
-  assert(to_assign != 0);
-  return binary_to_term<tinch_pp::integer>(f, l, *to_assign);
-}
-
 bool match_any_int(msg_seq_iter& f, const msg_seq_iter& l, const any& any_int)
 {
   boost::int32_t ignore = 0;
   msg_seq_iter start = f;
 
-  return binary_to_term<tinch_pp::integer>(f, l, ignore) ? any_int.save_matched_bytes(msg_seq(start, f)) : false;
+  return decoder::decode_integer(f, l, ignore) ? any_int.save_matched_bytes(start, f) : false;
 }
 
 }
@@ -65,19 +53,19 @@ bool match_any_int(msg_seq_iter& f, const msg_seq_iter& l, const any& any_int)
 int_::int_(int32_t a_val) 
   : val(a_val),
     to_assign(0),
-    match_fn(bind(match_int_value, ::_1, ::_2, val))
+    match_any(0)
  {}
 
 int_::int_(boost::int32_t* a_to_assign)
   : val(0),
     to_assign(a_to_assign),
-    match_fn(bind(assign_matched_int, ::_1, ::_2, to_assign))
+    match_any(0)
 {}
 
 int_::int_(const any& any_int)
 : val(0),
   to_assign(0),
-  match_fn(bind(match_any_int, ::_1, ::_2, cref(any_int)))
+  match_any(&any_int)
 {}
 
 void int_::serialize(msg_seq_out_iter& out) const
@@ -88,9 +76,16 @@ void int_::serialize(msg_seq_out_iter& out) const
   is_small_int ? term_to_binary<small_integer_g>(out, val) : term_to_binary<integer_ext_g>(out, val);
 }
 
-bool int_::match(msg_seq_iter& f, const msg_seq_iter& l) const
+size_t int_::encoded_size() const
 {
-  return match_fn(f, l);
+  const bool is_small_int = (val >= 0) && (val <= std::numeric_limits<boost::uint8_t>::max());
+
+  return is_small_int ? 2 : 5;
+}
+
+bool int_::match_as_any(msg_seq_iter& f, const msg_seq_iter& l) const
+{
+  return match_any_int(f, l, *match_any);
 }
 
 bool int_::match_string_element(msg_seq_iter& f, const msg_seq_iter& l) const
@@ -111,27 +106,12 @@ bool int_::match_string_element(msg_seq_iter& f, const msg_seq_iter& l) const
 
 namespace {
 
-bool match_value(msg_seq_iter& f, const msg_seq_iter& l, const tinch_pp::e_pid& val)
-{
-  tinch_pp::e_pid res;
-  
-  const bool success = binary_to_term<pid_ext>(f, l, res);
-
-  return success && (val == res);
-}
-
- bool assign_matched(msg_seq_iter& f, const msg_seq_iter& l, tinch_pp::e_pid* to_assign)
-{
-  assert(to_assign != 0);
-  return binary_to_term<pid_ext>(f, l, *to_assign);
-}
-
 bool match_any_pid(msg_seq_iter& f, const msg_seq_iter& l, const any& match_any)
 {
   tinch_pp::e_pid ignore;
   msg_seq_iter start = f;
 
-  return binary_to_term<pid_ext>(f, l, ignore) ? match_any.save_matched_bytes(msg_seq(start, f)) : false;
+  return decoder::decode_pid(f, l, ignore) ? match_any.save_matched_bytes(start, f) : false;
 }
 
 bool equal_doubles(double x, double y)
@@ -184,59 +164,114 @@ bool match_any_float(msg_seq_iter& f, const msg_seq_iter& l, const any& match_an
   std::string ignore;
   msg_seq_iter start = f;
 
-  return binary_to_term<float_ext>(f, l, ignore) ? match_any.save_matched_bytes(msg_seq(start, f)) : false;
+  return binary_to_term<float_ext>(f, l, ignore) ? match_any.save_matched_bytes(start, f) : false;
 }
 
-bool match_atom_value(msg_seq_iter& f, const msg_seq_iter& l, const std::string& val)
+bool match_any_atom(msg_seq_iter& f, const msg_seq_iter& l, const any& match_any)
 {
-  std::string res;
-  const bool success = binary_to_term<atom_ext>(f, l, res);
+  msg_seq_iter start = f;
+  msg_seq_iter name;
+  size_t length = 0;
 
-  return success && (val == res);
+  return decoder::decode_atom_head(f, l, name, length) ? match_any.save_matched_bytes(start, f) : false;
 }
 
-bool assign_matched_atom(msg_seq_iter& f, const msg_seq_iter& l, std::string* to_assign)
+// ATOM_EXT: the tag, the (2 byte) length and the characters.
+std::string encode_atom(const std::string& name)
 {
-  assert(to_assign != 0);
-  return binary_to_term<atom_ext>(f, l, *to_assign);
+  std::string encoded;
+
+  encoded.reserve(3 + name.size());
+  encoded.push_back(static_cast<char>(type_tag::atom_ext));
+  encoded.push_back(static_cast<char>((name.size() >> 8) & 0xFF));
+  encoded.push_back(static_cast<char>(name.size() & 0xFF));
+  encoded.append(name);
+
+  return encoded;
 }
 
-bool match_any_atom(msg_seq_iter& f, const msg_seq_iter& l, const any& match_any)
+// The head is followed by the given number of bytes.
+bool parse_binary_head(msg_seq_iter& f, const msg_seq_iter& l, size_t& length, int& padding_bits)
 {
-  std::string ignore;
-  msg_seq_iter start = f;
+  msg_seq_iter i = f;
+
+  if(!decoder::decode_binary_head(i, l, length, padding_bits) || (decoder::available(i, l) < length))
+    return false;
 
-  return binary_to_term<atom_ext>(f, l, ignore) ? match_any.save_matched_bytes(msg_seq(start, f)) : false;
+  f = i;
+
+  return true;
 }
 
 bool match_binary_value(msg_seq_iter& f, const msg_seq_iter& l, const binary_value_type& val)
 {
-  binary_value_type res;
-  const bool success = binary_to_term<binary_ext>(f, l, res.value) ||
-                       binary_to_term<bit_binary_ext>(f, l, res);
+  size_t length = 0;
+  int padding_bits = 0;
+
+  if(!parse_binary_head(f, l, length, padding_bits))
+    return false;
 
-  return success && (res == val);
+  const msg_seq_iter data = f;
+  f += length;
+
+  return (length == val.value.size()) && (padding_bits == val.padding_bits) &&
+         ((0 == length) || (0 == std::memcmp(&*data, &val.value[0], length)));
 }
 
 bool assign_matched_binary(msg_seq_iter& f, const msg_seq_iter& l, binary_value_type* to_assign)
 {
   assert(to_assign != 0);
 
-  return binary_to_term<binary_ext>(f, l, to_assign->value) || binary_to_term<bit_binary_ext>(f, l, *to_assign);
+  size_t length = 0;
+  int padding_bits = 0;
+
+  if(!parse_binary_head(f, l, length, padding_bits))
+    return false;
+
+  to_assign->padding_bits = padding_bits;
+  to_assign->value.assign(f, f + length);
+  f += length;
+
+  return true;
+}
+
+bool assign_matched_binary_view(msg_seq_iter& f, const msg_seq_iter& l, binary_view* to_assign)
+{
+  assert(to_assign != 0);
+
+  size_t length = 0;
+  int padding_bits = 0;
+
+  if(!parse_binary_head(f, l, length, padding_bits))
+    return false;
+
+  const char* data = (0 == length) ? 0 : &*f;
+  frame_ptr frame = frame_scope::frame_containing(data, length);
+
+  // Not matching a received message (e.g. a matchable_range) => we have to copy.
+  if(!frame && (0 != length)) {
+    frame.reset(new msg_seq(f, f + length));
+    data = &(*frame)[0];
+  }
+
+  *to_assign = binary_view(frame, data, length, padding_bits);
+  f += length;
+
+  return true;
 }
 
 bool match_any_binary(msg_seq_iter& f, const msg_seq_iter& l, const any& match_any)
 {
-  msg_seq ignore_binary;
-  binary_value_type ignore_bit_seq;
   msg_seq_iter start = f;
+  size_t length = 0;
+  int padding_bits = 0;
 
-  if(binary_to_term<binary_ext>(f, l, ignore_binary))
-    return match_any.save_matched_bytes(msg_seq(start, f));
-  else if(binary_to_term<bit_binary_ext>(f, l, ignore_bit_seq))
-    return match_any.save_matched_bytes(msg_seq(start, f));
-  else
+  if(!parse_binary_head(f, l, length, padding_bits))
     return false;
+
+  f += length;
+
+  return match_any.save_matched_bytes(start, f);
 }
 
 bool match_ref_value(msg_seq_iter& f, const msg_seq_iter& l, const new_reference_type& val)
@@ -258,7 +293,7 @@ bool match_any_ref(msg_seq_iter& f, const msg_seq_iter& l, const any& match_any)
   new_reference_type ignore;
   msg_seq_iter start = f;
 
-  return binary_to_term<new_reference_ext_p>(f, l, ignore) ? match_any.save_matched_bytes(msg_seq(start, f)) : false;
+  return binary_to_term<new_reference_ext_p>(f, l, ignore) ? match_any.save_matched_bytes(start, f) : false;
 }
 
 }
@@ -266,17 +301,17 @@ bool match_any_ref(msg_seq_iter& f, const msg_seq_iter& l, const any& match_any)
 pid::pid(const e_pid& a_val)
   : val(a_val),
     e_pido_assign(0),
-    match_fn(bind(match_value, ::_1, ::_2, cref(val)))
+    match_any(0)
 {}
 
 pid::pid(e_pid* a_e_pido_assign)
   : e_pido_assign(a_e_pido_assign),
-    match_fn(bind(assign_matched, ::_1, ::_2, e_pido_assign))
+    match_any(0)
 {}
 
-pid::pid(const any& match_any)
+pid::pid(const any& a_match_any)
    : e_pido_assign(0),
-     match_fn(bind(match_any_pid, ::_1, ::_2, cref(match_any)))
+     match_any(&a_match_any)
 {}
 
 void pid::serialize(msg_seq_out_iter& out) const
@@ -286,9 +321,15 @@ void pid::serialize(msg_seq_out_iter& out) const
   term_to_binary<pid_ext_g>(out, p);
 }
 
-bool pid::match(msg_seq_iter& f, const msg_seq_iter& l) const
+size_t pid::encoded_size() const
 {
-  return match_fn(f, l);
+  // The tag, the node name (an atom), the ID, the serial and the creation.
+  return 1 + (3 + val.node_name.size()) + 4 + 4 + 1;
+}
+
+bool pid::match_as_any(msg_seq_iter& f, const msg_seq_iter& l) const
+{
+  return match_any_pid(f, l, *match_any);
 }
 
 float_::float_(double a_val)
@@ -310,6 +351,11 @@ void float_::serialize(msg_seq_out_iter& out) const
   term_to_binary<float_ext_g>(out, encode_float(val));
 }
 
+size_t float_::encoded_size() const
+{
+  return 1 + constants::float_digits;
+}
+
 bool float_::match(msg_seq_iter& f, const msg_seq_iter& l) const
 {
   return match_fn(f, l);
@@ -317,16 +363,17 @@ bool float_::match(msg_seq_iter& f, const msg_seq_iter& l) const
 
 atom::atom(const std::string& a_val)
   : val(a_val),
+    encoded(encode_atom(a_val)),
     to_assign(0),
-    match_fn(bind(match_atom_value, ::_1, ::_2, cref(val))) {}
+    match_any(0) {}
 
 atom::atom(std::string* a_to_assign)
   : to_assign(a_to_assign),
-    match_fn(bind(assign_matched_atom, ::_1, ::_2, to_assign)) {}
+    match_any(0) {}
 
-atom::atom(const any& match_any)
+atom::atom(const any& a_match_any)
    : to_assign(0),
-     match_fn(bind(match_any_atom, ::_1, ::_2, cref(match_any))) {}
+     match_any(&a_match_any) {}
 
 void atom::serialize(msg_seq_out_iter& out) const
 {
@@ -334,22 +381,41 @@ void atom::serialize(msg_seq_out_iter& out) const
   term_to_binary<atom_ext_g>(out, s);
 }
 
-bool atom::match(msg_seq_iter& f, const msg_seq_iter& l) const
+size_t atom::encoded_size() const
 {
-  return match_fn(f, l);
+  return 3 + val.size();
+}
+
+bool atom::match_as_any(msg_seq_iter& f, const msg_seq_iter& l) const
+{
+  return match_any_atom(f, l, *match_any);
+}
+
+pattern_key atom::key() const
+{
+  pattern_key k;
+
+  k.tag = type_tag::atom_ext;
+  k.has_atom = !to_assign && !match_any;
+  k.atom = val;
+
+  return k;
 }
 
 // Binary
 //
 binary::binary(const binary_value_type& a_val)
   : val(a_val),
-    to_assign(0),
-    match_fn(bind(match_binary_value, ::_1, ::_2, cref(val))) {}
+    to_assign(0) {}
 
 binary::binary(binary_value_type* a_to_assign)
   : to_assign(a_to_assign),
     match_fn(bind(assign_matched_binary, ::_1, ::_2, to_assign)) {}
 
+binary::binary(binary_view* a_to_assign)
+  : to_assign(0),
+    match_fn(bind(assign_matched_binary_view, ::_1, ::_2, a_to_assign)) {}
+
 binary::binary(const any& match_any)
    : to_assign(0),
      match_fn(bind(match_any_binary, ::_1, ::_2, cref(match_any))) {}
@@ -367,15 +433,21 @@ void binary::serialize(msg_seq_out_iter& out) const
   }
 }
 
+size_t binary::encoded_size() const
+{
+  const bool has_padding_bits = 0 < val.padding_bits;
+
+  return (has_padding_bits ? 6 : 5) + val.value.size();
+}
+
 bool binary::match(msg_seq_iter& f, const msg_seq_iter& l) const
 {
-  return match_fn(f, l);
+  return match_fn ? match_fn(f, l) : match_binary_value(f, l, val);
 }
 
 ref::ref(const new_reference_type& a_val)
   : val(a_val),
-    to_assign(0),
-    match_fn(bind(match_ref_value, ::_1, ::_2, cref(val))) {}
+    to_assign(0) {}
 
   // Used for assigning a match during pattern matching.
 ref::ref(new_reference_type* a_to_assign)
@@ -393,9 +465,15 @@ void ref::serialize(msg_seq_out_iter& out) const
   term_to_binary<new_reference_ext_g>(out, gtype);
 }
 
+size_t ref::encoded_size() const
+{
+  // The tag, the ID length, the node name (an atom), the creation and the ID.
+  return 1 + 2 + (3 + val.node_name.size()) + 1 + val.id.size();
+}
+
 bool ref::match(msg_seq_iter& f, const msg_seq_iter& l) const
 {
-  return match_fn(f, l);
+  return match_fn ? match_fn(f, l) : match_ref_value(f, l, val);
 }
 
 
@@ -22,8 +22,6 @@
 #include "ext_message_builder.h"
 #include "tinch_pp/erlang_types.h"
 #include "constants.h"
-#include <boost/function.hpp>
-#include <boost/bind.hpp>
 #include <algorithm>
 
 using namespace tinch_pp;
@@ -34,120 +32,67 @@ using namespace std;
 namespace {
 
   // Design: The different send methods are similiar, just the control message differs.
-  // Thus, we parameterize with a generator (basically emulating closures).
-  typedef function<void (msg_seq_out_iter&)> add_ctrl_msg_fn;
-     
-  void add_ctrl_message_send(msg_seq_out_iter& out, const tinch_pp::e_pid& destination_pid);
+  // Thus, we parameterize with the control message. It's given as a term, which 
+  // tells its encoded size => the whole message is sized before it's written.
+  msg_seq build(const object& ctrl_msg);
 
-  void add_ctrl_message_reg_send(msg_seq_out_iter& out, const tinch_pp::e_pid& self, const string& destination_name);
+  msg_seq build(const msg_seq& payload, const object& ctrl_msg);
 
-  void add_ctrl_message_exit(msg_seq_out_iter& out, 
-                               const int request, 
-                               const tinch_pp::e_pid& from, 
-                               const tinch_pp::e_pid& to,
-                               const string& reason);
-
-  void add_ctrl_message_linkage(msg_seq_out_iter& out, 
-                               const int request,
-                               const tinch_pp::e_pid& from, 
-                               const tinch_pp::e_pid& to);
-
-  msg_seq build(const add_ctrl_msg_fn& add_ctrl_msg);
-
-  msg_seq build(const msg_seq& payload, const add_ctrl_msg_fn& add_ctrl_msg);
+  const string no_cookie;
 }
 
 namespace tinch_pp {
  
 msg_seq build_send_msg(const msg_seq& payload, const e_pid& destination_pid)
 {
-  return build(payload, bind(&add_ctrl_message_send, _1, cref(destination_pid)));
+  // SEND: tuple of {2, Cookie, ToPid} 
+  return build(payload, make_e_tuple(int_(constants::ctrl_msg_send), atom(no_cookie), pid(destination_pid)));
 }
 
 msg_seq build_reg_send_msg(const msg_seq& payload, const e_pid& self, const string& destination_name)
 {
-  return build(payload, bind(&add_ctrl_message_reg_send, _1, cref(self), cref(destination_name)));
+  // REG_SEND: tuple of {6, FromPid, Cookie, ToName} 
+  return build(payload, make_e_tuple(int_(constants::ctrl_msg_reg_send), pid(self), atom(no_cookie), atom(destination_name)));
 }
 
+// Used when a linked mailbox dies.
+// EXIT and EXIT2: tuple of {request, FromPid, ToPid, Reason}
 msg_seq build_exit_msg(const e_pid& from_pid, const e_pid& to_pid, const std::string& reason)
 {
-  return build(bind(&add_ctrl_message_exit, _1, constants::ctrl_msg_exit, cref(from_pid), cref(to_pid), cref(reason)));
+  return build(make_e_tuple(int_(constants::ctrl_msg_exit), pid(from_pid), pid(to_pid), atom(reason)));
 }
 
 msg_seq build_exit2_msg(const e_pid& from_pid, const e_pid& to_pid, const std::string& reason)
 {
-  return build(bind(&add_ctrl_message_exit, _1, constants::ctrl_msg_exit2, cref(from_pid), cref(to_pid), cref(reason)));
+  return build(make_e_tuple(int_(constants::ctrl_msg_exit2), pid(from_pid), pid(to_pid), atom(reason)));
 }
 
+// LINK and UNLINK: tuple of {request, FromPid, ToPid}
 msg_seq build_link_msg(const e_pid& from_pid, const e_pid& to_pid)
 {
-  return build(bind(&add_ctrl_message_linkage, _1, constants::ctrl_msg_link, cref(from_pid), cref(to_pid)));
+  return build(make_e_tuple(int_(constants::ctrl_msg_link), pid(from_pid), pid(to_pid)));
 }
 
 msg_seq build_unlink_msg(const e_pid& from_pid, const e_pid& to_pid)
 {
-  return build(bind(&add_ctrl_message_linkage, _1, constants::ctrl_msg_unlink, cref(from_pid), cref(to_pid)));
+  return build(make_e_tuple(int_(constants::ctrl_msg_unlink), pid(from_pid), pid(to_pid)));
 }
 
 }
 
 namespace {
 
- void add_message_header(msg_seq_out_iter& out)
-  {
-    *out++ = constants::pass_through;
-    *out++ = constants::magic_version;
-  }
-
-  // Used when sending to a PID.
-  void add_ctrl_message_send(msg_seq_out_iter& out, const tinch_pp::e_pid& destination_pid)
-  {
-    add_message_header(out);
-
-    const string no_cookie;
-
-    // SEND: tuple of {2, Cookie, ToPid} 
-    make_e_tuple(int_(constants::ctrl_msg_send), atom(no_cookie), pid(destination_pid)).serialize(out);
-  }
-
-  // Used when sending to a registered name on a node.
-  void add_ctrl_message_reg_send(msg_seq_out_iter& out, const tinch_pp::e_pid& self, const string& destination_name)
-  {
-    add_message_header(out);
-
-    const std::string no_cookie;
-
-    // REG_SEND: tuple of {6, FromPid, Cookie, ToName} 
-    make_e_tuple(int_(constants::ctrl_msg_reg_send), pid(self), atom(no_cookie), atom(destination_name)).serialize(out);
-  }
+  const size_t header_size = 4;
 
-  // Used when a linked mailbox dies.
-  void add_ctrl_message_exit(msg_seq_out_iter& out, 
-                             const int request, 
-                             const tinch_pp::e_pid& from, 
-                             const tinch_pp::e_pid& to,
-                             const string& reason)
-  {
-    add_message_header(out);
+  // The pass through and the version magic preceeding the control message.
+  const size_t ctrl_msg_head_size = 2;
 
-    // EXIT and EXIT2: tuple of {request, FromPid, ToPid, Reason}
-    make_e_tuple(int_(request), pid(from), pid(to), atom(reason)).serialize(out);
-  }
-
-  // Reused for both link and unlink messages (same layout).
-  void add_ctrl_message_linkage(msg_seq_out_iter& out, 
-                               const int request,
-                               const tinch_pp::e_pid& from, 
-                               const tinch_pp::e_pid& to)
+  void add_message_header(msg_seq_out_iter& out)
   {
-    add_message_header(out);
-
-    // LINK and UNLINK: tuple of {request, FromPid, ToPid}
-    make_e_tuple(int_(request), pid(from), pid(to)).serialize(out);
+    *out++ = constants::pass_through;
+    *out++ = constants::magic_version;
   }
 
-  const size_t header_size = 4;
-
   void fill_in_message_size(msg_seq& msg)
   {
     const size_t size = msg.size() - header_size;
@@ -165,25 +110,30 @@ namespace {
     copy(payload.begin(), payload.end(), out);
   }
 
-  msg_seq build(const add_ctrl_msg_fn& add_ctrl_msg)
+  msg_seq build(const object& ctrl_msg)
   {
     msg_seq msg(header_size);
     msg_seq_out_iter out(msg);
 
-    add_ctrl_msg(out);
+    add_message_header(out);
+    ctrl_msg.serialize(out);
 
     fill_in_message_size(msg);
 
     return msg;
   }
 
-  msg_seq build(const msg_seq& payload, const add_ctrl_msg_fn& add_ctrl_msg)
+  msg_seq build(const msg_seq& payload, const object& ctrl_msg)
   {
-    msg_seq msg(header_size);
-    msg_seq_out_iter out(msg);
+    // The payload dominates the message; the buffer is allocated once, before anything is written.
+    msg_seq msg;
+    msg.reserve(header_size + ctrl_msg_head_size + ctrl_msg.encoded_size() + 1 + payload.size());
+    msg.resize(header_size);
 
-    add_ctrl_msg(out);
+    msg_seq_out_iter out(msg);
 
+    add_message_header(out);
+    ctrl_msg.serialize(out);
     append_payload(out, payload);
 
     fill_in_message_size(msg);
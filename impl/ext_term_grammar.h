@@ -45,6 +45,7 @@ namespace tinch_pp {
 
 namespace type_tag {
   const int bit_binary_ext    = 77;
+  const int compressed_ext    = 80;
   const int atom_cache_ref    = 82;
   const int small_integer     = 97;
   const int integer           = 98;
@@ -57,6 +58,7 @@ namespace type_tag {
   const int list              = 108;
   const int binary_ext        = 109;
   const int new_reference_ext = 114;
+  const int map_ext           = 116;
 }
 
 template<const int tag>
@@ -300,6 +302,58 @@ struct list_head_g : karma::grammar<msg_seq_out_iter, size_t()>
   karma::rule<msg_seq_out_iter, size_t()> start;
 };
 
+// A map is encoded as its number of associations (key-value pairs) followed by 
+// the keys and values in alternating order: K1, V1, K2, V2, ...
+struct map_head_ext : qi::grammar<msg_seq_iter, size_t()>
+{
+  map_head_ext() : base_type(start)
+  {
+    using namespace qi;
+
+    start = omit[byte_(type_tag::map_ext)] >> big_dword;
+  }
+
+  qi::rule<msg_seq_iter, size_t()> start;
+};
+
+struct map_head_g : karma::grammar<msg_seq_out_iter, size_t()>
+{
+  map_head_g() : base_type(start)
+  {
+    using namespace karma;
+
+    start = byte_(type_tag::map_ext) << big_dword;
+  }
+
+  karma::rule<msg_seq_out_iter, size_t()> start;
+};
+
+// A compressed term (term_to_binary(Term, [compressed])) is encoded as the size of 
+// the uncompressed term followed by the zlib compressed term (without version magic).
+struct compressed_head_ext : qi::grammar<msg_seq_iter, size_t()>
+{
+  compressed_head_ext() : base_type(start)
+  {
+    using namespace qi;
+
+    start = omit[byte_(type_tag::compressed_ext)] >> big_dword;
+  }
+
+  qi::rule<msg_seq_iter, size_t()> start;
+};
+
+struct compressed_head_g : karma::grammar<msg_seq_out_iter, size_t()>
+{
+  compressed_head_g() : base_type(start)
+  {
+    using namespace karma;
+
+    start = byte_(type_tag::compressed_ext) << big_dword;
+  }
+
+  karma::rule<msg_seq_out_iter, size_t()> start;
+};
+
 // String does NOT have a corresponding Erlang representation, but is an optimization for sending 
 // lists of bytes (integer in the range 0-255) more efficiently over the distribution.
 struct string_head_ext : qi::grammar<msg_seq_iter, size_t()>
@@ -392,6 +446,32 @@ struct bit_binary_ext_g : karma::grammar<msg_seq_out_iter, serializable_bit_seq(
   karma::rule<msg_seq_out_iter, serializable_bit_seq()> start;
 };
 
+// The headers of the binaries, used to refer to the binary data without copying it.
+struct binary_head_ext : qi::grammar<msg_seq_iter, size_t()>
+{
+  binary_head_ext() : base_type(start)
+  {
+    using namespace qi;
+
+    start = omit[byte_(type_tag::binary_ext)] >> big_dword;
+  }
+
+  qi::rule<msg_seq_iter, size_t()> start;
+};
+
+// Note that the header of a bit-string is followed by the padding (one byte).
+struct bit_binary_head_ext : qi::grammar<msg_seq_iter, size_t()>
+{
+  bit_binary_head_ext() : base_type(start)
+  {
+    using namespace qi;
+
+    start = omit[byte_(type_tag::bit_binary_ext)] >> big_dword;
+  }
+
+  qi::rule<msg_seq_iter, size_t()> start;
+};
+
 //
 
 }
@@ -26,6 +26,7 @@
 #include "control_msg_exit2.h"
 #include "control_msg_link.h"
 #include "control_msg_unlink.h"
+#include "tinch_pp/exceptions.h"
 
 using namespace tinch_pp;
 
@@ -73,12 +74,22 @@ struct link_operations_on_remote_node : link_operation_dispatcher_type
      requester(a_requester)
   {}
 
+  // Linked before the request: a queued link request may fail (the node is 
+  // unreachable) before the requester returns.
   void link(const e_pid& local_pid, const e_pid& remote_pid)
   {
-    control_msg_link link_msg(local_pid, remote_pid);
-    requester(link_msg, remote_pid.node_name);
-
     mailbox_linker.link(local_pid, remote_pid);
+
+    try {
+      control_msg_link link_msg(local_pid, remote_pid);
+      requester(link_msg, remote_pid.node_name);
+    } catch(const connection_io_error&) {
+      // The connection has failed already => the link breaks as the node is 
+      // reported unreachable (see node_access::node_unreachable), as in Erlang.
+    } catch(...) {
+      mailbox_linker.unlink(local_pid, remote_pid);
+      throw;
+    }
   }
 
   void unlink(const e_pid& local_pid, const e_pid& remote_pid)
@@ -80,6 +80,28 @@ void linker::close_links_for_local(const e_pid& dying_process, const string& rea
   on_broken_links(exit2_request, dying_process);
 }
 
+linker::links_type linker::remove_links_to_node(const std::string& node_name)
+{
+  const mutex_guard guard(links_lock);
+
+  links_type removed_links;
+  links_type::iterator i = established_links.begin();
+
+  while(i != established_links.end()) {
+    if(i->first.node_name == node_name) {
+      removed_links.push_back(std::make_pair(i->second, i->first));
+      i = established_links.erase(i);
+    } else if(i->second.node_name == node_name) {
+      removed_links.push_back(*i);
+      i = established_links.erase(i);
+    } else {
+      ++i;
+    }
+  }
+
+  return removed_links;
+}
+
 void linker::establish_link_between(const e_pid& pid1, const e_pid& pid2)
 {
   established_links.push_back(std::make_pair(pid1, pid2));
@@ -27,6 +27,7 @@
 #include <boost/thread/mutex.hpp>
 #include <boost/function.hpp>
 #include <utility>
+#include <string>
 #include <list>
 
 namespace tinch_pp {
@@ -53,6 +54,13 @@ public:
   // This is an controlled shutdown, explicitly requested by the user (distributed operation = EXIT2).
   void close_links_for_local(const e_pid& dying_process, const std::string& reason);
 
+  typedef std::pair<e_pid, e_pid> link_type;
+  typedef std::list<link_type> links_type;
+
+  // The connection to the given node is down => all links to its processes are broken.
+  // Removes those links and returns them as (local pid, remote pid).
+  links_type remove_links_to_node(const std::string& node_name);
+
 private:
   void establish_link_between(const e_pid& pid1, const e_pid& pid2);
 
@@ -73,9 +81,6 @@ private:
   // the I/O thread. We always lock on API level before delegating to worker functions.
   boost::mutex links_lock;
 
-  typedef std::pair<e_pid, e_pid> link_type;
-  typedef std::list<link_type> links_type;
-
   links_type established_links;
 };
 
@@ -23,12 +23,24 @@
 #define LIST_MATCHER_H
 
 #include "impl/ext_term_grammar.h"
+#include "impl/term_decoder.h"
 #include <boost/bind.hpp>
 #include <algorithm>
+#include <vector>
 
 namespace tinch_pp {
 namespace detail {
 
+// Contiguous sequences are allocated once, given the number of elements to assign.
+template<typename T>
+void reserve_elements(T&, size_t) {}
+
+template<typename T, typename A>
+void reserve_elements(std::vector<T, A>& val, size_t n)
+{
+  val.reserve(val.size() + n);
+}
+
 // TODO: We probably have to handle the reception of a list with hetereogenous types in 
 // a specialization.
 template<typename T>
@@ -39,9 +51,8 @@ struct list_matcher
     using namespace boost;
 
     size_t parsed_length = 0;
-    list_head_ext list_head_p;
 
-    const bool success = qi::parse(f, l, list_head_p, parsed_length);
+    const bool success = decoder::decode_list_head(f, l, parsed_length);
     const bool length_matched = success && (val.size() == parsed_length);
 
     // TODO: this code only handles proper Erlang lists (the ones ending with a cdr of nil).
@@ -50,7 +61,7 @@ struct list_matcher
 					                                        std::find_if(val.begin(), val.end(), 
                                                 bind(&erl::object::match, ::_1, boost::ref(f), cref(l)) == false));
     // TODO: check once we're handling lists properly!
-    qi::parse(f, l, qi::byte_(tinch_pp::type_tag::nil_ext));
+    decoder::decode_nil(f, l);
 
     return matched;
   }
@@ -60,9 +71,13 @@ struct list_matcher
     using namespace boost;
 
     size_t parsed_length = 0;
-    list_head_ext list_head_p;
 
-    bool success = qi::parse(f, l, list_head_p, parsed_length);
+    bool success = decoder::decode_list_head(f, l, parsed_length);
+
+    // Each element takes at least a byte => a corrupt length doesn't make us reserve 
+    // more than the rest of the message could hold.
+    if(success)
+      reserve_elements(*val, std::min(parsed_length, static_cast<size_t>(l - f)));
 
     for(size_t i = 0; success && (i < parsed_length); ++i) {
       typename T::value_type::value_type to_assign;
@@ -76,7 +91,7 @@ struct list_matcher
 
     // TODO: this code only handles proper Erlang lists (the ones ending with a cdr of nil).
     // Ensure that we can handle improper lists( [a|b] ) too (parse one more element, different length check).
-    return success && qi::parse(f, l, qi::byte_(tinch_pp::type_tag::nil_ext));
+    return success && decoder::decode_nil(f, l);
   }
 };
 
@@ -25,16 +25,37 @@
 using namespace tinch_pp;
 
 matchable_seq::matchable_seq(const msg_seq& erlang_msg)
-  : matchable_msg(erlang_msg)
+  : frame(new msg_seq(erlang_msg)),
+    payload_offset(0),
+    payload_length(erlang_msg.size()),
+    index(payload_offset)
 {
 }
 
+matchable_seq::matchable_seq(const received_msg& erlang_msg)
+  : frame(erlang_msg.frame),
+    payload_offset(erlang_msg.payload_offset),
+    payload_length(erlang_msg.frame->size() - erlang_msg.payload_offset),
+    index(payload_offset)
+{
+}
+
+matchable_seq::matchable_seq(const frame_ptr& a_frame, size_t offset, size_t length)
+  : frame(a_frame),
+    payload_offset(offset),
+    payload_length(length),
+    index(payload_offset)
+{
+}
 
 bool matchable_seq::match(const erl::object& pattern) const
 {
-  msg_seq_iter first = matchable_msg.begin();
-  msg_seq_iter last = matchable_msg.end();
+  // Allow the pattern to refer to our frame (e.g. binary views) and to skip 
+  // subterms through its index.
+  const frame_scope scope(frame, &index);
+
+  msg_seq_iter first = frame->begin() + payload_offset;
+  msg_seq_iter last = first + payload_length;
 
   return pattern.match(first, last);
 }
-
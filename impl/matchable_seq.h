@@ -23,18 +23,35 @@
 #define MATCHABLE_SEQ_H
 
 #include "tinch_pp/matchable.h"
+#include "received_msg.h"
+#include "term_index.h"
 
 namespace tinch_pp {
 
+// The index of the message is built by the first match that skips a subterm and 
+// used by the later ones (see term_index.h). The matchables captured from it only 
+// share its (never modified) frame; they have indices of their own.
 class matchable_seq : public matchable
 {
 public:
   matchable_seq(const msg_seq& erlang_msg);
 
+  // Shares the frame of the received message instead of copying the payload.
+  matchable_seq(const received_msg& erlang_msg);
+
+  // A view of the term of the given length at the given offset into a shared 
+  // frame (e.g. a part of a message captured by erl::any).
+  matchable_seq(const frame_ptr& frame, size_t offset, size_t length);
+
  virtual bool match(const erl::object& pattern) const;
 
 private:
-  mutable msg_seq matchable_msg;
+  frame_ptr frame;
+  size_t payload_offset;
+  size_t payload_length;
+
+  // Shared by all matches on this message (e.g. the clauses of a receive loop).
+  term_index index;
 };
 
 }
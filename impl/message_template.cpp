@@ -0,0 +1,135 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "tinch_pp/message_template.h"
+#include "tinch_pp/exceptions.h"
+#include <boost/thread/tss.hpp>
+#include <boost/lexical_cast.hpp>
+#include <algorithm>
+
+using namespace tinch_pp;
+using namespace tinch_pp::erl;
+
+namespace {
+
+// Records the offsets of the holes as the shape of a template is encoded.
+struct hole_recorder
+{
+  hole_recorder(const msg_seq& an_encoded, std::vector<size_t>& an_offsets)
+    : encoded(an_encoded), offsets(an_offsets) {}
+
+  const msg_seq& encoded;
+  std::vector<size_t>& offsets;
+};
+
+// The recorder lives on the stack of the constructing template => nothing to clean-up.
+void no_cleanup(hole_recorder*) {}
+
+boost::thread_specific_ptr<hole_recorder> current_recorder(no_cleanup);
+
+// Installs the recorder of a template under construction. A template may be 
+// constructed while another one is encoded (e.g. by the serialize of a value 
+// in its shape); the recorder of the enclosing template is restored afterwards.
+class recording_scope : boost::noncopyable
+{
+public:
+  explicit recording_scope(hole_recorder& recorder)
+    : previous(current_recorder.get())
+  {
+    current_recorder.reset(&recorder);
+  }
+
+  ~recording_scope()
+  {
+    current_recorder.reset(previous);
+  }
+
+private:
+  hole_recorder* previous;
+};
+
+// The buffer is reserved for the whole message before it's serialized (see 
+// encoded_size) => the constant parts are appended without reallocations.
+void append(msg_seq_out_iter& out, const msg_seq& encoded, size_t from, size_t to)
+{
+  std::copy(encoded.begin() + from, encoded.begin() + to, out);
+}
+
+}
+
+void hole::serialize(msg_seq_out_iter& out) const
+{
+  hole_recorder* recorder = current_recorder.get();
+
+  if(!recorder)
+    throw tinch_pp_exception("A hole can only be serialized as part of a message_template.");
+
+  recorder->offsets.push_back(recorder->encoded.size());
+}
+
+message_template::message_template(const object& shape)
+{
+  hole_recorder recorder(encoded, hole_offsets);
+
+  {
+    const recording_scope recording(recorder);
+
+    msg_seq_out_iter out(encoded);
+    shape.serialize(out);
+  }
+
+  if(hole_offsets.size() > MAX_TEMPLATE_HOLES)
+    throw tinch_pp_exception("Too many holes in the message_template (max " + 
+                             boost::lexical_cast<std::string>(MAX_TEMPLATE_HOLES) + ").");
+}
+
+message_template::filled::filled(const message_template& a_owner, const values_type& a_values, size_t a_size)
+  : owner(a_owner),
+    values(a_values)
+{
+  if(a_size != owner.number_of_holes())
+    throw tinch_pp_exception("The message_template has " + boost::lexical_cast<std::string>(owner.number_of_holes()) + 
+                             " holes but was filled with " + boost::lexical_cast<std::string>(a_size) + " values.");
+}
+
+void message_template::filled::serialize(msg_seq_out_iter& out) const
+{
+  const std::vector<size_t>& holes = owner.hole_offsets;
+  size_t constant_start = 0;
+
+  for(size_t i = 0; i < holes.size(); ++i) {
+    append(out, owner.encoded, constant_start, holes[i]);
+    values[i]->serialize(out);
+    constant_start = holes[i];
+  }
+
+  append(out, owner.encoded, constant_start, owner.encoded.size());
+}
+
+size_t message_template::filled::encoded_size() const
+{
+  size_t size = owner.encoded.size();
+
+  for(size_t i = 0; i < owner.number_of_holes(); ++i)
+    size += values[i]->encoded_size();
+
+  return size;
+}
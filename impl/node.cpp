@@ -20,12 +20,18 @@
 // NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
 // ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "actual_node.h"
+#include "constants.h"
 
 using namespace tinch_pp;
 
 node_ptr node::create(const std::string& node_name, const std::string& cookie)
 {
-  node_ptr created_node(new actual_node(node_name, cookie));
+  return create(node_name, cookie, constants::epmd_port);
+}
+
+node_ptr node::create(const std::string& node_name, const std::string& cookie, port_number_type epmd_port)
+{
+  node_ptr created_node(new actual_node(node_name, cookie, epmd_port));
 
   return created_node;
 }
@@ -23,6 +23,7 @@
 #define NODE_ACCESS_H
 
 #include "types.h"
+#include "received_msg.h"
 
 namespace tinch_pp {
 
@@ -46,6 +47,9 @@ public:
 
   virtual std::string cookie() const = 0;
 
+  // The maximum number of bytes queued for a node while connecting to it.
+  virtual size_t max_pending_bytes() const = 0;
+
   virtual void deliver(const msg_seq& msg, const e_pid& to) = 0;
 
   virtual void deliver(const msg_seq& msg, const std::string& to) = 0;
@@ -57,9 +61,9 @@ public:
 
   // TODO: Extract a separate interface for the Erlang operations.
 
-  virtual void receive_incoming(const msg_seq& msg, const e_pid& to) = 0;
+  virtual void receive_incoming(const received_msg& msg, const e_pid& to) = 0;
 
-  virtual void receive_incoming(const msg_seq& msg, const std::string& to) = 0;
+  virtual void receive_incoming(const received_msg& msg, const std::string& to) = 0;
 
   virtual void incoming_link(const e_pid& from, const e_pid& to) = 0;
 
@@ -68,7 +72,20 @@ public:
   virtual void incoming_exit(const e_pid& from, const e_pid& to, const std::string& reason) = 0;
 
   virtual void incoming_exit2(const e_pid& from, const e_pid& to, const std::string& reason) = 0;
-};
+
+  // Invoked as a connection to the given node has been established.
+  virtual void node_up(const std::string& peer_node) = 0;
+
+  // Invoked, in the I/O context, as a connection attempt to the given node fails.
+  // The requests queued for the node are dropped; the links to it break.
+  virtual void node_unreachable(const std::string& peer_node) = 0;
+
+  // Invoked, in the I/O context, as the connection to the given node is lost, or 
+  // replaced by a new connection from the node (see node_connector).
+  virtual void node_down(const std::string& peer_node) = 0;
+
+  // Subscribes (or unsubscribes) the given mailbox to nodeup/nodedown messages.
+  virtual void monitor_nodes(const e_pid& subscriber, bool on) = 0;};
 
 }
 
@@ -22,6 +22,7 @@
 #include "node_async_tcp_ip.h"
 #include "utils.h"
 #include <boost/bind.hpp>
+#include <boost/thread/locks.hpp>
 #include <cassert>
 
 using namespace tinch_pp;
@@ -61,6 +62,8 @@ void node_async_tcp_ip::trigger_read(const message_read_fn& callback,
 
 void node_async_tcp_ip::trigger_write(const msg_seq& msg, const message_written_fn& callback)
 {
+   const lock_guard<mutex> lock(write_queue_mutex);
+
    // Store the message in a write queue; we must ensure that it lives for the duration of the operation.
    const bool write_in_progress = !write_queue.empty();
    write_queue.push_back(msg_and_callback(msg, callback));
@@ -96,22 +99,26 @@ void node_async_tcp_ip::checked_read(const message_read_fn& callback,
 void node_async_tcp_ip::checked_write(const boost::system::error_code& error,
 				                                  size_t bytes_transferred)
 {
-   assert(!write_queue.empty());
-
    if(error) {
       error_handler(error);
       return;
    }
 
-   const message_written_fn callback = callback_fn(write_queue.front());
+   message_written_fn callback;
+   {
+      const lock_guard<mutex> lock(write_queue_mutex);
+      assert(!write_queue.empty());
 
-   write_queue.pop_front();
+      callback = callback_fn(write_queue.front());
 
-   if(!write_queue.empty()) {
-      asio::async_write(connection, asio::buffer(message(write_queue.front())), 
-                       bind(&node_async_tcp_ip::checked_write, this, 
-                       asio::placeholders::error,
-                       asio::placeholders::bytes_transferred));
+      write_queue.pop_front();
+
+      if(!write_queue.empty()) {
+         asio::async_write(connection, asio::buffer(message(write_queue.front())), 
+                          bind(&node_async_tcp_ip::checked_write, this, 
+                          asio::placeholders::error,
+                          asio::placeholders::bytes_transferred));
+      }
    }
 
    callback();
@@ -26,6 +26,7 @@
 #include <boost/utility.hpp>
 #include <boost/asio.hpp>
 #include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
 #include <deque>
 #include <utility>
 
@@ -78,6 +79,9 @@ private:
   typedef std::pair<msg_seq, message_written_fn> msg_and_callback;
   typedef std::deque<msg_and_callback> write_queue_type;
   write_queue_type write_queue;
+
+  // Writes are requested by the sending threads as well as by the async I/O context.
+  boost::mutex write_queue_mutex;
 };
 
 }
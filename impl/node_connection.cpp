@@ -24,9 +24,12 @@
 #include "node_access.h"
 #include "control_msg.h"
 #include "node_connection_state.h"
+#include "tinch_pp/exceptions.h"
+#include "constants.h"
 
 #include <boost/bind.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/thread/locks.hpp>
 #include <sstream>
 
 // Design
@@ -43,6 +46,14 @@ using namespace tinch_pp;
 using namespace boost;
 using  boost::asio::ip::tcp;
 
+namespace {
+
+void ignore_written()
+{
+}
+
+}
+
 node_connection_ptr node_connection::create(asio::io_service& io_service, 
 					    node_access& node,
 					    const std::string& peer_node)
@@ -70,24 +81,32 @@ void node_connection::init()
 node_connection::node_connection(asio::io_service& io_service, 
 				                             node_access& a_node,
 				                             const std::string& a_peer_node)
-  : connection(io_service),
+  : io_service_(io_service),
+    connection(io_service),
     node(a_node),
     async_tcp_ip(connection, bind(&node_connection::handle_io_error, this, ::_1)),
-    peer_name(utils::node_name(a_peer_node)),
+    peer_name(a_peer_node), // the full name, as known by the node_connector
     node_name(node.name()),
     received_msgs(&handshake_msgs),
-    own_challenge_(0)
+    handshake_timer(io_service),
+    own_challenge_(0),
+    pending_bytes(0),
+    connected(false)
 { 
 }
 
 node_connection::node_connection(asio::io_service& io_service,
 				                             node_access& a_node)
-  : connection(io_service),
+  : io_service_(io_service),
+    connection(io_service),
     node(a_node),
     async_tcp_ip(connection, bind(&node_connection::handle_io_error, this, ::_1)),
     node_name(node.name()),
     received_msgs(&handshake_msgs),
-    own_challenge_(0)
+    handshake_timer(io_service),
+    own_challenge_(0),
+    pending_bytes(0),
+    connected(false)
 {
 }
 
@@ -111,33 +130,167 @@ void node_connection::start_handshake_as_A(const handshake_success_fn_type& hand
 
 // other node is originator
 void node_connection::start_handshake_as_B(const handshake_success_fn_type& handshake_success_fn,
+                                           const peer_status_fn_type& peer_status_fn,
                                            challenge_type own_challenge)
 {
   handshake_success.connect(handshake_success_fn);
+  peer_status = peer_status_fn;
   own_challenge_ = own_challenge;
+  start_handshake_timer();
   state->read_incoming_handshake();
 }
 
+std::string node_connection::status_for_peer(const std::string& name) const
+{
+  return peer_status ? peer_status(name) : std::string("ok");
+}
+
+// The timer keeps the connection alive until it's either cancelled or expired.
+void node_connection::start_handshake_timer()
+{
+  handshake_timer.expires_from_now(posix_time::seconds(constants::handshake_timeout_sec));
+  handshake_timer.async_wait(bind(&node_connection::handshake_timed_out, 
+                                  dynamic_pointer_cast<node_connection>(shared_from_this()), 
+                                  asio::placeholders::error));
+}
+
+void node_connection::handshake_timed_out(const boost::system::error_code& error)
+{
+  if(error == asio::error::operation_aborted)
+    return;
+
+  {
+    lock_guard<mutex> lock(requests_mutex);
+
+    if(connected)
+      return;
+  }
+
+  report_failure("The handshake timed out");
+}
+
 void node_connection::request(control_msg& distributed_operation)
 {
-  distributed_operation.execute(state);
+  lock_guard<mutex> lock(requests_mutex);
+
+  if(forwarded) {
+    forwarded->request(distributed_operation);
+    return;
+  }
+
+  if(failure)
+    throw connection_io_error("No connection to the node = " + node_name_or_unknown() + ": " + *failure, 
+                              node_name_or_unknown());
+
+  if(connected)
+    distributed_operation.execute(state);
+  else
+    distributed_operation.execute(queueing_state(shared_from_this()));
+}
+
+void node_connection::fail_pending_requests(const std::string& reason)
+{
+  lock_guard<mutex> lock(requests_mutex);
+
+  if(failure || forwarded)
+    return;
+
+  failure = reason;
+
+  pending_requests.clear();
+  pending_bytes = 0;
+
+  release_state();
+}
+
+void node_connection::forward_to(node_connection_ptr winner)
+{
+  lock_guard<mutex> lock(requests_mutex);
+
+  {
+    lock_guard<mutex> winner_lock(winner->requests_mutex);
+
+    for(std::deque<msg_seq>::const_iterator i = pending_requests.begin(); i != pending_requests.end(); ++i)
+      winner->write_or_queue(*i);
+  }
+
+  pending_requests.clear();
+  pending_bytes = 0;
+  forwarded = winner;
+}
+
+// Invoked with the mutex locked.
+void node_connection::write_or_queue(const msg_seq& msg)
+{
+  if(connected) {
+    async_tcp_ip.trigger_write(msg, &ignore_written);
+  } else {
+    pending_requests.push_back(msg);
+    pending_bytes += msg.size();
+  }
 }
 
 void node_connection::handshake_complete()
 {
+  handshake_timer.cancel();
+
   // Erlang uses a diferent message format once connected.
   received_msgs = &connected_msgs;
 
+  {
+    lock_guard<mutex> lock(requests_mutex);
+
+    for(std::deque<msg_seq>::const_iterator i = pending_requests.begin(); i != pending_requests.end(); ++i)
+      async_tcp_ip.trigger_write(*i, &ignore_written);
+
+    pending_requests.clear();
+    pending_bytes = 0;
+    connected = true;
+  }
+
   handshake_success(true);
 }
 
+// The queued requests are left to the node_connector: in case of a simultaneous 
+// connect, another connection may take them over.
 void node_connection::report_failure(const std::string& reason)
 {
-  state = initial_state(shared_from_this());
+  handshake_timer.cancel();
+
+  boost::system::error_code ignored;
+  connection.close(ignored);
+
+  release_state();
 
   handshake_success(false);
 }
 
+void node_connection::close(const std::string& reason)
+{
+  {
+    lock_guard<mutex> lock(requests_mutex);
+
+    if(!failure)
+      failure = reason;
+  }
+
+  boost::system::error_code ignored;
+  connection.close(ignored);
+
+  release_state();
+}
+
+// Later requests fail at once; the node_connector creates a new connection for the node.
+void node_connection::report_connection_lost(const std::string& reason)
+{
+  close(reason);
+}
+
+void node_connection::report_closed()
+{
+  release_state();
+}
+
 connection_state_ptr node_connection::change_state(connection_state_ptr new_state)
 {
   state = new_state;
@@ -156,12 +309,25 @@ void node_connection::trigger_checked_write(const msg_seq& msg,
   async_tcp_ip.trigger_write(msg, callback);
 }
 
-void node_connection::deliver_received(const msg_seq& msg, const e_pid& to)
+// Invoked by request, i.e. with the mutex locked.
+void node_connection::queue_until_connected(const msg_seq& msg)
+{
+  const size_t limit = node.max_pending_bytes();
+
+  if(pending_bytes + msg.size() > limit)
+    throw tinch_pp_exception("Too many bytes pending while connecting to the node = " + node_name_or_unknown() + 
+                             " (the limit is " + lexical_cast<std::string>(limit) + " bytes).");
+
+  pending_requests.push_back(msg);
+  pending_bytes += msg.size();
+}
+
+void node_connection::deliver_received(const received_msg& msg, const e_pid& to)
 {
   node.receive_incoming(msg, to);
 }
 
-void node_connection::deliver_received(const msg_seq& msg, const std::string& to)
+void node_connection::deliver_received(const received_msg& msg, const std::string& to)
 {
   node.receive_incoming(msg, to);
 }
@@ -191,7 +357,24 @@ void node_connection::handle_io_error(const boost::system::error_code& error)
   std::stringstream out;
   out << error;
 
-  state->handle_io_error(out.str());
+  // The state may change as it handles the error => keep it alive meanwhile.
+  const connection_state_ptr current = state;
+  current->handle_io_error(out.str());
+}
+
+namespace { void keep_alive(node_connection_ptr) {} }
+
+// The handlers of the closed socket are already queued => the one posted here runs after them.
+void node_connection::release_state()
+{
+  state = closed_state();
+
+  io_service_.post(bind(&keep_alive, static_pointer_cast<node_connection>(shared_from_this())));
+}
+
+std::string node_connection::node_name_or_unknown() const
+{
+  return peer_name ? *peer_name : std::string("<unknown>");
 }
 
 std::string node_connection::peer_node_name() const
@@ -28,11 +28,17 @@
 #include <boost/optional.hpp>
 #include <boost/signal.hpp>
 #include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+#include <deque>
 
 namespace tinch_pp {
 
 typedef boost::function<void (bool /*success*/)> handshake_success_fn_type;
 
+// Decides the status sent to a connecting node (e.g. "ok" or, upon simultaneous 
+// connection attempts, "ok_simultaneous" or "nok").
+typedef boost::function<std::string (const std::string& /*peer node*/)> peer_status_fn_type;
+
 class control_msg;
 class node_access;
 class node_connection;
@@ -59,13 +65,33 @@ public:
   virtual std::string peer_node_name() const;
 
   // See distribution_handshake.txt in the Erlang release.
+  // An incoming handshake not completed within constants::handshake_timeout_sec fails. 
+  // An outgoing one is bounded by the node_connector, together with the rest of the setup.
   void start_handshake_as_A(const handshake_success_fn_type& handshake_success_fn, challenge_type own_challenge);
-  void start_handshake_as_B(const handshake_success_fn_type& handshake_success_fn, challenge_type own_challenge);
+  void start_handshake_as_B(const handshake_success_fn_type& handshake_success_fn, 
+                            const peer_status_fn_type& peer_status_fn,
+                            challenge_type own_challenge);
 
   // A control_msg encodes a distributed operation sent to another node.
   // Examples of such operations are: link, unlink, send, etc.
+  // Until the handshake is complete, the operations are queued (up to the node's 
+  // limit of pending bytes) and written in order once connected.
+  // Throws connection_io_error in case the connection attempt has failed and 
+  // tinch_pp_exception in case the limit is reached.
   void request(control_msg& distributed_operation);
 
+  // Drops the queued operations of a failed connection attempt. All later requests fail.
+  void fail_pending_requests(const std::string& reason);
+
+  // Used as this (outgoing) connection attempt lost a simultaneous connect to the winner 
+  // (an incoming connection from the same node). The queued operations, as well as all 
+  // later requests, are passed on to the winner.
+  void forward_to(node_connection_ptr winner);
+
+  // Closes the connection without reporting a failure (e.g. as it's replaced by a new 
+  // connection from the same node). All later requests fail with the given reason.
+  void close(const std::string& reason);
+
 private:
   // Because we would need shared_from_this in the constructor, which isn't allowed,
   // we need a two-step creation procedure. create_node_connection below does that.
@@ -84,21 +110,25 @@ private:
   // Implementation of the callback functions from the states.
   virtual std::string own_name() const { return node_name; }
   virtual void got_peer_name(const std::string& name) { peer_name = name; }
+  virtual std::string status_for_peer(const std::string& name) const;
   virtual std::string cookie() const;
 
   virtual challenge_type own_challenge() const { return own_challenge_; }
 
   virtual void handshake_complete();
   virtual void report_failure(const std::string& reason);
-  virtual connection_state_ptr change_state(connection_state_ptr new_state);
+  virtual void report_connection_lost(const std::string& reason);
+  virtual void report_closed();  virtual connection_state_ptr change_state(connection_state_ptr new_state);
 
   virtual void trigger_checked_read(const message_read_fn& callback);
 
   virtual void trigger_checked_write(const msg_seq& msg, const message_written_fn& callback);
 
-  virtual void deliver_received(const msg_seq& msg, const e_pid& to);
+  virtual void queue_until_connected(const msg_seq& msg);
+
+  virtual void deliver_received(const received_msg& msg, const e_pid& to);
 
-  virtual void deliver_received(const msg_seq& msg, const std::string& to);
+  virtual void deliver_received(const received_msg& msg, const std::string& to);
 
   virtual void request_link(const e_pid& from, const e_pid& to);
 
@@ -109,10 +139,23 @@ private:
   virtual void request_exit2(const e_pid& from, const e_pid& to, const std::string& reason);
 
   void handle_io_error(const boost::system::error_code& error);
+
+  // Used in error messages, where the peer may not be known yet.
+  std::string node_name_or_unknown() const;
+
+  // The states refer back to the connection => a closed connection would never be 
+  // released. Its state is replaced by one that doesn't, but the connection is kept 
+  // until the handlers aborted as its socket closed (bound to this) have run.
+  void release_state();
+
+  void write_or_queue(const msg_seq& msg);
+
+  void start_handshake_timer();
+  void handshake_timed_out(const boost::system::error_code& error);
   
 private:
-  boost::asio::ip::tcp::socket connection;
-  node_access& node;
+  boost::asio::io_service& io_service_;
+  boost::asio::ip::tcp::socket connection;  node_access& node;
   node_async_tcp_ip async_tcp_ip;
 
   // In case the other node is the originator, we don't now its name until later.
@@ -129,8 +172,20 @@ private:
 
   typedef boost::signal<void (bool /*success*/)> handshake_complete_signal_type;
   handshake_complete_signal_type handshake_success;
+  peer_status_fn_type peer_status;
+
+  boost::asio::deadline_timer handshake_timer;
 
   challenge_type own_challenge_;
+
+  // The operations requested during the handshake, already encoded. 
+  // Protected, together with the connected and failure flags, by the mutex.
+  std::deque<msg_seq> pending_requests;
+  size_t pending_bytes;
+  bool connected;
+  boost::optional<std::string> failure;
+  node_connection_ptr forwarded;
+  boost::mutex requests_mutex;
 };
 
 }
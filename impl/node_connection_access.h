@@ -23,6 +23,7 @@
 #define NODE_CONNECTION_ACCESS_H
 
 #include "types.h"
+#include "received_msg.h"
 #include <boost/shared_ptr.hpp>
 #include <boost/enable_shared_from_this.hpp>
 #include <boost/function.hpp>
@@ -61,19 +62,30 @@ class node_connection_access : public boost::enable_shared_from_this<node_connec
   // has communicated its name.
   virtual void got_peer_name(const std::string& name) = 0;
 
+  // The status to send to a connecting node (see distribution_handshake.txt).
+  virtual std::string status_for_peer(const std::string& name) const = 0;
+
   virtual void handshake_complete() = 0;
 
   virtual void report_failure(const std::string& reason) = 0;
 
+  // Invoked as an established connection fails. Closes the connection.
+  virtual void report_connection_lost(const std::string& reason) = 0;
+
+  // Invoked as the connection is closed without failing (e.g. by the winner of a simultaneous connect).
+  virtual void report_closed() = 0;
   virtual void trigger_checked_read(const message_read_fn& callback) = 0;
 
   virtual void trigger_checked_write(const msg_seq& msg, const message_written_fn& callback) = 0;
 
+  // Keeps an encoded operation, requested during the handshake, until connected.
+  virtual void queue_until_connected(const msg_seq& msg) = 0;
+
   //
   // Interface for incoming message send operations:
-  virtual void deliver_received(const msg_seq& msg, const e_pid& to) = 0;
+  virtual void deliver_received(const received_msg& msg, const e_pid& to) = 0;
 
-  virtual void deliver_received(const msg_seq& msg, const std::string& to) = 0;
+  virtual void deliver_received(const received_msg& msg, const std::string& to) = 0;
 
   //
   // Interface for interprocess links:
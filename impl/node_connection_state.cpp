@@ -90,9 +90,14 @@ struct connected : connection_state
 
   virtual void handle_io_error(const std::string& error) const
   {
+    const std::string peer_node = access->peer_node_name();
+
+    // Releases this state => the access isn't used below.
+    access->report_connection_lost(error);
+
     // Fire an exception and let the higher-level layers deal with it, probably
     // by dropping the connection.
-     throw connection_io_error(error, access->peer_node_name());
+     throw connection_io_error(error, peer_node);
   }
 
   bool is_tick(const msg_seq& msg) const
@@ -113,20 +118,65 @@ struct connected : connection_state
 
   void msg_received(utils::msg_lexer& msgs)
   {
-    try {
-       msg_seq msg = *msgs.next_message();
+    // A single read may complete several messages (e.g. a burst of sends) - handle 
+    // all of them before the next read, which may not complete until more data arrives.
+    while(msgs.has_complete_msg()) {
+      try {
+         // The frame is shared with the mailbox (and, later, the matchables) => no copying.
+         const frame_ptr msg(new msg_seq());
+         msg->swap(*msgs.next_message());
+
+         if(is_tick(*msg))
+           send_tock();
+         else
+           msg_dispatcher.dispatch(msg);
+      } catch(const tinch_pp_exception& e) {
+         // We want to ensure that the next read is triggered - perhaps we can fix the problem and continue.
+         // throw e; TODO: How do I propagate this without destroying the ongoing write? Put the error in the mailboxes for this node?
+      }
+    }
 
-       if(is_tick(msg))
-         send_tock();
-       else
-         msg_dispatcher.dispatch(msg);
+    connection.trigger_read(&connected::msg_received);
+  }
+};
 
-       connection.trigger_read(&connected::msg_received);
-    } catch(const tinch_pp_exception& e) {
-       // We want to ensure that the next read is triggered - perhaps we can fix the problem and continue.
-       connection.trigger_read(&connected::msg_received);
-       // throw e; TODO: How do I propagate this without destroying the ongoing write? Put the error in the mailboxes for this node?
-    }
+// The operations requested during the handshake are encoded just as in the 
+// connected state, but queued instead of written.
+struct queueing_requests : connection_state
+{
+  queueing_requests(access_ptr access)
+    : connection_state(access)
+  {
+  }
+
+  virtual void send(const msg_seq& payload, const tinch_pp::e_pid& self, const std::string& destination_name)
+  {
+    access->queue_until_connected(build_reg_send_msg(payload, self, destination_name));
+  }
+
+  virtual void send(const msg_seq& payload, const tinch_pp::e_pid& destination_pid)
+  {
+    access->queue_until_connected(build_send_msg(payload, destination_pid));
+  }
+
+  virtual void exit(const tinch_pp::e_pid& from_pid, const tinch_pp::e_pid& to_pid, const std::string& reason)
+  {
+    access->queue_until_connected(build_exit_msg(from_pid, to_pid, reason));
+  }
+
+  virtual void exit2(const tinch_pp::e_pid& from_pid, const tinch_pp::e_pid& to_pid, const std::string& reason)
+  {
+    access->queue_until_connected(build_exit2_msg(from_pid, to_pid, reason));
+  }
+
+  virtual void link(const tinch_pp::e_pid& from_pid, const tinch_pp::e_pid& to_pid)
+  {
+    access->queue_until_connected(build_link_msg(from_pid, to_pid));
+  }
+
+  virtual void unlink(const tinch_pp::e_pid& from_pid, const tinch_pp::e_pid& to_pid)
+  {
+    access->queue_until_connected(build_unlink_msg(from_pid, to_pid));
   }
 };
 
@@ -286,7 +336,37 @@ struct receiving_challenge : connection_state
     recv_challenge challenge_p;
     utils::parse(*read_msgs.next_message(), challenge_p, attributes);
 
-    access->change_state_to<sending_challenge_reply>()->send(attributes.challenge, access);
+    // The transition deallocates this state; keep a copy of the access for the new one.
+    const access_ptr own_access = access;
+    own_access->change_state_to<sending_challenge_reply>()->send(attributes.challenge, own_access);
+  }
+};
+
+// As we lose a simultaneous connect, the other node closes the connection. 
+// That's expected and no failure; the node_connector awaits the other node's 
+// connection attempt (or the handshake timeout).
+struct superseded_by_simultaneous : connection_state
+{
+  superseded_by_simultaneous(access_ptr access)
+    : connection_state(access)
+  {
+  }
+
+  virtual void handle_io_error(const std::string& error) const
+  {
+    access->report_closed();
+  }
+};
+
+struct closed : connection_state
+{
+  closed()
+    : connection_state(access_ptr())
+  {
+  }
+
+  virtual void handle_io_error(const std::string& error) const
+  {
   }
 };
 
@@ -317,6 +397,9 @@ struct waiting_for_status : connection_state
     if(ok) {
       shared_ptr<receiving_challenge> new_state = access->change_state_to<receiving_challenge>();
       new_state->receive_challenge(read_msgs);
+    } else if(status == "nok") {
+      // B is connecting to us too, and wins: our attempt is superseded by B's.
+      access->change_state_to<superseded_by_simultaneous>();
     } else {
       const std::string problem = "Handshake not OK, B sent status = " + status;
       access->report_failure(problem);
@@ -334,19 +417,31 @@ struct sending_status : connection_state
     : connection_state(access),
       connection(access, this)
   {
-    send_status();
-    send_challenge();
   }
 
-private:
-  void send_status()
+  // Any other status than ok and ok_simultaneous terminates the handshake.
+  void send(const std::string& status)
   {
     receive_status_g status_g;
-    const serializable_string status("ok"); // TODO: handle other alternatives in the next version...
+    const serializable_string status_attr(status);
 
-    utils::generate(status_msg, status_g, status);
+    utils::generate(status_msg, status_g, status_attr);
 
-    connection.trigger_write(status_msg);
+    if((status == "ok") || (status == "ok_simultaneous")) {
+      connection.trigger_write(status_msg);
+      send_challenge();
+    } else {
+      refusal = status;
+      connection.trigger_write(status_msg, &sending_status::refused);
+    }
+  }
+
+private:
+  std::string refusal;
+
+  void refused()
+  {
+    access->report_failure("Refused the connecting node, status = " + refusal);
   }
 
   void send_challenge()
@@ -407,8 +502,11 @@ private:
     utils::parse(msg, name_p, sent_name);
 
     if(supported_version(sent_name)) {
+      // Decide before the transition (which deallocates this state).
+      const std::string status = access->status_for_peer(sent_name.name);
+
       access->got_peer_name(sent_name.name);
-      access->change_state_to<sending_status>();
+      access->change_state_to<sending_status>()->send(status);
     } else {
       const std::string erroneous_version = "The connecting node " + sent_name.name +
 	                                    " uses an unsupported version. We support version = " +
@@ -438,6 +536,20 @@ connection_state_ptr initial_state(access_ptr access)
   return initial;
 }
 
+connection_state_ptr closed_state()
+{
+  connection_state_ptr closed_for_good(new closed);
+
+  return closed_for_good;
+}
+
+connection_state_ptr queueing_state(access_ptr access)
+{
+  connection_state_ptr queueing(new queueing_requests(access));
+
+  return queueing;
+}
+
 connection_state::~connection_state() {}
 
 void connection_state::handle_io_error(const std::string& error) const
@@ -70,6 +70,14 @@ typedef boost::shared_ptr<connection_state> connection_state_ptr;
 
 connection_state_ptr initial_state(access_ptr access);
 
+// The state of a closed connection (failed, lost or superseded): ignores everything.
+// Unlike the other states, it doesn't refer back to the connection (no cycle).
+connection_state_ptr closed_state();
+
+// Used for the operations requested before the handshake is complete. 
+// The operations are encoded and queued by the connection.
+connection_state_ptr queueing_state(access_ptr access);
+
 }
 
 #endif
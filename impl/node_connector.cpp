@@ -22,8 +22,10 @@
 #include "node_connector.h"
 #include "tinch_pp/exceptions.h"
 #include "node_access.h"
-#include "epmd_requestor.h"
+#include "constants.h"
+#include "utils.h"
 #include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
 #include <ctime>
 #include <algorithm>
 
@@ -32,17 +34,14 @@ using namespace boost;
 using boost::asio::ip::tcp;
 using namespace std;
 
-namespace {
-
-node_connection_ptr request_node_connection(asio::io_service& io_service,
-					    const std::string& peer_node,
-					    node_access& node);
-}
-
 node_connector::node_connector(node_access& a_node,
-			       asio::io_service& a_io_service)
+			       asio::io_service& a_io_service,
+			       port_number_type epmd_port)
   : node(a_node),
     io_service(a_io_service),
+    port_cache(a_io_service, epmd_port, 
+               posix_time::seconds(constants::epmd_port_ttl_sec), 
+               posix_time::seconds(constants::epmd_negative_ttl_sec)),
     // initialize our random challenge generator
     challenge_dist(0, 0xFFFFFF),
     generator(static_cast<unsigned int>(std::time(0))),
@@ -50,6 +49,17 @@ node_connector::node_connector(node_access& a_node,
 {
 }
 
+// Invoked as the node dies (the I/O thread is already stopped).
+node_connector::~node_connector()
+{
+  // The connections are kept alive by their own handlers => close them explicitly, 
+  // so that the peers notice that this node is gone.
+  for(node_connections_type::iterator i = node_connections.begin(); i != node_connections.end(); ++i) {
+    system::error_code ignored;
+    i->second->socket().close(ignored);
+  }
+}
+
 void node_connector::start_accept_incoming(port_number_type port_no)
 {
   incoming_connections_acceptor.reset(new asio::ip::tcp::acceptor(io_service, tcp::endpoint(tcp::v4(), port_no)));
@@ -69,21 +79,74 @@ void node_connector::trigger_accept()
 
 node_connection_ptr node_connector::get_connection_to(const std::string& peer_node_name)
 {
-  unique_lock<mutex> lock(node_connections_mutex);
+  node_connection_ptr established;
+  const pending_connection_ptr pending = established_or_pending(peer_node_name, established);
+
+  return pending ? pending->wait() : established;
+}
+
+node_connection_ptr node_connector::queueing_connection_to(const std::string& peer_node_name)
+{
+  node_connection_ptr established;
+  const pending_connection_ptr pending = established_or_pending(peer_node_name, established);
+
+  return pending ? pending->connection() : established;
+}
+
+// Only the first sender to a node starts a connection attempt; any concurrent 
+// senders to the same node share that attempt. The mutex is only held while 
+// looking up the connection, so that senders to other nodes aren't blocked.
+node_connector::pending_connection_ptr node_connector::established_or_pending(const std::string& peer_node_name,
+                                                                              node_connection_ptr& established)
+{
+  lock_guard<mutex> lock(node_connections_mutex);
 
   node_connections_type::iterator existing = node_connections.find(peer_node_name);
 
-  if(existing != node_connections.end())
-    return existing->second;
+  if(existing != node_connections.end()) {
+    established = existing->second;
+    return pending_connection_ptr();
+  }
+
+  pending_connections_type::iterator on_its_way = pending_connections.find(peer_node_name);
 
-  return make_new_connection(peer_node_name, lock);
+  if(on_its_way != pending_connections.end())
+    return on_its_way->second;
+
+  const pending_connection_ptr pending(new pending_connection(io_service, node_connection::create(io_service, node, peer_node_name)));
+  pending_connections.insert(pending_connections_type::value_type(peer_node_name, pending));
+
+  pending->start_setup_timer(posix_time::seconds(constants::net_setuptime_sec),
+                             bind(&node_connector::setup_timed_out, this, 
+                                  peer_node_name, weak_ptr<pending_connection>(pending), ::_1));
+
+  port_cache.async_lookup(peer_node_name, bind(&node_connector::port_found, this, 
+                                               peer_node_name, pending, challenge_generator(), ::_1, ::_2));
+  return pending;
 }
 
-void node_connector::drop_connection_to(const std::string& node_name)
+void node_connector::connect_in_background(const std::string& peer_node_name, const outcome_fn_type& outcome_fn)
+{
+  node_connection_ptr established;
+  const pending_connection_ptr pending = established_or_pending(peer_node_name, established);
+
+  if(pending)
+    pending->when_done(outcome_fn);
+  else
+    outcome_fn(true);
+}
+
+bool node_connector::drop_connection_to(const std::string& node_name)
 {
   unique_lock<mutex> lock(node_connections_mutex);
 
-  node_connections.erase(node_name);
+  if(node_connections.erase(node_name) == 0)
+    return false;
+
+  // The node may come back on another port (e.g. restarted).
+  port_cache.forget(node_name);
+
+  return true;
 }
 
 vector<string> node_connector::connected_nodes() const
@@ -98,89 +161,379 @@ vector<string> node_connector::connected_nodes() const
   return connected;
 }
 
-// Always invoked with the mutex locked.
-node_connection_ptr node_connector::make_new_connection(const std::string& peer_node_name,
-							unique_lock<mutex>& lock)
+void node_connector::port_found(const std::string& peer_node_name,
+                                pending_connection_ptr pending,
+                                challenge_type own_challenge,
+                                const optional<port_number_type>& port,
+                                const std::string& failure)
+{
+  if(pending->is_done())
+    return;
+
+  if(!port) {
+    connection_failed(peer_node_name, pending, failure);
+    return;
+  }
+
+  try {
+    utils::async_connect_socket(io_service, pending->connection()->socket(), utils::node_host(peer_node_name), *port,
+                                bind(&node_connector::node_connected, this, peer_node_name, pending, own_challenge, ::_1));
+  } catch(const tinch_pp_exception& e) {
+    connection_failed(peer_node_name, pending, e.what());
+  }
+}
+
+void node_connector::node_connected(const std::string& peer_node_name,
+                                    pending_connection_ptr pending,
+                                    challenge_type own_challenge,
+                                    const boost::system::error_code& error)
+{
+  // Timed out: the connect was either aborted or, in case the name resolution 
+  // completed late, is of no use anymore.
+  if(pending->is_done()) {
+    boost::system::error_code ignored;
+    pending->connection()->socket().close(ignored);
+    return;
+  }
+
+  if(error) {
+    // The node may have been restarted on another port since we looked it up.
+    port_cache.forget(peer_node_name);
+
+    connection_failed(peer_node_name, pending, "Failed to connect to the node = " + peer_node_name + 
+                      " (" + error.message() + ")");
+    return;
+  }
+
+  try {
+    const node_connection_ptr new_connection = pending->connection();
+
+    new_connection->start_handshake_as_A(bind(&node_connector::handshake_success, this, peer_node_name, 
+                                              weak_ptr<pending_connection>(pending), 
+                                              weak_ptr<node_connection>(new_connection), ::_1), 
+                                         own_challenge);
+  } catch(const tinch_pp_exception& e) {
+    connection_failed(peer_node_name, pending, e.what());
+  }
+}
+
+void node_connector::connection_failed(const std::string& peer_node_name,
+                                       pending_connection_ptr pending,
+                                       const std::string& reason)
 {
-  node_connection_ptr new_connection = request_node_connection(io_service, peer_node_name, node);
-  new_connection->start_handshake_as_A(bind(&node_connector::handshake_success, this, ::_1), 
-                                       challenge_generator());
+  {
+    lock_guard<mutex> lock(node_connections_mutex);
+
+    // The peer node's own connection attempt completes (or fails) this one.
+    if(pending->is_superseded())
+      return;
 
-  const bool success = wait_for_handshake_result(lock);
+    pending_connections_type::iterator on_its_way = pending_connections.find(peer_node_name);
 
-  if(!success)
-    throw tinch_pp_exception("Failed to connect to the node = " + peer_node_name);
+    if((on_its_way != pending_connections.end()) && (on_its_way->second == pending))
+      pending_connections.erase(on_its_way);
+  }
 
-  node_connections.insert(node_connections_type::value_type(peer_node_name, new_connection));
+  pending->connection()->fail_pending_requests(reason);
+  pending->fail(reason);
 
-  return new_connection;
+  node.node_unreachable(peer_node_name);
 }
 
-// Tricky - we must ensure that the node has finished its handshake procedure (asynchronous).
-bool node_connector::wait_for_handshake_result(unique_lock<mutex>& lock)
+// Whatever step the attempt is at, it's aborted by closing the socket; the failure 
+// is reported here, not by the aborted operation.
+void node_connector::setup_timed_out(const std::string& peer_node_name,
+                                     weak_ptr<pending_connection> waited_for,
+                                     const boost::system::error_code& error)
 {
-  while(!handshake_done)
-    handshake_cond.wait(lock);
+  const pending_connection_ptr pending = waited_for.lock();
+
+  if((error == asio::error::operation_aborted) || !pending)
+    return;
+
+  {
+    lock_guard<mutex> lock(node_connections_mutex);
+
+    // The peer node's incoming connection has a deadline of its own.
+    if(pending->is_superseded())
+      return;
+  }
 
-  const bool result = *handshake_done;
-  handshake_done = boost::none;
+  connection_failed(peer_node_name, pending, "Failed to set up a connection to the node = " + peer_node_name + 
+                    " within " + lexical_cast<std::string>(constants::net_setuptime_sec) + " seconds");
 
-  return result;
+  boost::system::error_code ignored;
+  pending->connection()->socket().close(ignored);
 }
 
 // Callback (signal) from the connection.
-void node_connector::handshake_success(bool handshake_result)
+// The connection may signal a failure after a successful handshake too; that's 
+// none of our business here.
+void node_connector::handshake_success(const std::string& peer_node_name,
+                                       weak_ptr<pending_connection> waited_for,
+                                       weak_ptr<node_connection> established,
+                                       bool handshake_result)
 {
+  // The first sender keeps the pending connection alive until the outcome is known.
+  const pending_connection_ptr pending = waited_for.lock();
+  const node_connection_ptr connection = established.lock();
+
+  if(!pending || !connection)
+    return;
+
+  if(!handshake_result) {
+    connection_failed(peer_node_name, pending, "The handshake with the node = " + peer_node_name + " failed");
+    return;
+  }
+
+  node_connection_ptr replaced;
+
   {
     lock_guard<mutex> lock(node_connections_mutex);
 
-    handshake_done = handshake_result;
+    pending_connections_type::iterator on_its_way = pending_connections.find(peer_node_name);
+
+    if((on_its_way == pending_connections.end()) || (on_its_way->second != pending))
+      return;
+
+    pending_connections.erase(on_its_way);
+    replaced = register_connection(peer_node_name, connection);
   }
-  handshake_cond.notify_one();
+
+  announce_connection(peer_node_name, replaced);
+
+  pending->complete(connection);
 }
 
-void node_connector::handshake_success_as_B(node_connection_ptr potentially_connected, bool succeeded)
+// Callback (signal) from an incoming connection.
+void node_connector::handshake_success_as_B(weak_ptr<node_connection> incoming, bool succeeded)
 {
+  const node_connection_ptr potentially_connected = incoming.lock();
+
+  if(!potentially_connected)
+    return;
+
+  std::string peer_node_name;
+
+  try {
+    peer_node_name = potentially_connected->peer_node_name();
+  } catch(const tinch_pp_exception&) {
+    // Failed before the peer node told its name - nothing to clean-up.
+    return;
+  }
+
+  pending_connection_ptr superseded;
+  node_connection_ptr replaced;
+
+  {
+    lock_guard<mutex> lock(node_connections_mutex);
+
+    pending_connections_type::iterator on_its_way = pending_connections.find(peer_node_name);
+
+    if((on_its_way != pending_connections.end()) && on_its_way->second->is_superseded()) {
+      superseded = on_its_way->second;
+      pending_connections.erase(on_its_way);
+    }
+
+    if(succeeded) {
+      // The requests queued by our own attempt go first.
+      if(superseded)
+        superseded->connection()->forward_to(potentially_connected);
+
+      replaced = register_connection(peer_node_name, potentially_connected);
+    }
+  }
+
+  if(succeeded)
+    announce_connection(peer_node_name, replaced);
+
+  if(!superseded)
+    return;
+
   if(succeeded) {
-    const std::string peer_node_name = potentially_connected->peer_node_name();
+    superseded->complete(potentially_connected);
+  } else {
+    const std::string reason = "The simultaneous connection with the node = " + peer_node_name + " failed";
+
+    superseded->connection()->fail_pending_requests(reason);
+    superseded->fail(reason);
 
-    node_connections.insert(node_connections_type::value_type(peer_node_name, potentially_connected));
+    node.node_unreachable(peer_node_name);
   }
+}
 
-  // Ready for the next connection.
-  trigger_accept();
+// The rules for simultaneous connects (see distribution_handshake.txt): the node 
+// with the greater name keeps its own connection attempt.
+std::string node_connector::status_for_peer(const std::string& peer_node_name)
+{
+  lock_guard<mutex> lock(node_connections_mutex);
+
+  // A node we're still connected to has lost that connection without us noticing 
+  // (e.g. its host rebooted; there are no ticks). Erlang answers "alive", leaving the 
+  // decision to the peer; we accept the new connection and drop the stale one as the 
+  // handshake succeeds (see register_connection).
+  if(node_connections.find(peer_node_name) != node_connections.end())
+    return "ok";
+
+  pending_connections_type::iterator on_its_way = pending_connections.find(peer_node_name);
+
+  if(on_its_way == pending_connections.end())
+    return "ok";
+
+  if(node.name() > peer_node_name)
+    return "nok";
+
+  on_its_way->second->supersede();
+
+  return "ok_simultaneous";
+}
+
+node_connection_ptr node_connector::register_connection(const std::string& peer_node_name, node_connection_ptr connection)
+{
+  node_connection_ptr replaced;
+
+  node_connections_type::iterator established = node_connections.find(peer_node_name);
+
+  if(established != node_connections.end()) {
+    replaced = established->second;
+    established->second = connection;
+  } else {
+    node_connections.insert(node_connections_type::value_type(peer_node_name, connection));
+  }
+
+  return replaced;
+}
+
+// The replaced connection is closed without failing => its node is taken down once.
+void node_connector::announce_connection(const std::string& peer_node_name, node_connection_ptr replaced)
+{
+  if(replaced) {
+    replaced->close("The connection was replaced by a new one from the node");
+
+    node.node_down(peer_node_name);
+  }
+
+  node.node_up(peer_node_name);
 }
 
 void node_connector::handle_accept(node_connection_ptr new_connection,
 				   const boost::system::error_code& error)
 {
   if(!error) {
-    // The new_connection signals once its handshake is done - then it's added to the container and
-    // the next accept is triggered.
-    new_connection->start_handshake_as_B(bind(&node_connector::handshake_success_as_B, this, new_connection, ::_1),
-                                         challenge_generator());
-  } else {
-    trigger_accept();
+    challenge_type own_challenge = 0;
+
+    {
+      lock_guard<mutex> lock(node_connections_mutex);
+      own_challenge = challenge_generator();
+    }
+
+    // The new_connection signals once its handshake is done - then it's added to the container.
+    new_connection->start_handshake_as_B(bind(&node_connector::handshake_success_as_B, this, 
+                                              weak_ptr<node_connection>(new_connection), ::_1),
+                                         bind(&node_connector::status_for_peer, this, ::_1),
+                                         own_challenge);
+  }
+
+  // Ready for the next connection, while the handshake goes on.
+  trigger_accept();
+}
+
+node_connector::pending_connection::pending_connection(asio::io_service& io_service, node_connection_ptr a_connecting)
+  : connecting(a_connecting),
+    done(false),
+    superseded(false),
+    setup_timer(io_service)
+{
+}
+
+void node_connector::pending_connection::start_setup_timer(const posix_time::time_duration& setup_time, 
+                                                           const timeout_fn_type& timeout_fn)
+{
+  setup_timer.expires_from_now(setup_time);
+  setup_timer.async_wait(timeout_fn);
+}
+
+bool node_connector::pending_connection::is_done()
+{
+  lock_guard<mutex> lock(outcome_mutex);
+
+  return done;
+}
+
+bool node_connector::pending_connection::complete(node_connection_ptr a_established)
+{
+  {
+    lock_guard<mutex> lock(outcome_mutex);
+
+    if(done)
+      return false;
+
+    done = true;
+    established = a_established;
   }
+  setup_timer.cancel();
+  outcome_cond.notify_all();
+  notify_outcome(true);
+
+  return true;
 }
 
-namespace {
+bool node_connector::pending_connection::fail(const std::string& reason)
+{
+  {
+    lock_guard<mutex> lock(outcome_mutex);
+
+    if(done)
+      return false;
 
-node_connection_ptr request_node_connection(asio::io_service& io_service, 
-					    const std::string& peer_node,
-					    node_access& node)
+    done = true;
+    failure = reason;
+  }
+  setup_timer.cancel();
+  outcome_cond.notify_all();
+  notify_outcome(false);
+
+  return true;
+}
+
+void node_connector::pending_connection::when_done(const outcome_fn_type& outcome_fn)
 {
-  const std::string remote_host(utils::node_host(peer_node));
-  const std::string peer_name(utils::node_name(peer_node));
+  {
+    lock_guard<mutex> lock(outcome_mutex);
+
+    if(!done) {
+      outcome_fns.push_back(outcome_fn);
+      return;
+    }
+  }
 
-  epmd_requestor epmd(io_service, remote_host, 4369);
+  outcome_fn(!failure);
+}
 
-  const port_number_type port = epmd.port_please2_request(peer_name);
+// Once done, the outcome functions are only accessed here => no lock needed while invoking them.
+void node_connector::pending_connection::notify_outcome(bool connected)
+{
+  std::vector<outcome_fn_type> to_notify;
 
-  node_connection_ptr connection = node_connection::create(io_service, node, peer_node);
-  utils::connect_socket(io_service, connection->socket(), remote_host, port);
+  {
+    lock_guard<mutex> lock(outcome_mutex);
+
+    to_notify.swap(outcome_fns);
+  }
 
-  return connection;
+  for(std::vector<outcome_fn_type>::const_iterator fn = to_notify.begin(); fn != to_notify.end(); ++fn)
+    (*fn)(connected);
 }
 
+node_connection_ptr node_connector::pending_connection::wait()
+{
+  unique_lock<mutex> lock(outcome_mutex);
+
+  while(!done)
+    outcome_cond.wait(lock);
+
+  if(failure)
+    throw tinch_pp_exception(*failure);
+
+  return established;
 }
@@ -28,15 +28,27 @@
 // This class is responsible for establishing the connections. The first step is to 
 // identify where the node is. That's done through a request to EPMD on that host.
 // Once a connection has been established, it is maintained by this class.
+//
+// Connections are established per peer node, asynchronously in the I/O context: 
+// while a connection is pending, the requests to that node are queued by the 
+// connection itself. Senders to other, already connected, nodes proceed as usual.
+// The ports looked up through EPMD are cached (see epmd_port_cache.h).
+// An attempt not connected within constants::net_setuptime_sec, counted from the 
+// EPMD lookup to the end of the handshake, fails (as net_setuptime in Erlang).
+// Incoming connections are accepted, and their handshakes run, concurrently.
 #include "node_connection.h"
+#include "epmd_port_cache.h"
 #include "types.h"
 #include <boost/asio.hpp>
 #include <boost/utility.hpp>
 #include <boost/thread.hpp>
+#include <boost/optional.hpp>
+#include <boost/function.hpp>
 #include <boost/random/linear_congruential.hpp>
 #include <boost/random/uniform_int.hpp>
 #include <boost/random/variate_generator.hpp>
 #include <string>
+#include <vector>
 #include <map>
 
 namespace tinch_pp {
@@ -47,13 +59,29 @@ class node_connector : boost::noncopyable
 {
 public:
   node_connector(node_access& node, 
-		 boost::asio::io_service& io_service);
+		 boost::asio::io_service& io_service,
+		 port_number_type epmd_port);
+
+  ~node_connector();
 
   void start_accept_incoming(port_number_type port_no);
 
+  // Waits until the connection is established.
+  // Throws tinch_pp_exception in case the connection attempt fails.
   node_connection_ptr get_connection_to(const std::string& node_name);
 
-  void drop_connection_to(const std::string& node_name);
+  // Returns at once, possibly with a connection that's still being established.
+  // Such a connection queues the requests until it's connected.
+  node_connection_ptr queueing_connection_to(const std::string& node_name);
+
+  typedef boost::function<void (bool /* connected */)> outcome_fn_type;
+
+  // Returns at once. The outcome of the connection attempt is reported through 
+  // the given function (at once, in case the node is already connected).
+  void connect_in_background(const std::string& node_name, const outcome_fn_type& outcome_fn);
+
+  // Returns false in case there's no connection to drop (e.g. already dropped).
+  bool drop_connection_to(const std::string& node_name);
 
   std::vector<std::string> connected_nodes() const;
 
@@ -61,13 +89,78 @@ private:
   node_access& node;
   boost::asio::io_service& io_service;
 
+  epmd_port_cache port_cache;
+
   typedef boost::shared_ptr<boost::asio::ip::tcp::acceptor> acceptor_ptr;
   acceptor_ptr incoming_connections_acceptor;
 
-  node_connection_ptr make_new_connection(const std::string& peer_node_name, 
-					  boost::unique_lock<boost::mutex>& lock);
+  // A connection on its way (EPMD lookup, connect and handshake). All senders 
+  // to the peer node share it.
+  class pending_connection : boost::noncopyable
+  {
+  public:
+    pending_connection(boost::asio::io_service& io_service, node_connection_ptr connecting);
+
+    node_connection_ptr connection() const { return connecting; }
+
+    // The whole setup has to complete before the given deadline; the timer is 
+    // cancelled as the outcome is known.
+    typedef boost::function<void (const boost::system::error_code&)> timeout_fn_type;
+    void start_setup_timer(const boost::posix_time::time_duration& setup_time, const timeout_fn_type& timeout_fn);
+
+    // Once done, the remaining steps of the attempt are abandoned.
+    bool is_done();
+
+    // Returns false in case the outcome is already known.
+    // The established connection differs from the connecting one in case the 
+    // peer node won a simultaneous connect.
+    bool complete(node_connection_ptr established);
+    bool fail(const std::string& reason);
+
+    // Marks that the peer node won a simultaneous connect: this attempt is 
+    // completed by the peer's incoming connection instead.
+    // Protected by the node_connections_mutex (not by the outcome_mutex).
+    void supersede() { superseded = true; }
+    bool is_superseded() const { return superseded; }
+
+    // Blocks until the outcome is known. Throws tinch_pp_exception on failure.
+    node_connection_ptr wait();
+
+    // Invokes the given function once the outcome is known (at once, if it already is).
+    void when_done(const outcome_fn_type& outcome_fn);
+
+  private:
+    const node_connection_ptr connecting;
 
-  bool wait_for_handshake_result(boost::unique_lock<boost::mutex>& lock);
+    boost::mutex outcome_mutex;
+    boost::condition_variable outcome_cond;
+    bool done;
+    boost::optional<std::string> failure;
+    node_connection_ptr established;
+    std::vector<outcome_fn_type> outcome_fns;
+
+    void notify_outcome(bool connected);
+
+    bool superseded;
+
+    boost::asio::deadline_timer setup_timer;
+  };
+
+  typedef boost::shared_ptr<pending_connection> pending_connection_ptr;
+
+  // Returns the pending connection to the given node, starting a new connection 
+  // attempt if needed. An empty pointer is returned in case the node is already 
+  // connected; the connection is returned through the given reference.
+  pending_connection_ptr established_or_pending(const std::string& peer_node_name, 
+                                                node_connection_ptr& established);
+
+  void connection_failed(const std::string& peer_node_name, 
+                         pending_connection_ptr pending,
+                         const std::string& reason);
+
+  void setup_timed_out(const std::string& peer_node_name, 
+                       boost::weak_ptr<pending_connection> pending,
+                       const boost::system::error_code& error);
 
   void trigger_accept();
 
@@ -75,21 +168,49 @@ private:
   //
 
   // The asynchronous callbacks are encapsulated in the following functions:
+  void port_found(const std::string& peer_node_name, 
+                  pending_connection_ptr pending,
+                  challenge_type own_challenge,
+                  const boost::optional<port_number_type>& port,
+                  const std::string& failure);
+
+  void node_connected(const std::string& peer_node_name, 
+                      pending_connection_ptr pending,
+                      challenge_type own_challenge,
+                      const boost::system::error_code& error);
+
   void handle_accept(node_connection_ptr new_connection, 
 		     const boost::system::error_code& error);
   
-  void handshake_success(bool succeeded);
+  // The connection keeps its callbacks, hence the weak pointers (no cycles).
+  void handshake_success(const std::string& peer_node_name, 
+                         boost::weak_ptr<pending_connection> pending, 
+                         boost::weak_ptr<node_connection> connection,
+                         bool succeeded);
+
+  void handshake_success_as_B(boost::weak_ptr<node_connection> potentially_connected, bool succeeded);
 
-  void handshake_success_as_B(node_connection_ptr potentially_connected, bool succeeded);
+  // The status sent to a connecting node, considering our own connection attempts.
+  std::string status_for_peer(const std::string& peer_node_name);
+
+  // A new connection to a node replaces the established one, if any, which is returned.
+  // Invoked with the mutex locked.
+  node_connection_ptr register_connection(const std::string& peer_node_name, node_connection_ptr connection);
+
+  // Takes down a replaced connection (nodedown) before the new one is announced (nodeup).
+  void announce_connection(const std::string& peer_node_name, node_connection_ptr replaced);
 
   // Remember the connections to other nodes...
   typedef std::map<std::string /* node name */, node_connection_ptr> node_connections_type;
   node_connections_type node_connections;
 
-  // ..and protect the node_connections:
-  boost::condition_variable handshake_cond;
+  // ..and the ones being established:
+  typedef std::map<std::string /* node name */, pending_connection_ptr> pending_connections_type;
+  pending_connections_type pending_connections;
+
+  // The mutex protects both containers (and the challenge generator below). 
+  // It's never held during the establishment of a connection.
   mutable boost::mutex node_connections_mutex;
-  boost::optional<bool> handshake_done;
 
   // When establishing a connection, our node must provide a challenge for the peer node.
   // And according to the Erlang documentation, "the challenges are expected to be very random numbers."
@@ -0,0 +1,117 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "node_reconnector.h"
+#include "constants.h"
+#include <boost/bind.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/random/uniform_int.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <algorithm>
+#include <ctime>
+
+using namespace tinch_pp;
+using namespace boost;
+
+node_reconnector::node_reconnector(asio::io_service& a_io_service, const connect_fn_type& a_connect_fn)
+  : io_service(a_io_service),
+    connect_fn(a_connect_fn),
+    initial_delay_ms(constants::reconnect_initial_delay_ms),
+    max_delay_ms(constants::reconnect_max_delay_ms),
+    jitter_generator(static_cast<boost::uint32_t>(std::time(0)))
+{
+}
+
+void node_reconnector::set_backoff(boost::uint32_t an_initial_delay_ms, boost::uint32_t a_max_delay_ms)
+{
+  lock_guard<mutex> lock(reconnect_mutex);
+
+  initial_delay_ms = an_initial_delay_ms;
+  max_delay_ms = std::max(an_initial_delay_ms, a_max_delay_ms);
+}
+
+void node_reconnector::connection_lost(const std::string& peer_node)
+{
+  lock_guard<mutex> lock(reconnect_mutex);
+
+  if((initial_delay_ms == 0) || (reconnecting.find(peer_node) != reconnecting.end()))
+    return;
+
+  reconnect_state& state = reconnecting[peer_node];
+  state.timer.reset(new asio::deadline_timer(io_service));
+  state.delay_ms = initial_delay_ms;
+  state.attempts = 0;
+
+  schedule(peer_node, state);
+}
+
+void node_reconnector::connection_established(const std::string& peer_node)
+{
+  lock_guard<mutex> lock(reconnect_mutex);
+
+  reconnecting_type::iterator state = reconnecting.find(peer_node);
+
+  if(state == reconnecting.end())
+    return;
+
+  state->second.timer->cancel();
+  reconnecting.erase(state);
+}
+
+void node_reconnector::schedule(const std::string& peer_node, reconnect_state& state)
+{
+  // Equal jitter: wait somewhere between half the delay and the full delay.
+  const boost::uint32_t half_delay = state.delay_ms / 2;
+  uniform_int<boost::uint32_t> jitter(0, state.delay_ms - half_delay);
+  const boost::uint32_t wait_ms = half_delay + jitter(jitter_generator);
+
+  state.timer->expires_from_now(posix_time::milliseconds(wait_ms));
+  state.timer->async_wait(bind(&node_reconnector::attempt, this, peer_node, asio::placeholders::error));
+}
+
+void node_reconnector::attempt(const std::string& peer_node, const system::error_code& error)
+{
+  if(error == asio::error::operation_aborted)
+    return;
+
+  connect_fn(peer_node, bind(&node_reconnector::attempt_done, this, peer_node, ::_1));
+}
+
+void node_reconnector::attempt_done(const std::string& peer_node, bool connected)
+{
+  lock_guard<mutex> lock(reconnect_mutex);
+
+  reconnecting_type::iterator state = reconnecting.find(peer_node);
+
+  // Connected meanwhile (e.g. by the peer).
+  if(state == reconnecting.end())
+    return;
+
+  if(connected || (++state->second.attempts >= constants::reconnect_max_attempts)) {
+    reconnecting.erase(state);
+    return;
+  }
+
+  const boost::uint32_t delay_ms = state->second.delay_ms;
+  state->second.delay_ms = (delay_ms > max_delay_ms / 2) ? max_delay_ms : delay_ms * 2;
+
+  schedule(peer_node, state->second);
+}
@@ -0,0 +1,97 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef NODE_RECONNECTOR_H
+#define NODE_RECONNECTOR_H
+
+// As the connection to a node breaks, we don't wait for the next message to that 
+// node before we reconnect. Instead, the node_reconnector retries in the background 
+// with an exponential backoff:
+// - the first attempt is made after the initial delay, and
+// - each failed attempt doubles the delay, up to the max delay.
+// Each delay is jittered (a random value between half and the full delay) in order 
+// to avoid synchronized reconnect storms as a peer, with many connected nodes, restarts.
+// The retries go on until the node is connected again (through us or the peer), 
+// or until constants::reconnect_max_attempts attempts in a row have failed. A node 
+// given up is retried again as soon as it's lost again (e.g. once connected by a send).
+#include <boost/asio.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/utility.hpp>
+#include <boost/random/linear_congruential.hpp>
+#include <string>
+#include <map>
+
+namespace tinch_pp {
+
+class node_reconnector : boost::noncopyable
+{
+public:
+  typedef boost::function<void (bool /* connected */)> outcome_fn_type;
+  typedef boost::function<void (const std::string& /* node */, const outcome_fn_type&)> connect_fn_type;
+
+  // The connect function has to return at once and report the outcome of the attempt later.
+  node_reconnector(boost::asio::io_service& io_service, const connect_fn_type& connect_fn);
+
+  // An initial delay of zero disables the reconnects.
+  void set_backoff(boost::uint32_t initial_delay_ms, boost::uint32_t max_delay_ms);
+
+  // Also used for nodes that we failed to connect in the first place.
+  void connection_lost(const std::string& peer_node);
+
+  void connection_established(const std::string& peer_node);
+
+private:
+  struct reconnect_state
+  {
+    boost::shared_ptr<boost::asio::deadline_timer> timer;
+    boost::uint32_t delay_ms;
+    boost::uint32_t attempts;
+  };
+
+  typedef std::map<std::string /* node name */, reconnect_state> reconnecting_type;
+
+  // Invoked with the lock held.
+  void schedule(const std::string& peer_node, reconnect_state& state);
+
+  void attempt(const std::string& peer_node, const boost::system::error_code& error);
+
+  void attempt_done(const std::string& peer_node, bool connected);
+
+  boost::asio::io_service& io_service;
+  const connect_fn_type connect_fn;
+
+  boost::uint32_t initial_delay_ms;
+  boost::uint32_t max_delay_ms;
+
+  reconnecting_type reconnecting;
+
+  boost::minstd_rand jitter_generator;
+
+  // Protects all members above. Never held while invoking the connect function.
+  boost::mutex reconnect_mutex;
+};
+
+}
+
+#endif
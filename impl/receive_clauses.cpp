@@ -0,0 +1,279 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "tinch_pp/receive_clauses.h"
+#include "tinch_pp/mailbox.h"
+#include "term_decoder.h"
+#include <boost/thread/locks.hpp>
+#include <algorithm>
+#include <set>
+
+using namespace tinch_pp;
+using namespace tinch_pp::erl;
+using namespace tinch_pp::detail;
+
+namespace {
+
+typedef std::vector<pattern_key> keys_type;
+
+// Reads the key of a received message (its tag, arity and leading atom) 
+// without matching the message as such.
+class key_probe : public object
+{
+public:
+  explicit key_probe(pattern_key& a_key)
+    : key(a_key) {}
+
+  virtual void serialize(msg_seq_out_iter& out) const {} // used for matching only
+
+  virtual bool match(msg_seq_iter& f, const msg_seq_iter& l) const
+  {
+    if(f == l)
+      return false;
+
+    size_t arity = 0;
+    msg_seq_iter name;
+    size_t length = 0;
+
+    key.tag = static_cast<boost::uint8_t>(*f);
+
+    if(decoder::decode_small_tuple_head(f, l, arity))
+      key.arity = static_cast<int>(arity);
+
+    if(decoder::decode_atom_head(f, l, name, length)) {
+      key.has_atom = true;
+      key.atom.assign(name, name + length);
+    }
+
+    return true;
+  }
+
+private:
+  pattern_key& key;
+};
+
+// An unknown part of the message key stands for a value that no clause names.
+bool may_match(const pattern_key& clause_key, const pattern_key& msg_key)
+{
+  return ((pattern_key::unknown == clause_key.tag) || (clause_key.tag == msg_key.tag)) &&
+         ((pattern_key::unknown == clause_key.arity) || (clause_key.arity == msg_key.arity)) &&
+         (!clause_key.has_atom || (msg_key.has_atom && (clause_key.atom == msg_key.atom)));
+}
+
+clause_indices candidates_for(const keys_type& keys, const pattern_key& msg_key)
+{
+  clause_indices candidates;
+
+  for(size_t i = 0; i < keys.size(); ++i) {
+    if(may_match(keys[i], msg_key))
+      candidates.push_back(i);
+  }
+
+  return candidates;
+}
+
+atom_branch compile_atoms(const keys_type& keys, pattern_key msg_key)
+{
+  atom_branch branch;
+  std::set<std::string> atoms;
+
+  for(keys_type::const_iterator k = keys.begin(); k != keys.end(); ++k) {
+    pattern_key named = msg_key;
+    named.has_atom = k->has_atom;
+    named.atom = k->atom;
+
+    if(k->has_atom && may_match(*k, named))
+      atoms.insert(k->atom);
+  }
+
+  for(std::set<std::string>::const_iterator a = atoms.begin(); a != atoms.end(); ++a) {
+    msg_key.has_atom = true;
+    msg_key.atom = *a;
+    branch.atoms[*a] = candidates_for(keys, msg_key);
+  }
+
+  msg_key.has_atom = false;
+  branch.otherwise = candidates_for(keys, msg_key);
+
+  return branch;
+}
+
+arity_branch compile_arities(const keys_type& keys, pattern_key msg_key)
+{
+  arity_branch branch;
+  std::set<int> arities;
+
+  for(keys_type::const_iterator k = keys.begin(); k != keys.end(); ++k) {
+    const bool same_tag = (pattern_key::unknown == k->tag) || (k->tag == msg_key.tag);
+
+    if(same_tag && (pattern_key::unknown != k->arity))
+      arities.insert(k->arity);
+  }
+
+  for(std::set<int>::const_iterator a = arities.begin(); a != arities.end(); ++a) {
+    msg_key.arity = *a;
+    branch.arities[*a] = compile_atoms(keys, msg_key);
+  }
+
+  msg_key.arity = pattern_key::unknown;
+  branch.otherwise = compile_atoms(keys, msg_key);
+
+  return branch;
+}
+
+bool same_key(const pattern_key& k1, const pattern_key& k2)
+{
+  return (k1.tag == k2.tag) && (k1.arity == k2.arity) && (k1.has_atom == k2.has_atom) && (k1.atom == k2.atom);
+}
+
+keys_type keys_of(const std::vector<clause>& clauses)
+{
+  keys_type keys;
+
+  for(std::vector<clause>::const_iterator c = clauses.begin(); c != clauses.end(); ++c)
+    keys.push_back(c->pattern->key());
+
+  return keys;
+}
+
+boost::shared_ptr<const decision_tree> compile_keys(const keys_type& keys)
+{
+  const boost::shared_ptr<decision_tree> tree(new decision_tree());
+  std::set<int> tags;
+
+  for(keys_type::const_iterator k = keys.begin(); k != keys.end(); ++k) {
+    if(pattern_key::unknown != k->tag)
+      tags.insert(k->tag);
+  }
+
+  pattern_key msg_key;
+
+  for(std::set<int>::const_iterator t = tags.begin(); t != tags.end(); ++t) {
+    msg_key.tag = *t;
+    tree->tags[*t] = compile_arities(keys, msg_key);
+  }
+
+  msg_key.tag = pattern_key::unknown;
+  tree->otherwise = compile_arities(keys, msg_key);
+
+  return tree;
+}
+
+const clause_indices& lookup(const decision_tree& tree, const pattern_key& msg_key)
+{
+  std::map<int, arity_branch>::const_iterator tag = tree.tags.find(msg_key.tag);
+  const arity_branch& by_arity = (tag != tree.tags.end()) ? tag->second : tree.otherwise;
+
+  std::map<int, atom_branch>::const_iterator arity = by_arity.arities.find(msg_key.arity);
+  const atom_branch& by_atom = (arity != by_arity.arities.end()) ? arity->second : by_arity.otherwise;
+
+  if(msg_key.has_atom) {
+    std::map<std::string, clause_indices>::const_iterator atom = by_atom.atoms.find(msg_key.atom);
+
+    if(atom != by_atom.atoms.end())
+      return atom->second;
+  }
+
+  return by_atom.otherwise;
+}
+
+}
+
+receive_clauses::receive_clauses(const std::vector<clause>& some_clauses)
+  : clauses(some_clauses),
+    tree(compile(some_clauses))
+{
+}
+
+receive_clauses::receive_clauses(compiled_clauses& compiled, const std::vector<clause>& some_clauses)
+  : clauses(some_clauses),
+    tree(compiled.tree_for(some_clauses))
+{
+}
+
+boost::shared_ptr<const decision_tree> receive_clauses::compile(const std::vector<clause>& clauses)
+{
+  return compile_keys(keys_of(clauses));
+}
+
+bool receive_clauses::dispatch(const matchable& msg) const
+{
+  pattern_key msg_key;
+  msg.match(key_probe(msg_key));
+
+  const clause_indices& candidates = lookup(*tree, msg_key);
+
+  for(clause_indices::const_iterator i = candidates.begin(); i != candidates.end(); ++i) {
+    const clause& c = clauses[*i];
+
+    if(msg.match(*c.pattern)) {
+      c.handler();
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool receive_clauses::receive(mailbox& mbox) const
+{
+  const matchable_ptr msg = mbox.receive();
+
+  return dispatch(*msg);
+}
+
+bool receive_clauses::receive(mailbox& mbox, time_type_sec tmo) const
+{
+  const matchable_ptr msg = mbox.receive(tmo);
+
+  return dispatch(*msg);
+}
+
+compiled_clauses::compiled_clauses()
+  : compilations_(0)
+{
+}
+
+size_t compiled_clauses::compilations() const
+{
+  boost::lock_guard<boost::mutex> lock(tree_mutex);
+
+  return compilations_;
+}
+
+// Concurrent first uses (e.g. by several threads passing the call site) compile once.
+boost::shared_ptr<const decision_tree> compiled_clauses::tree_for(const std::vector<clause>& clauses)
+{
+  const keys_type clause_keys = keys_of(clauses);
+
+  boost::lock_guard<boost::mutex> lock(tree_mutex);
+
+  const bool same_keys = tree && (clause_keys.size() == keys.size()) && 
+                         std::equal(clause_keys.begin(), clause_keys.end(), keys.begin(), same_key);
+
+  if(!same_keys) {
+    tree = compile_keys(clause_keys);
+    keys = clause_keys;
+    ++compilations_;
+  }
+
+  return tree;
+}
@@ -0,0 +1,101 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "received_msg.h"
+#include "term_index.h"
+#include <boost/thread/tss.hpp>
+
+using namespace tinch_pp;
+
+namespace {
+
+// The frames are owned by the matchables => nothing to clean-up as a thread exits.
+void no_cleanup(frame_scope*) {}
+
+// thread_specific_ptr doesn't support const types. We never modify the frame_ptr though.
+boost::thread_specific_ptr<frame_scope> current_scope(no_cleanup);
+
+}
+
+received_msg::received_msg(const frame_ptr& a_frame, size_t a_payload_offset)
+  : frame(a_frame),
+    payload_offset(a_payload_offset)
+{
+}
+
+received_msg::received_msg(const msg_seq& payload)
+  : frame(new msg_seq(payload)),
+    payload_offset(0)
+{
+}
+
+frame_scope::frame_scope(const frame_ptr& a_frame, const term_index* an_index)
+  : frame(a_frame),
+    index(an_index),
+    previous(current_scope.get())
+{
+  current_scope.reset(this);
+}
+
+frame_scope::~frame_scope()
+{
+  // Matches may be nested (e.g. a matchable_seq matched inside another match).
+  current_scope.reset(previous);
+}
+
+frame_ptr frame_scope::frame_containing(const char* data, size_t size)
+{
+  frame_ptr found;
+  const frame_scope* current = current_scope.get();
+
+  if(current && current->frame && !current->frame->empty()) {
+    const char* first = &(*current->frame)[0];
+    const char* last = first + current->frame->size();
+
+    if((first <= data) && (data + size <= last))
+      found = current->frame;
+  }
+
+  return found;
+}
+
+bool frame_scope::skip_indexed_term(msg_seq_iter& f, const msg_seq_iter& l)
+{
+  const frame_scope* current = current_scope.get();
+
+  if(!current || !current->index || !current->frame || (f == l))
+    return false;
+
+  msg_seq& matched = *current->frame;
+
+  // f may refer to a copy of (a part of) the message, which isn't indexed.
+  if(matched.empty() || (&*f < &matched[0]) || (&*f >= &matched[0] + matched.size()))
+    return false;
+
+  const term_index::node* term = current->index->find(matched, &*f - &matched[0]);
+
+  if(!term || (static_cast<size_t>(l - f) < term->length))
+    return false;
+
+  f += term->length;
+
+  return true;
+}
@@ -0,0 +1,75 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef RECEIVED_MSG_H
+#define RECEIVED_MSG_H
+
+#include "types.h"
+#include <boost/utility.hpp>
+
+namespace tinch_pp {
+
+class term_index;
+
+// A received message is kept in the frame (i.e. the buffer) it arrived in.
+// The payload (the term sent) starts at the given offset and runs to the end of 
+// the frame. Passing the frame along, instead of copying the payload out of it, 
+// allows the matchables and binary views to share the (potentially large) message.
+struct received_msg
+{
+  received_msg(const frame_ptr& a_frame, size_t a_payload_offset);
+
+  // Used for messages that didn't arrive in a frame (e.g. between mailboxes on the same node).
+  explicit received_msg(const msg_seq& payload);
+
+  frame_ptr frame;
+  size_t payload_offset;
+};
+
+// As a message is dispatched or matched, its frame is made available through the 
+// current thread. That allows a payload or a binary_view to refer to the frame 
+// instead of copying data out of it.
+class frame_scope : boost::noncopyable
+{
+public:
+  // The index, if given, is used to skip the subterms of the frame's payload.
+  explicit frame_scope(const frame_ptr& frame, const term_index* index = 0);
+
+  ~frame_scope();
+
+  // Returns the frame currently matched by this thread, given that it contains 
+  // the size bytes starting at data. Otherwise, an empty pointer is returned.
+  static frame_ptr frame_containing(const char* data, size_t size);
+
+  // Advances f past the term it refers to, given that the term is part of the 
+  // frame currently matched by this thread and found in its index.
+  // Otherwise, f is left untouched and false is returned.
+  static bool skip_indexed_term(msg_seq_iter& f, const msg_seq_iter& l);
+
+private:
+  const frame_ptr& frame;
+  const term_index* index;
+  frame_scope* previous;
+};
+
+}
+
+#endif
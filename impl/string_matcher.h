@@ -23,6 +23,7 @@
 #define STRING_MATCHER_H
 
 #include "ext_term_grammar.h"
+#include "term_decoder.h"
 #include "tinch_pp/erlang_value_types.h"
 #include <boost/bind.hpp>
 #include <algorithm>
@@ -33,16 +34,14 @@ namespace detail {
   
 struct string_matcher
 {
-  typedef std::list<erl::int_> list_type;
-
-  static bool match(const list_type& val, msg_seq_iter& f, const msg_seq_iter& l)
+  template<typename Sequence>
+  static bool match(const Sequence& val, msg_seq_iter& f, const msg_seq_iter& l)
   {
     using namespace boost;
 
     size_t parsed_length = 0;
-    string_head_ext string_head_p;
 
-    const bool success = qi::parse(f, l, string_head_p, parsed_length);
+    const bool success = decoder::decode_string_head(f, l, parsed_length);
     const bool length_matched = success && (val.size() == parsed_length);
 
     // When packed as a string, there's no encoding-tag prepended to the individual elements
@@ -51,20 +50,20 @@ struct string_matcher
                                                                ::_1, boost::ref(f), cref(l)) == false));
   }
 
-  static bool assign_match(list_type* val, msg_seq_iter& f, const msg_seq_iter& l)
+  template<typename Sequence>
+  static bool assign_match(Sequence* val, msg_seq_iter& f, const msg_seq_iter& l)
   {
-    using namespace boost;
-
     size_t parsed_length = 0;
-    string_head_ext string_head_p;
 
-    bool success = qi::parse(f, l, string_head_p, parsed_length);
+    const bool success = decoder::decode_string_head(f, l, parsed_length) && 
+                         (static_cast<size_t>(l - f) >= parsed_length);
 
-    for(size_t i = 0; success && (i < parsed_length); ++i) {
-      erl::int_::value_type matched_value;
+    if(success) {
+      // Each element is a single byte => no need to parse them one by one.
+      reserve_elements(*val, parsed_length);
 
-      success =  qi::parse(f, l, qi::byte_, matched_value);
-      val->push_back(erl::int_(matched_value));
+      for(size_t i = 0; i < parsed_length; ++i)
+        val->push_back(erl::int_(static_cast<boost::uint8_t>(*f++)));
     }
 
     return success;
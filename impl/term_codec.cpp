@@ -0,0 +1,156 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "tinch_pp/term_codec.h"
+#include "tinch_pp/exceptions.h"
+#include "matchable_seq.h"
+#include "term_compression.h"
+#include "term_encoder.h"
+#include "constants.h"
+#include <boost/lexical_cast.hpp>
+#include <limits>
+
+using namespace tinch_pp;
+
+namespace {
+
+void check_version(const msg_seq& encoded)
+{
+  if(encoded.empty())
+    throw tinch_pp_exception("Empty term - no version magic.");
+
+  const boost::uint8_t term_version = encoded[0];
+
+  if(constants::magic_version != term_version) {
+    const std::string reason = "Erroneous term version. Got = " + 
+                               boost::lexical_cast<std::string>(static_cast<int>(term_version)) +
+                               ", expected = " + boost::lexical_cast<std::string>(constants::magic_version);
+    throw tinch_pp_exception(reason);
+  }
+}
+
+}
+
+namespace tinch_pp {
+
+msg_seq term_to_binary(const erl::object& term, bool compressed)
+{
+  msg_seq encoded;
+  encoded.reserve(1 + term.encoded_size());
+  msg_seq_out_iter out(encoded);
+
+  *out++ = constants::magic_version;
+  term.serialize(out);
+
+  msg_seq deflated;
+
+  if(compressed && deflate_term(msg_seq(encoded.begin() + 1, encoded.end()), deflated)) {
+    encoded.resize(1);
+    encoded.insert(encoded.end(), deflated.begin(), deflated.end());
+  }
+
+  return encoded;
+}
+
+matchable_ptr binary_to_term(const msg_seq& encoded)
+{
+  check_version(encoded);
+
+  // The term is matched in a frame of its own, where the payload follows the version magic.
+  const frame_ptr frame(new msg_seq(encoded));
+  const msg_seq_iter term = frame->begin() + 1;
+
+  if(is_compressed_term(term, frame->end())) {
+    const frame_ptr inflated(new msg_seq());
+    inflate_term(term, frame->end(), *inflated);
+
+    return matchable_ptr(new matchable_seq(received_msg(inflated, 0)));
+  }
+
+  return matchable_ptr(new matchable_seq(received_msg(frame, 1)));
+}
+
+term_encoder::term_encoder(const chunk_sink_type& a_sink, size_t a_chunk_size)
+  : sink(a_sink),
+    chunk_size(a_chunk_size)
+{
+  chunk.reserve(chunk_size);
+  chunk.push_back(static_cast<char>(constants::magic_version));
+}
+
+void term_encoder::put(const erl::object& term)
+{
+  msg_seq_out_iter out(chunk);
+  term.serialize(out);
+
+  flush_full_chunk();
+}
+
+void term_encoder::begin_tuple(size_t arity)
+{
+  msg_seq_out_iter out(chunk);
+
+  if(arity <= std::numeric_limits<boost::uint8_t>::max()) {
+    encoder::encode_small_tuple_head(out, arity);
+  } else {
+    const int large_tuple_ext = 105;
+
+    *out++ = static_cast<char>(large_tuple_ext);
+    encoder::write_u32(out, arity);
+  }
+
+  flush_full_chunk();
+}
+
+void term_encoder::begin_list(size_t length)
+{
+  msg_seq_out_iter out(chunk);
+
+  // The empty list is nil only (written by end_list).
+  if(0 != length)
+    encoder::encode_list_head(out, length);
+
+  flush_full_chunk();
+}
+
+void term_encoder::end_list()
+{
+  msg_seq_out_iter out(chunk);
+  encoder::encode_nil(out);
+
+  flush_full_chunk();
+}
+
+void term_encoder::flush()
+{
+  if(!chunk.empty())
+    sink(&chunk[0], chunk.size());
+
+  chunk.clear();
+}
+
+void term_encoder::flush_full_chunk()
+{
+  if(chunk.size() >= chunk_size)
+    flush();
+}
+
+}
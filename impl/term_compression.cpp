@@ -0,0 +1,128 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "term_compression.h"
+#include "ext_term_grammar.h"
+#include "term_conversions.h"
+#include "tinch_pp/exceptions.h"
+#include <boost/lexical_cast.hpp>
+#include <algorithm>
+#include <zlib.h>
+
+using namespace tinch_pp;
+
+namespace {
+
+// The size of the tag and the uncompressed size preceeding the zlib data.
+const size_t compressed_head_size = 5;
+
+// The uncompressed size is given by the peer. Instead of trusting it, the 
+// inflated buffer grows (up to that size) as zlib produces output.
+const size_t initial_inflate_size = 64 * 1024;
+
+void report_corrupt_term(const std::string& reason)
+{
+  throw tinch_pp_exception("Failed to inflate compressed term: " + reason);
+}
+
+}
+
+namespace tinch_pp {
+
+bool is_compressed_term(const msg_seq_iter& f, const msg_seq_iter& l)
+{
+  return (f != l) && (type_tag::compressed_ext == static_cast<boost::uint8_t>(*f));
+}
+
+void inflate_term(const msg_seq_iter& f, const msg_seq_iter& l, msg_seq& inflated)
+{
+  msg_seq_iter zlib_data = f;
+  size_t uncompressed_size = 0;
+
+  if(!binary_to_term<compressed_head_ext>(zlib_data, l, uncompressed_size) || (0 == uncompressed_size))
+    report_corrupt_term("invalid header");
+
+  inflated.resize(std::min(uncompressed_size, initial_inflate_size));
+
+  z_stream stream = z_stream();
+  stream.next_in = reinterpret_cast<Bytef*>(&*zlib_data);
+  stream.avail_in = static_cast<uInt>(l - zlib_data);
+
+  if(Z_OK != inflateInit(&stream))
+    report_corrupt_term("zlib initialization failed");
+
+  int result = Z_OK;
+
+  while(Z_OK == result) {
+    if(stream.total_out == inflated.size()) {
+      if(inflated.size() == uncompressed_size)
+        break;
+
+      inflated.resize(std::min(uncompressed_size, 2 * inflated.size()));
+    }
+
+    stream.next_out = reinterpret_cast<Bytef*>(&inflated[stream.total_out]);
+    stream.avail_out = static_cast<uInt>(inflated.size() - stream.total_out);
+
+    result = inflate(&stream, Z_NO_FLUSH);
+  }
+
+  const size_t actual_size = stream.total_out;
+  inflateEnd(&stream);
+
+  if(Z_OK == result)
+    report_corrupt_term("no end of data within the expected " + 
+                        boost::lexical_cast<std::string>(uncompressed_size) + " bytes");
+
+  if(Z_STREAM_END != result)
+    report_corrupt_term("zlib error " + boost::lexical_cast<std::string>(result));
+
+  if(uncompressed_size != actual_size)
+    report_corrupt_term("expected " + boost::lexical_cast<std::string>(uncompressed_size) + 
+                        " bytes, got " + boost::lexical_cast<std::string>(actual_size));
+}
+
+bool deflate_term(const msg_seq& term, msg_seq& compressed)
+{
+  if(term.empty())
+    return false;
+
+  uLongf zlib_size = compressBound(term.size());
+
+  compressed.clear();
+  compressed.reserve(compressed_head_size + zlib_size);
+
+  msg_seq_out_iter out(compressed);
+  term_to_binary<compressed_head_g>(out, term.size());
+
+  compressed.resize(compressed_head_size + zlib_size);
+
+  const int result = compress(reinterpret_cast<Bytef*>(&compressed[compressed_head_size]), &zlib_size,
+                              reinterpret_cast<const Bytef*>(&term[0]), term.size());
+  if(Z_OK != result)
+    return false;
+
+  compressed.resize(compressed_head_size + zlib_size);
+
+  return compressed.size() < term.size();
+}
+
+}
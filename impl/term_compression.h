@@ -0,0 +1,50 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef TERM_COMPRESSION_H
+#define TERM_COMPRESSION_H
+
+#include "types.h"
+
+namespace tinch_pp {
+
+// Erlang may send compressed terms (term_to_binary(Term, [compressed])).
+// Such a term starts with the tag 80 followed by the uncompressed size and the 
+// zlib compressed term. These functions convert between the two formats.
+// In both directions, the terms are given without the version magic.
+
+// Returns true if the term starting at f is compressed.
+bool is_compressed_term(const msg_seq_iter& f, const msg_seq_iter& l);
+
+// Inflates the compressed term [f, l) into the given buffer, replacing its content.
+// The buffer is typically reused between calls in order to avoid re-allocations.
+// Throws tinch_pp_exception in case the term is corrupt, which includes a term 
+// inflating to another size than the one given in its header.
+void inflate_term(const msg_seq_iter& f, const msg_seq_iter& l, msg_seq& inflated);
+
+// Compresses the given term into the given buffer, replacing its content.
+// Returns false if the compressed term wouldn't be smaller than the original, in 
+// which case the content of the buffer is unspecified.
+bool deflate_term(const msg_seq& term, msg_seq& compressed);
+
+}
+
+#endif
@@ -0,0 +1,272 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef TERM_DECODER_H
+#define TERM_DECODER_H
+
+#include "types.h"
+#include "ext_term_grammar.h"
+#include <boost/cstdint.hpp>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <string>
+
+namespace tinch_pp {
+namespace decoder {
+
+// The terms we receive most frequently (integers, atoms, tuple and list heads, 
+// strings, binaries, pids) are decoded by hand instead of through the Spirit 
+// grammars in ext_term_grammar.h. The decoders are plain, inlined functions 
+// that don't construct any parser objects.
+// The grammars remain the reference; each decoder accepts exactly the input 
+// its grammar does and produces the same attribute (see test/term_decoder_bench.cpp).
+//
+// All decoders share the semantics of qi::parse: on success f is advanced past 
+// the decoded term, on failure f is left untouched.
+
+inline boost::uint32_t read_u16(msg_seq_iter i)
+{
+  return (static_cast<boost::uint32_t>(static_cast<boost::uint8_t>(i[0])) << 8) | 
+          static_cast<boost::uint8_t>(i[1]);
+}
+
+inline boost::uint32_t read_u32(msg_seq_iter i)
+{
+  return (static_cast<boost::uint32_t>(static_cast<boost::uint8_t>(i[0])) << 24) | 
+         (static_cast<boost::uint32_t>(static_cast<boost::uint8_t>(i[1])) << 16) | 
+         (static_cast<boost::uint32_t>(static_cast<boost::uint8_t>(i[2])) << 8) | 
+          static_cast<boost::uint32_t>(static_cast<boost::uint8_t>(i[3]));
+}
+
+inline size_t available(const msg_seq_iter& f, const msg_seq_iter& l)
+{
+  return static_cast<size_t>(l - f);
+}
+
+inline bool has_tag(const msg_seq_iter& f, const msg_seq_iter& l, int tag)
+{
+  return (f != l) && (static_cast<boost::uint8_t>(*f) == tag);
+}
+
+// SMALL_INTEGER_EXT | INTEGER_EXT
+inline bool decode_integer(msg_seq_iter& f, const msg_seq_iter& l, boost::int32_t& val)
+{
+  if(f == l)
+    return false;
+
+  switch(static_cast<boost::uint8_t>(*f)) {
+  case type_tag::small_integer:
+    if(available(f, l) < 2)
+      return false;
+    val = static_cast<boost::uint8_t>(f[1]);
+    f += 2;
+    return true;
+  case type_tag::integer:
+    if(available(f, l) < 5)
+      return false;
+    val = static_cast<boost::int32_t>(read_u32(f + 1));
+    f += 5;
+    return true;
+  }
+
+  return false;
+}
+
+// FLOAT_EXT: the float formatted as by printf, padded with zeros.
+inline bool decode_float(msg_seq_iter& f, const msg_seq_iter& l, double& val)
+{
+  char digits[64] = {0};
+  const size_t n = constants::float_digits;
+
+  if(!has_tag(f, l, type_tag::float_ext) || (available(f, l) < 1 + n) || (n >= sizeof digits))
+    return false;
+
+  std::copy(f + 1, f + 1 + n, digits);
+  val = std::strtod(digits, 0);
+  f += 1 + n;
+
+  return true;
+}
+
+// NEW_FLOAT_EXT: the float as a big-endian IEEE double. tinch++ has no grammar 
+// for it (it's never sent), but newer Erlang versions send their floats that way.
+inline bool decode_new_float(msg_seq_iter& f, const msg_seq_iter& l, double& val)
+{
+  const int new_float_ext = 70;
+
+  if(!has_tag(f, l, new_float_ext) || (available(f, l) < 1 + 8))
+    return false;
+
+  const boost::uint64_t bits = (static_cast<boost::uint64_t>(read_u32(f + 1)) << 32) | read_u32(f + 5);
+
+  std::memcpy(&val, &bits, sizeof val);
+  f += 1 + 8;
+
+  return true;
+}
+
+// Tag, the (2 byte) length and the characters have to be present. On success, 
+// name points to the first character of the atom.
+inline bool decode_atom_head(msg_seq_iter& f, const msg_seq_iter& l, msg_seq_iter& name, size_t& length)
+{
+  if(!has_tag(f, l, type_tag::atom_ext) || (available(f, l) < 3))
+    return false;
+
+  const size_t n = read_u16(f + 1);
+
+  if(available(f, l) < 3 + n)
+    return false;
+
+  name = f + 3;
+  length = n;
+  f += 3 + n;
+
+  return true;
+}
+
+inline bool decode_atom(msg_seq_iter& f, const msg_seq_iter& l, std::string& val)
+{
+  msg_seq_iter name;
+  size_t length = 0;
+
+  if(!decode_atom_head(f, l, name, length))
+    return false;
+
+  val.assign(name, name + length);
+
+  return true;
+}
+
+// Compares the atom in place; no string is constructed.
+// Note that f is advanced past a well-formed atom even if it doesn't match.
+inline bool match_atom(msg_seq_iter& f, const msg_seq_iter& l, const std::string& val)
+{
+  msg_seq_iter name;
+  size_t length = 0;
+
+  return decode_atom_head(f, l, name, length) && (length == val.size()) && 
+         ((0 == length) || (0 == std::memcmp(&*name, val.data(), length)));
+}
+
+// Compares the input with the given, pre-encoded term (e.g. a literal in a pattern).
+inline bool match_encoded(msg_seq_iter& f, const msg_seq_iter& l, const std::string& encoded)
+{
+  if((available(f, l) < encoded.size()) || (0 != std::memcmp(&*f, encoded.data(), encoded.size())))
+    return false;
+
+  f += encoded.size();
+
+  return true;
+}
+
+// PID_EXT: the node name (an atom) followed by the ID, the serial and the creation.
+inline bool decode_pid(msg_seq_iter& f, const msg_seq_iter& l, e_pid& val)
+{
+  msg_seq_iter i = f;
+  msg_seq_iter name;
+  size_t length = 0;
+
+  if(!has_tag(i, l, type_tag::pid))
+    return false;
+  ++i;
+
+  if(!decode_atom_head(i, l, name, length) || (available(i, l) < 4 + 4 + 1))
+    return false;
+
+  val.node_name.assign(name, name + length);
+  val.id = read_u32(i);
+  val.serial = read_u32(i + 4);
+  val.creation = static_cast<boost::uint8_t>(i[8]);
+  f = i + 9;
+
+  return true;
+}
+
+inline bool decode_small_tuple_head(msg_seq_iter& f, const msg_seq_iter& l, size_t& arity)
+{
+  if(!has_tag(f, l, type_tag::small_tuple) || (available(f, l) < 2))
+    return false;
+
+  arity = static_cast<boost::uint8_t>(f[1]);
+  f += 2;
+
+  return true;
+}
+
+inline bool decode_list_head(msg_seq_iter& f, const msg_seq_iter& l, size_t& length)
+{
+  if(!has_tag(f, l, type_tag::list) || (available(f, l) < 5))
+    return false;
+
+  length = read_u32(f + 1);
+  f += 5;
+
+  return true;
+}
+
+inline bool decode_nil(msg_seq_iter& f, const msg_seq_iter& l)
+{
+  if(!has_tag(f, l, type_tag::nil_ext))
+    return false;
+
+  ++f;
+
+  return true;
+}
+
+// Only the head; the characters follow.
+inline bool decode_string_head(msg_seq_iter& f, const msg_seq_iter& l, size_t& length)
+{
+  if(!has_tag(f, l, type_tag::string_ext) || (available(f, l) < 3))
+    return false;
+
+  length = read_u16(f + 1);
+  f += 3;
+
+  return true;
+}
+
+// BINARY_EXT | BIT_BINARY_EXT. Only the head; the bytes follow.
+// A binary is reported with zero padding bits.
+inline bool decode_binary_head(msg_seq_iter& f, const msg_seq_iter& l, size_t& length, int& padding_bits)
+{
+  if(has_tag(f, l, type_tag::binary_ext) && (available(f, l) >= 5)) {
+    length = read_u32(f + 1);
+    padding_bits = 0;
+    f += 5;
+    return true;
+  }
+
+  if(has_tag(f, l, type_tag::bit_binary_ext) && (available(f, l) >= 6)) {
+    length = read_u32(f + 1);
+    padding_bits = static_cast<boost::uint8_t>(f[5]);
+    f += 6;
+    return true;
+  }
+
+  return false;
+}
+
+}
+}
+
+#endif
@@ -0,0 +1,177 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef TERM_ENCODER_H
+#define TERM_ENCODER_H
+
+#include "types.h"
+#include "constants.h"
+#include "ext_term_grammar.h"
+#include <boost/cstdint.hpp>
+#include <cstdio>
+#include <string>
+
+namespace tinch_pp {
+namespace encoder {
+
+// The counterpart of term_decoder.h: the common terms are encoded by hand, 
+// straight into the output, instead of through the Karma generators.
+// Each encoder produces exactly the bytes of the corresponding generator in 
+// ext_term_grammar.h and comes with the size of its encoding.
+
+inline void write_u16(msg_seq_out_iter& out, boost::uint32_t n)
+{
+  *out++ = static_cast<char>((n >> 8) & 0xFF);
+  *out++ = static_cast<char>(n & 0xFF);
+}
+
+inline void write_u32(msg_seq_out_iter& out, boost::uint32_t n)
+{
+  write_u16(out, n >> 16);
+  write_u16(out, n);
+}
+
+// In the name of optimization, Erlang packs small integer values (0-0xFF).
+inline bool is_small_integer(boost::int32_t val)
+{
+  return (val >= 0) && (val <= 0xFF);
+}
+
+// SMALL_INTEGER_EXT | INTEGER_EXT
+inline void encode_integer(msg_seq_out_iter& out, boost::int32_t val)
+{
+  if(is_small_integer(val)) {
+    *out++ = static_cast<char>(type_tag::small_integer);
+    *out++ = static_cast<char>(val);
+  } else {
+    *out++ = static_cast<char>(type_tag::integer);
+    write_u32(out, static_cast<boost::uint32_t>(val));
+  }
+}
+
+inline size_t integer_size(boost::int32_t val)
+{
+  return is_small_integer(val) ? 2 : 5;
+}
+
+// FLOAT_EXT: the float formatted as by printf, padded with zeros.
+inline void encode_float(msg_seq_out_iter& out, double val)
+{
+  char formatted[64] = {0};
+  std::sprintf(formatted, "%.20e", val);
+
+  *out++ = static_cast<char>(type_tag::float_ext);
+
+  for(int i = 0; i < constants::float_digits; ++i)
+    *out++ = formatted[i];
+}
+
+inline size_t float_size()
+{
+  return 1 + constants::float_digits;
+}
+
+inline void encode_chars(msg_seq_out_iter& out, const std::string& chars)
+{
+  std::copy(chars.begin(), chars.end(), out);
+}
+
+inline void encode_atom(msg_seq_out_iter& out, const std::string& name)
+{
+  *out++ = static_cast<char>(type_tag::atom_ext);
+  write_u16(out, name.size());
+  encode_chars(out, name);
+}
+
+inline size_t atom_size(const std::string& name)
+{
+  return 3 + name.size();
+}
+
+// STRING_EXT
+inline void encode_string(msg_seq_out_iter& out, const std::string& chars)
+{
+  *out++ = static_cast<char>(type_tag::string_ext);
+  write_u16(out, chars.size());
+  encode_chars(out, chars);
+}
+
+inline size_t string_size(const std::string& chars)
+{
+  return 3 + chars.size();
+}
+
+// BINARY_EXT | BIT_BINARY_EXT
+inline void encode_binary(msg_seq_out_iter& out, const binary_value_type& binary)
+{
+  const bool has_padding_bits = 0 < binary.padding_bits;
+
+  *out++ = static_cast<char>(has_padding_bits ? type_tag::bit_binary_ext : type_tag::binary_ext);
+  write_u32(out, binary.value.size());
+
+  if(has_padding_bits)
+    *out++ = static_cast<char>(binary.padding_bits);
+
+  std::copy(binary.value.begin(), binary.value.end(), out);
+}
+
+inline size_t binary_size(const binary_value_type& binary)
+{
+  return ((0 < binary.padding_bits) ? 6 : 5) + binary.value.size();
+}
+
+// PID_EXT: the node name (an atom) followed by the ID, the serial and the creation.
+inline void encode_pid(msg_seq_out_iter& out, const e_pid& pid)
+{
+  *out++ = static_cast<char>(type_tag::pid);
+  encode_atom(out, pid.node_name);
+  write_u32(out, pid.id);
+  write_u32(out, pid.serial);
+  *out++ = static_cast<char>(pid.creation);
+}
+
+inline size_t pid_size(const e_pid& pid)
+{
+  return 1 + atom_size(pid.node_name) + 4 + 4 + 1;
+}
+
+inline void encode_small_tuple_head(msg_seq_out_iter& out, size_t arity)
+{
+  *out++ = static_cast<char>(type_tag::small_tuple);
+  *out++ = static_cast<char>(arity);
+}
+
+// Only the head; the elements and the tail follow.
+inline void encode_list_head(msg_seq_out_iter& out, size_t length)
+{
+  *out++ = static_cast<char>(type_tag::list);
+  write_u32(out, length);
+}
+
+inline void encode_nil(msg_seq_out_iter& out)
+{
+  *out++ = static_cast<char>(type_tag::nil_ext);
+}
+
+}
+}
+
+#endif
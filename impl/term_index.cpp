@@ -0,0 +1,153 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "term_index.h"
+#include "term_skipper.h"
+#include "ext_term_grammar.h"
+#include <boost/thread/locks.hpp>
+#include <algorithm>
+
+using namespace tinch_pp;
+
+namespace {
+
+const int large_tuple_ext = 105;
+
+typedef term_index::node node;
+typedef term_index::nodes_type nodes_type;
+
+bool read_length(msg_seq_iter& f, const msg_seq_iter& l, size_t length_size, size_t& n)
+{
+  if(static_cast<size_t>(l - f) < length_size)
+    return false;
+
+  n = 0;
+
+  for(size_t i = 0; i < length_size; ++i)
+    n = (n << 8) | static_cast<boost::uint8_t>(*f++);
+
+  return true;
+}
+
+bool index_term(msg_seq_iter& f, const msg_seq_iter& l, const msg_seq_iter& start, nodes_type& nodes);
+
+bool index_terms(msg_seq_iter& f, const msg_seq_iter& l, const msg_seq_iter& start, size_t n, nodes_type& nodes)
+{
+  bool indexed = true;
+
+  for(size_t i = 0; indexed && (i < n); ++i)
+    indexed = index_term(f, l, start, nodes);
+
+  return indexed;
+}
+
+// Only the compound terms have to be traversed; the other terms are indexed as a whole.
+bool index_children(msg_seq_iter& f, const msg_seq_iter& l, const msg_seq_iter& start, int tag, nodes_type& nodes)
+{
+  size_t n = 0;
+
+  switch(tag) {
+  case type_tag::small_tuple:
+    return read_length(++f, l, 1, n) && index_terms(f, l, start, n, nodes);
+  case large_tuple_ext:
+    return read_length(++f, l, 4, n) && index_terms(f, l, start, n, nodes);
+  case type_tag::list:
+    // The elements are followed by the tail (nil for proper lists).
+    return read_length(++f, l, 4, n) && index_terms(f, l, start, n + 1, nodes);
+  case type_tag::map_ext:
+    return read_length(++f, l, 4, n) && index_terms(f, l, start, 2 * n, nodes);
+  default:
+    return walk_term(f, l);
+  }
+}
+
+bool index_term(msg_seq_iter& f, const msg_seq_iter& l, const msg_seq_iter& start, nodes_type& nodes)
+{
+  if(f == l)
+    return false;
+
+  const size_t position = nodes.size();
+  const node term = {static_cast<boost::uint8_t>(*f), static_cast<size_t>(f - start), 0};
+
+  nodes.push_back(term);
+
+  if(!index_children(f, l, start, term.tag, nodes))
+    return false;
+
+  nodes[position].length = (f - start) - term.offset;
+
+  return true;
+}
+
+bool starts_before(const node& n, size_t offset)
+{
+  return n.offset < offset;
+}
+
+}
+
+term_index::term_index(size_t a_payload_offset)
+  : payload_offset(a_payload_offset),
+    built(false)
+{
+}
+
+const term_index::node* term_index::find(msg_seq& frame, size_t frame_offset) const
+{
+  const nodes_type& all = nodes(frame);
+
+  if(frame_offset < payload_offset)
+    return 0;
+
+  // The nodes are stored in pre-order => sorted on their offsets.
+  const size_t offset = frame_offset - payload_offset;
+  nodes_type::const_iterator found = std::lower_bound(all.begin(), all.end(), offset, starts_before);
+
+  if((found == all.end()) || (found->offset != offset))
+    return 0;
+
+  return &*found;
+}
+
+const term_index::nodes_type& term_index::nodes(msg_seq& frame) const
+{
+  boost::lock_guard<boost::mutex> lock(build_mutex);
+
+  if(!built)
+    build(frame);
+
+  return indexed;
+}
+
+void term_index::build(msg_seq& frame) const
+{
+  built = true;
+
+  if(frame.size() < payload_offset)
+    return;
+
+  const msg_seq_iter start = frame.begin() + payload_offset;
+  msg_seq_iter f = start;
+
+  // A malformed payload isn't indexed at all; matching falls back to parsing.
+  if(!index_term(f, frame.end(), start, indexed))
+    nodes_type().swap(indexed);
+}
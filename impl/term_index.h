@@ -0,0 +1,73 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef TERM_INDEX_H
+#define TERM_INDEX_H
+
+#include "types.h"
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/utility.hpp>
+#include <vector>
+
+namespace tinch_pp {
+
+// A structural index of a received term: the tag, offset and length of each 
+// node (term and subterm) in pre-order. The index is built lazily, the first 
+// time a match needs to skip a subterm; later matches on the same message 
+// locate the end of a subterm in the index instead of parsing it again.
+// Concurrent matches on the same message race for the build => it's locked.
+class term_index : boost::noncopyable
+{
+public:
+  struct node
+  {
+    boost::uint8_t tag;
+    // Relative to the start of the payload.
+    size_t offset;
+    size_t length;
+  };
+
+  typedef std::vector<node> nodes_type;
+
+  /// The payload (the indexed term) starts at the given offset into its frame.
+  explicit term_index(size_t payload_offset);
+
+  /// Looks-up the term starting at the given offset into the frame.
+  /// Returns 0 if no term starts there (or the payload isn't well-formed).
+  const node* find(msg_seq& frame, size_t frame_offset) const;
+
+  const nodes_type& nodes(msg_seq& frame) const;
+
+private:
+  void build(msg_seq& frame) const;
+
+  size_t payload_offset;
+
+  // Built on demand by the (logically const) look-ups; never modified once built.
+  mutable boost::mutex build_mutex;
+  mutable bool built;
+  mutable nodes_type indexed;
+};
+
+}
+
+#endif
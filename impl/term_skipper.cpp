@@ -0,0 +1,226 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "term_skipper.h"
+#include "ext_term_grammar.h"
+#include "received_msg.h"
+
+using namespace tinch_pp;
+
+namespace {
+
+// Tags of the external format that tinch++ cannot match (yet), but which may 
+// be part of the terms we receive and thus have to be skipped.
+namespace unsupported_tag {
+  const int new_float_ext       = 70;
+  const int new_pid_ext         = 88;
+  const int new_port_ext        = 89;
+  const int newer_reference_ext = 90;
+  const int reference_ext       = 101;
+  const int port_ext            = 102;
+  const int large_tuple_ext     = 105;
+  const int small_big_ext       = 110;
+  const int large_big_ext       = 111;
+  const int new_fun_ext         = 112;
+  const int export_ext          = 113;
+  const int small_atom_ext      = 115;
+  const int atom_utf8_ext       = 118;
+  const int small_atom_utf8_ext = 119;
+}
+
+bool skip_bytes(msg_seq_iter& f, const msg_seq_iter& l, size_t n)
+{
+  if(static_cast<size_t>(l - f) < n)
+    return false;
+
+  f += n;
+
+  return true;
+}
+
+bool read_u8(msg_seq_iter& f, const msg_seq_iter& l, size_t& n)
+{
+  if(f == l)
+    return false;
+
+  n = static_cast<boost::uint8_t>(*f++);
+
+  return true;
+}
+
+bool read_u16(msg_seq_iter& f, const msg_seq_iter& l, size_t& n)
+{
+  if((l - f) < 2)
+    return false;
+
+  n = (static_cast<boost::uint8_t>(f[0]) << 8) | static_cast<boost::uint8_t>(f[1]);
+  f += 2;
+
+  return true;
+}
+
+bool read_u32(msg_seq_iter& f, const msg_seq_iter& l, size_t& n)
+{
+  if((l - f) < 4)
+    return false;
+
+  n = (static_cast<boost::uint32_t>(static_cast<boost::uint8_t>(f[0])) << 24) | 
+      (static_cast<boost::uint8_t>(f[1]) << 16) | 
+      (static_cast<boost::uint8_t>(f[2]) << 8) | 
+      static_cast<boost::uint8_t>(f[3]);
+  f += 4;
+
+  return true;
+}
+
+bool skip_terms(msg_seq_iter& f, const msg_seq_iter& l, size_t n)
+{
+  bool skipped = true;
+
+  for(size_t i = 0; skipped && (i < n); ++i)
+    skipped = walk_term(f, l);
+
+  return skipped;
+}
+
+// The length field, of the given size, is followed by that number of bytes.
+bool skip_sized(msg_seq_iter& f, const msg_seq_iter& l, size_t length_size)
+{
+  size_t n = 0;
+  bool read = false;
+
+  switch(length_size) {
+  case 1: read = read_u8(f, l, n);  break;
+  case 2: read = read_u16(f, l, n); break;
+  case 4: read = read_u32(f, l, n); break;
+  }
+
+  return read && skip_bytes(f, l, n);
+}
+
+// Used for the length prefixed terms (tuples, maps): skips the given number of 
+// terms for each unit in the length.
+bool skip_compound(msg_seq_iter& f, const msg_seq_iter& l, size_t length_size, size_t terms_per_unit)
+{
+  size_t n = 0;
+  const bool read = (length_size == 1) ? read_u8(f, l, n) : read_u32(f, l, n);
+
+  return read && skip_terms(f, l, n * terms_per_unit);
+}
+
+}
+
+namespace tinch_pp {
+
+bool walk_term(msg_seq_iter& f, const msg_seq_iter& l)
+{
+  using namespace unsupported_tag;
+
+  if(f == l)
+    return false;
+
+  const int tag = static_cast<boost::uint8_t>(*f++);
+
+  switch(tag) {
+  case type_tag::small_integer:
+  case type_tag::atom_cache_ref:
+    return skip_bytes(f, l, 1);
+  case type_tag::integer:
+    return skip_bytes(f, l, 4);
+  case new_float_ext:
+    return skip_bytes(f, l, 8);
+  case type_tag::float_ext:
+    return skip_bytes(f, l, constants::float_digits);
+  case type_tag::atom_ext:
+  case atom_utf8_ext:
+  case type_tag::string_ext:
+    return skip_sized(f, l, 2);
+  case small_atom_ext:
+  case small_atom_utf8_ext:
+    return skip_sized(f, l, 1);
+  case type_tag::binary_ext:
+    return skip_sized(f, l, 4);
+  case type_tag::bit_binary_ext:
+    {
+      size_t n = 0;
+      return read_u32(f, l, n) && skip_bytes(f, l, 1 + n);
+    }
+  case small_big_ext:
+    {
+      size_t n = 0;
+      return read_u8(f, l, n) && skip_bytes(f, l, 1 + n);
+    }
+  case large_big_ext:
+    {
+      size_t n = 0;
+      return read_u32(f, l, n) && skip_bytes(f, l, 1 + n);
+    }
+  case type_tag::pid:
+    return walk_term(f, l) && skip_bytes(f, l, 4 + 4 + 1);
+  case new_pid_ext:
+    return walk_term(f, l) && skip_bytes(f, l, 4 + 4 + 4);
+  case port_ext:
+  case reference_ext:
+    return walk_term(f, l) && skip_bytes(f, l, 4 + 1);
+  case new_port_ext:
+    return walk_term(f, l) && skip_bytes(f, l, 4 + 4);
+  case type_tag::new_reference_ext:
+  case newer_reference_ext:
+    {
+      // The ID words follow the node name and the creation.
+      size_t id_length = 0;
+      const size_t creation_size = (tag == type_tag::new_reference_ext) ? 1 : 4;
+
+      return read_u16(f, l, id_length) && walk_term(f, l) && skip_bytes(f, l, creation_size + 4 * id_length);
+    }
+  case type_tag::small_tuple:
+    return skip_compound(f, l, 1, 1);
+  case large_tuple_ext:
+    return skip_compound(f, l, 4, 1);
+  case type_tag::map_ext:
+    return skip_compound(f, l, 4, 2);
+  case type_tag::nil_ext:
+    return true;
+  case type_tag::list:
+    // The elements are followed by the tail (nil for proper lists).
+    {
+      size_t n = 0;
+      return read_u32(f, l, n) && skip_terms(f, l, n + 1);
+    }
+  case export_ext:
+    return skip_terms(f, l, 3);
+  case new_fun_ext:
+    {
+      // The size includes the size field itself.
+      size_t size = 0;
+      return read_u32(f, l, size) && (size >= 4) && skip_bytes(f, l, size - 4);
+    }
+  default:
+    return false;
+  }
+}
+
+bool skip_term(msg_seq_iter& f, const msg_seq_iter& l)
+{
+  return frame_scope::skip_indexed_term(f, l) || walk_term(f, l);
+}
+
+}
@@ -0,0 +1,43 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef TERM_SKIPPER_H
+#define TERM_SKIPPER_H
+
+#include "types.h"
+
+namespace tinch_pp {
+
+// Some operations need to know where a term ends without caring about its value 
+// (e.g. locating the values in a map). Instead of decoding such terms, we just 
+// step over them.
+// Advances f past the term starting at f. Returns false in case the term is 
+// incomplete or of an unknown type (f is undefined in that case).
+// The end of the term is looked-up in the index of the currently matched 
+// message (see term_index.h), if any; otherwise the term is parsed.
+bool skip_term(msg_seq_iter& f, const msg_seq_iter& l);
+
+// Advances f past the term by parsing it, without consulting any index.
+bool walk_term(msg_seq_iter& f, const msg_seq_iter& l);
+
+}
+
+#endif
@@ -0,0 +1,343 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "tinch_pp/term_visitor.h"
+#include "tinch_pp/erl_object.h"
+#include "ext_term_grammar.h"
+#include "term_conversions.h"
+#include "term_decoder.h"
+#include "term_skipper.h"
+#include "received_msg.h"
+#include <cstring>
+
+using namespace tinch_pp;
+
+namespace {
+
+// Tags decoded by the visitor in addition to the ones tinch++ matches.
+namespace visited_tag {
+  const int new_float_ext       = 70;
+  const int large_tuple_ext     = 105;
+  const int small_atom_ext      = 115;
+  const int atom_utf8_ext       = 118;
+  const int small_atom_utf8_ext = 119;
+}
+
+// The compound terms are visited recursively. A message nested deeper than 
+// this (e.g. a malicious one) fails the visit instead of overflowing the stack.
+const size_t max_depth = 1000;
+
+const char* chars_at(const msg_seq_iter& i, size_t length)
+{
+  return (0 == length) ? "" : &*i;
+}
+
+bool visit_term(msg_seq_iter& f, const msg_seq_iter& l, term_visitor& visitor, size_t depth);
+
+bool visit_terms(msg_seq_iter& f, const msg_seq_iter& l, size_t n, term_visitor& visitor, size_t depth)
+{
+  bool visited = true;
+
+  for(size_t i = 0; visited && (i < n); ++i)
+    visited = visit_term(f, l, visitor, depth);
+
+  return visited;
+}
+
+// A tag followed by the length (of the given size) of the value.
+bool read_head(msg_seq_iter& f, const msg_seq_iter& l, size_t length_size, size_t& length)
+{
+  if(decoder::available(f, l) < 1 + length_size)
+    return false;
+
+  length = (1 == length_size) ? static_cast<boost::uint8_t>(f[1]) : 
+           (2 == length_size) ? decoder::read_u16(f + 1) : decoder::read_u32(f + 1);
+  f += 1 + length_size;
+
+  return true;
+}
+
+bool visit_int(msg_seq_iter& f, const msg_seq_iter& l, term_visitor& visitor)
+{
+  boost::int32_t value = 0;
+
+  if(!decoder::decode_integer(f, l, value))
+    return false;
+
+  visitor.on_int(value);
+
+  return true;
+}
+
+bool visit_atom(msg_seq_iter& f, const msg_seq_iter& l, size_t length_size, term_visitor& visitor)
+{
+  size_t length = 0;
+
+  if(!read_head(f, l, length_size, length) || (decoder::available(f, l) < length))
+    return false;
+
+  visitor.on_atom(chars_at(f, length), length);
+  f += length;
+
+  return true;
+}
+
+bool visit_string(msg_seq_iter& f, const msg_seq_iter& l, term_visitor& visitor)
+{
+  size_t length = 0;
+
+  if(!decoder::decode_string_head(f, l, length) || (decoder::available(f, l) < length))
+    return false;
+
+  visitor.on_string(chars_at(f, length), length);
+  f += length;
+
+  return true;
+}
+
+// FLOAT_EXT: the float as a null-padded string (as formatted by printf).
+bool visit_float(msg_seq_iter& f, const msg_seq_iter& l, term_visitor& visitor)
+{
+  double value = 0.0;
+
+  if(!decoder::decode_float(f, l, value))
+    return false;
+
+  visitor.on_float(value);
+
+  return true;
+}
+
+// NEW_FLOAT_EXT: the float as a big-endian IEEE double.
+bool visit_new_float(msg_seq_iter& f, const msg_seq_iter& l, term_visitor& visitor)
+{
+  if(decoder::available(f, l) < 1 + 8)
+    return false;
+
+  const boost::uint64_t bits = (static_cast<boost::uint64_t>(decoder::read_u32(f + 1)) << 32) | decoder::read_u32(f + 5);
+
+  double value = 0.0;
+  std::memcpy(&value, &bits, sizeof value);
+
+  visitor.on_float(value);
+  f += 1 + 8;
+
+  return true;
+}
+
+bool visit_binary(msg_seq_iter& f, const msg_seq_iter& l, term_visitor& visitor)
+{
+  size_t length = 0;
+  int padding_bits = 0;
+
+  if(!decoder::decode_binary_head(f, l, length, padding_bits) || (decoder::available(f, l) < length))
+    return false;
+
+  const char* data = (0 == length) ? 0 : &*f;
+  frame_ptr frame = frame_scope::frame_containing(data, length);
+
+  // Not visiting a received message (e.g. a matchable_range) => we have to copy.
+  if(!frame && (0 != length)) {
+    frame.reset(new msg_seq(f, f + length));
+    data = &(*frame)[0];
+  }
+
+  visitor.on_binary(binary_view(frame, data, length, padding_bits));
+  f += length;
+
+  return true;
+}
+
+bool visit_pid(msg_seq_iter& f, const msg_seq_iter& l, term_visitor& visitor)
+{
+  e_pid pid;
+
+  if(!decoder::decode_pid(f, l, pid))
+    return false;
+
+  visitor.on_pid(pid);
+
+  return true;
+}
+
+bool visit_reference(msg_seq_iter& f, const msg_seq_iter& l, term_visitor& visitor)
+{
+  new_reference_type reference;
+
+  if(!binary_to_term<new_reference_ext_p>(f, l, reference))
+    return false;
+
+  visitor.on_reference(reference);
+
+  return true;
+}
+
+bool visit_tuple(msg_seq_iter& f, const msg_seq_iter& l, size_t length_size, term_visitor& visitor, size_t depth)
+{
+  size_t arity = 0;
+
+  if(!read_head(f, l, length_size, arity))
+    return false;
+
+  visitor.on_tuple_begin(arity);
+
+  if(!visit_terms(f, l, arity, visitor, depth + 1))
+    return false;
+
+  visitor.on_tuple_end();
+
+  return true;
+}
+
+bool visit_list(msg_seq_iter& f, const msg_seq_iter& l, term_visitor& visitor, size_t depth)
+{
+  size_t length = 0;
+
+  if(!decoder::decode_list_head(f, l, length))
+    return false;
+
+  visitor.on_list_begin(length);
+
+  if(!visit_terms(f, l, length, visitor, depth + 1))
+    return false;
+
+  // Only the tail of an improper list is visited.
+  if(!decoder::decode_nil(f, l) && !visit_term(f, l, visitor, depth + 1))
+    return false;
+
+  visitor.on_list_end();
+
+  return true;
+}
+
+bool visit_nil(msg_seq_iter& f, const msg_seq_iter& l, term_visitor& visitor)
+{
+  ++f;
+
+  visitor.on_list_begin(0);
+  visitor.on_list_end();
+
+  return true;
+}
+
+bool visit_map(msg_seq_iter& f, const msg_seq_iter& l, term_visitor& visitor, size_t depth)
+{
+  size_t arity = 0;
+
+  if(!read_head(f, l, 4, arity))
+    return false;
+
+  visitor.on_map_begin(arity);
+
+  // Each association is encoded as a key followed by its value.
+  if(!visit_terms(f, l, 2 * arity, visitor, depth + 1))
+    return false;
+
+  visitor.on_map_end();
+
+  return true;
+}
+
+bool visit_unsupported(msg_seq_iter& f, const msg_seq_iter& l, int tag, term_visitor& visitor)
+{
+  const msg_seq_iter start = f;
+
+  if(!skip_term(f, l))
+    return false;
+
+  visitor.on_unsupported(tag, &*start, f - start);
+
+  return true;
+}
+
+bool visit_term(msg_seq_iter& f, const msg_seq_iter& l, term_visitor& visitor, size_t depth)
+{
+  if((f == l) || (depth > max_depth))
+    return false;
+
+  const int tag = static_cast<boost::uint8_t>(*f);
+
+  switch(tag) {
+  case type_tag::small_integer:
+  case type_tag::integer:
+    return visit_int(f, l, visitor);
+  case type_tag::float_ext:
+    return visit_float(f, l, visitor);
+  case visited_tag::new_float_ext:
+    return visit_new_float(f, l, visitor);
+  case type_tag::atom_ext:
+  case visited_tag::atom_utf8_ext:
+    return visit_atom(f, l, 2, visitor);
+  case visited_tag::small_atom_ext:
+  case visited_tag::small_atom_utf8_ext:
+    return visit_atom(f, l, 1, visitor);
+  case type_tag::string_ext:
+    return visit_string(f, l, visitor);
+  case type_tag::binary_ext:
+  case type_tag::bit_binary_ext:
+    return visit_binary(f, l, visitor);
+  case type_tag::pid:
+    return visit_pid(f, l, visitor);
+  case type_tag::new_reference_ext:
+    return visit_reference(f, l, visitor);
+  case type_tag::small_tuple:
+    return visit_tuple(f, l, 1, visitor, depth);
+  case visited_tag::large_tuple_ext:
+    return visit_tuple(f, l, 4, visitor, depth);
+  case type_tag::list:
+    return visit_list(f, l, visitor, depth);
+  case type_tag::nil_ext:
+    return visit_nil(f, l, visitor);
+  case type_tag::map_ext:
+    return visit_map(f, l, visitor, depth);
+  default:
+    return visit_unsupported(f, l, tag, visitor);
+  }
+}
+
+// Visiting is implemented as a match, which gives us the (framed) bytes of any matchable.
+class visiting : public erl::object
+{
+public:
+  explicit visiting(term_visitor& a_visitor)
+    : visitor(a_visitor) {}
+
+  virtual void serialize(msg_seq_out_iter& out) const {} // used for visiting only
+
+  virtual bool match(msg_seq_iter& f, const msg_seq_iter& l) const
+  {
+    return visit_term(f, l, visitor, 0);
+  }
+
+private:
+  term_visitor& visitor;
+};
+
+}
+
+namespace tinch_pp {
+
+bool visit(const matchable& msg, term_visitor& visitor)
+{
+  return msg.match(visiting(visitor));
+}
+
+}
@@ -72,6 +72,22 @@ binary_value_type::binary_value_type(const value_type& binary_data,
    value[value.size() - 1] &= ~((1 << padding_bits) - 1);
 }
 
+binary_view::binary_view()
+  : first(0),
+    length(0),
+    padding(0) {}
+
+binary_view::binary_view(const frame_ptr& a_frame, const char* data, size_t size, int padding_bits)
+  : frame(a_frame),
+    first(data),
+    length(size),
+    padding(padding_bits) {}
+
+binary_value_type::value_type binary_view::to_vector() const
+{
+  return binary_value_type::value_type(begin(), end());
+}
+
 bool operator==(const binary_value_type& left, const binary_value_type& right)
 {
   return (left.padding_bits == right.padding_bits) &&
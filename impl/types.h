@@ -25,6 +25,7 @@
 #include <boost/fusion/adapted/struct/adapt_struct.hpp>
 #include <boost/fusion/include/adapt_struct.hpp>
 #include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
 #include <vector>
 #include <string>
 
@@ -35,6 +36,10 @@ typedef std::back_insert_iterator<msg_seq> msg_seq_out_iter;
 typedef msg_seq::iterator msg_seq_iter;
 typedef msg_seq::const_iterator msg_seq_citer;
 
+// Received messages are kept in the frame (buffer) they arrived in.
+// A frame is shared by all matchables and views referring to it.
+typedef boost::shared_ptr<msg_seq> frame_ptr;
+
 // TODO: boost types!
 typedef int creation_number_type;
 typedef int port_number_type;
@@ -83,6 +88,44 @@ struct binary_value_type
 
 bool operator==(const binary_value_type& left, const binary_value_type& right);
 
+/// A read-only view of a received binary. Instead of copying the binary out of the 
+/// received message, the view refers to the message, which is kept alive for as 
+/// long as any view refers to it. Thus, large binaries are never copied after 
+/// being read from the socket (unless explicitly requested through to_vector()).
+class binary_view
+{
+public:
+  typedef const char* const_iterator;
+
+  /// Specifies an empty view, typically used to assign to in a pattern match.
+  binary_view();
+
+  /// Refers to the given number of bytes, starting at data, in the given frame.
+  binary_view(const frame_ptr& frame, const char* data, size_t size, int padding_bits);
+
+  const char* data() const { return first; }
+
+  size_t size() const { return length; }
+
+  bool empty() const { return 0 == length; }
+
+  /// The padding of a bit-string, as in binary_value_type (zero for normal binaries).
+  int padding_bits() const { return padding; }
+
+  const_iterator begin() const { return first; }
+
+  const_iterator end() const { return first + length; }
+
+  /// Copies the binary into a vector of its own, for clients that need ownership.
+  binary_value_type::value_type to_vector() const;
+
+private:
+  frame_ptr frame;
+  const char* first;
+  size_t length;
+  int padding;
+};
+
 struct serializable_bit_seq
 {
   // used to represent bit_binary_ext
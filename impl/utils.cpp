@@ -22,6 +22,9 @@
 #include "utils.h"
 #include "md5.h"
 #include <boost/lexical_cast.hpp>
+#include <boost/bind.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/spirit/include/qi_binary.hpp>
 #include <boost/regex.hpp>
 #include <cassert>
@@ -105,6 +108,76 @@ tcp::socket& connect_socket(asio::io_service& io_service,
   return socket;
 }
 
+namespace {
+
+// Tries the resolved endpoints in turn, just like connect_socket does.
+class async_connect_attempt : public boost::enable_shared_from_this<async_connect_attempt>
+{
+public:
+  async_connect_attempt(asio::io_service& io_service, tcp::socket& a_socket, const connect_handler& a_handler)
+    : resolver(io_service),
+      socket(a_socket),
+      handler(a_handler)
+  {
+  }
+
+  void start(const std::string& host, int port)
+  {
+    tcp::resolver::query query(host, boost::lexical_cast<std::string>(port));
+
+    resolver.async_resolve(query, boost::bind(&async_connect_attempt::resolved, shared_from_this(), 
+                                              asio::placeholders::error, asio::placeholders::iterator));
+  }
+
+private:
+  void resolved(const boost::system::error_code& error, tcp::resolver::iterator endpoint_iterator)
+  {
+    if(error)
+      handler(error);
+    else
+      try_connect(boost::asio::error::host_not_found, endpoint_iterator);
+  }
+
+  void try_connect(const boost::system::error_code& previous_error, tcp::resolver::iterator endpoint_iterator)
+  {
+    if(endpoint_iterator == tcp::resolver::iterator()) {
+      handler(previous_error);
+      return;
+    }
+
+    const tcp::endpoint endpoint = *endpoint_iterator++;
+
+    socket.close();
+    socket.async_connect(endpoint, boost::bind(&async_connect_attempt::connected, shared_from_this(), 
+                                               asio::placeholders::error, endpoint_iterator));
+  }
+
+  void connected(const boost::system::error_code& error, tcp::resolver::iterator next_endpoint)
+  {
+    if(error)
+      try_connect(error, next_endpoint);
+    else
+      handler(error);
+  }
+
+  tcp::resolver resolver;
+  tcp::socket& socket;
+  const connect_handler handler;
+};
+
+}
+
+void async_connect_socket(asio::io_service& io_service, 
+                          tcp::socket& socket, 
+                          const std::string& host,
+                          int port,
+                          const connect_handler& handler)
+{
+  const boost::shared_ptr<async_connect_attempt> attempt(new async_connect_attempt(io_service, socket, handler));
+
+  attempt->start(host, port);
+}
+
 // A digest is a (16 bytes) MD5 hash of [the Challenge (as text) concatenated
 // with the cookie (as text).
 msg_seq calculate_digest(boost::uint32_t challenge,
@@ -151,7 +224,9 @@ optional<msg_seq> msg_lexer::next_message()
   optional<msg_seq> m;
 
   if(!msgs.empty()) {
-    m = msgs.front();
+    // Messages may be large => swap instead of copying.
+    m = msg_seq();
+    m->swap(msgs.front());
     msgs.pop_front();
   }
 
@@ -165,8 +240,8 @@ void msg_lexer::handle_new_condition()
     const size_t left = incomplete.size();
 
     if(left == *msg_and_header_size) {
-      msgs.push_back(incomplete);
-      incomplete.clear();
+      msgs.push_back(msg_seq());
+      msgs.back().swap(incomplete);
     } else if(left > *msg_and_header_size) {
       // concatenated messages
       extract_msg(*msg_and_header_size);
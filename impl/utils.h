@@ -28,6 +28,7 @@
 #include <boost/spirit/include/qi_parse.hpp>
 #include <boost/spirit/include/karma_generate.hpp>
 #include <boost/optional.hpp>
+#include <boost/function.hpp>
 #include <string>
 #include <iterator>
 #include <deque>
@@ -49,6 +50,16 @@ boost::asio::ip::tcp::socket& connect_socket(boost::asio::io_service& io_service
 					     const std::string& host,
 					     int port);
 
+typedef boost::function<void (const boost::system::error_code&)> connect_handler;
+
+// The asynchronous version of connect_socket above. The handler is invoked in the I/O context.
+// The caller keeps the socket alive until then.
+void async_connect_socket(boost::asio::io_service& io_service, 
+                          boost::asio::ip::tcp::socket& socket, 
+                          const std::string& host,
+                          int port,
+                          const connect_handler& handler);
+
 template <typename S, typename P, typename T>
 void parse(S& stream, P& p, T& attr)
 {
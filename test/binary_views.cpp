@@ -0,0 +1,162 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "tinch_pp/node.h"
+#include "tinch_pp/mailbox.h"
+#include "tinch_pp/erlang_types.h"
+#include "test_support.h"
+#include <algorithm>
+
+using namespace tinch_pp;
+using namespace tinch_pp::erl;
+using namespace tinch_pp::test;
+
+// USAGE:
+// ======
+// Start this program. The program sends large binaries between two mailboxes 
+// on the same node and binds the received binaries to views, which refer to 
+// the received messages instead of copying the binaries.
+
+namespace {
+
+void match_binary_view(mailbox_ptr sender, mailbox_ptr receiver);
+
+void view_outlives_message(mailbox_ptr sender, mailbox_ptr receiver);
+
+void match_bit_string_view(mailbox_ptr sender, mailbox_ptr receiver);
+
+void views_through_captures(mailbox_ptr sender, mailbox_ptr receiver);
+
+}
+
+int main()
+{
+  node_ptr my_node = node::create("binary_view_test@127.0.0.1", "qwerty");
+
+  mailbox_ptr sender = my_node->create_mailbox("sender");
+  mailbox_ptr receiver = my_node->create_mailbox("receiver");
+
+  match_binary_view(sender, receiver);
+
+  view_outlives_message(sender, receiver);
+
+  match_bit_string_view(sender, receiver);
+
+  views_through_captures(sender, receiver);
+}
+
+namespace {
+
+binary_value_type::value_type make_blob(size_t size)
+{
+  binary_value_type::value_type blob(size);
+
+  for(size_t i = 0; i < size; ++i)
+    blob[i] = static_cast<char>(i % 251);
+
+  return blob;
+}
+
+void match_binary_view(mailbox_ptr sender, mailbox_ptr receiver)
+{
+  const binary_value_type::value_type blob = make_blob(4 * 1024 * 1024);
+
+  sender->send("receiver", make_e_tuple(atom("image"), binary(binary_value_type(blob))));
+
+  const matchable_ptr msg = receiver->receive();
+
+  binary_view image;
+
+  check(msg->match(make_e_tuple(atom("image"), binary(&image))), "{image, Binary} as view");
+  check((image.size() == blob.size()) && std::equal(image.begin(), image.end(), blob.begin()), "view content");
+  check(image.to_vector() == blob, "view to_vector()");
+}
+
+void view_outlives_message(mailbox_ptr sender, mailbox_ptr receiver)
+{
+  const binary_value_type::value_type blob = make_blob(1024);
+
+  sender->send("receiver", make_e_tuple(atom("blob"), binary(binary_value_type(blob))));
+
+  binary_view view;
+
+  {
+    const matchable_ptr msg = receiver->receive();
+
+    check(msg->match(make_e_tuple(atom("blob"), binary(&view))), "{blob, Binary} as view");
+  }
+
+  // The matchable is gone, but the view still refers to the received message.
+  check(view.to_vector() == blob, "view after the message is released");
+}
+
+void match_bit_string_view(mailbox_ptr sender, mailbox_ptr receiver)
+{
+  const binary_value_type::value_type bits = make_blob(3);
+  const int padding_bits = 4;
+  const binary_value_type bit_string(bits, padding_bits);
+
+  sender->send("receiver", binary(bit_string));
+
+  const matchable_ptr msg = receiver->receive();
+
+  binary_view view;
+
+  check(msg->match(binary(&view)), "bit-string as view");
+  check((view.padding_bits() == padding_bits) && (view.to_vector() == bit_string.value), "bit-string view content");
+}
+
+// Parts captured by any() and values found in a map_view refer to the received 
+// message; drilling into them mustn't copy the message.
+void views_through_captures(mailbox_ptr sender, mailbox_ptr receiver)
+{
+  const binary_value_type::value_type blob = make_blob(64 * 1024);
+
+  e_map::value_type associations;
+  associations.push_back(std::make_pair(make_atom("payload"), object_ptr(new binary(binary_value_type(blob)))));
+
+  sender->send("receiver", make_e_tuple(atom("reply"), make_e_tuple(atom("nested"), e_map(associations))));
+
+  const matchable_ptr msg = receiver->receive();
+
+  map_view direct_map;
+  binary_view direct;
+  check(msg->match(make_e_tuple(atom("reply"), make_e_tuple(atom("nested"), e_map(&direct_map)))), "{reply, {nested, Map}}");
+  check(direct_map.match(atom("payload"), binary(&direct)), "binary in the map");
+
+  matchable_ptr reply_part;
+  check(msg->match(make_e_tuple(atom("reply"), any(&reply_part))), "{reply, Part} captured");
+
+  matchable_ptr nested_part;
+  check(reply_part->match(make_e_tuple(atom("nested"), any(&nested_part))), "{nested, Part} captured within the capture");
+
+  map_view nested_map;
+  check(nested_part->match(e_map(&nested_map)), "map within the captures");
+
+  const matchable_ptr payload = nested_map.find(atom("payload"));
+  binary_view captured;
+  check(payload && payload->match(binary(&captured)), "binary found through the captures");
+
+  check(captured.to_vector() == blob, "captured view content");
+  check(captured.data() == direct.data(), "captures share the received message");
+}
+
+}
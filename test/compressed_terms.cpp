@@ -0,0 +1,95 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "tinch_pp/node.h"
+#include "tinch_pp/mailbox.h"
+#include "tinch_pp/erlang_types.h"
+#include <iostream>
+
+using namespace tinch_pp;
+using namespace tinch_pp::erl;
+
+// USAGE:
+// ======
+// 1. Start an Erlang node with the cookie abcdef.
+// 2. Start the Erlang program reflect_msg:
+//          (testnode@127.0.0.1)4> reflect_msg:start_link().
+// 3. Start this program. The program enables compression and sends messages 
+// to reflect_msg, which echoes the messages back. The large messages are 
+// compressed on their way to Erlang, the small ones are sent as they are.
+
+namespace {
+
+void echo_large_string(mailbox_ptr mbox);
+
+void echo_small_string(mailbox_ptr mbox);
+
+}
+
+int main()
+{
+  node_ptr my_node = node::create("my_test_node@127.0.0.1", "abcdef");
+
+  const size_t compression_threshold = 128;
+  my_node->set_compression_threshold(compression_threshold);
+
+  mailbox_ptr mbox = my_node->create_mailbox();
+
+  echo_large_string(mbox);
+
+  echo_small_string(mbox);
+
+  mbox->close();
+}
+
+namespace {
+
+const std::string remote_node_name("testnode@127.0.0.1");
+const std::string to_name("reflect_msg");
+
+// All messages have the following format: {echo, self(), Msg}
+
+void echo_string(mailbox_ptr mbox, const std::string& msg)
+{
+  mbox->send(to_name, remote_node_name, make_e_tuple(atom("echo"), pid(mbox->self()), 
+                                                     make_e_tuple(atom("compression"), e_string(msg))));
+
+  const matchable_ptr reply = mbox->receive();
+
+  std::string matched_val;
+
+  if(reply->match(make_e_tuple(atom("compression"), e_string(&matched_val))) && (matched_val == msg))
+    std::cout << "Matched string {compression, _} of size " << matched_val.size() << std::endl;
+  else
+    std::cerr << "No match - unexpected message!" << std::endl;
+}
+
+void echo_large_string(mailbox_ptr mbox)
+{
+  echo_string(mbox, std::string(10000, 'x'));
+}
+
+void echo_small_string(mailbox_ptr mbox)
+{
+  echo_string(mbox, "my string");
+}
+
+}
@@ -0,0 +1,131 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "tinch_pp/node.h"
+#include "tinch_pp/mailbox.h"
+#include "tinch_pp/erlang_types.h"
+#include "tinch_pp/exceptions.h"
+#include "test_support.h"
+#include <boost/asio.hpp>
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+
+using namespace tinch_pp;
+using namespace tinch_pp::erl;
+using namespace tinch_pp::test;
+
+// This program tests the handshakes of incoming connections.
+//
+// USAGE:
+// ======
+// Start this program. No EPMD needed: the nodes register at a private name server.
+// It connects a stalling peer (a socket that never completes its handshake) and 
+// many nodes at once to a hub node. The nodes must get through while the stalling 
+// peer waits for its handshake timeout. Finally, two nodes connect to each other 
+// simultaneously.
+
+namespace {
+
+const std::string hub_node_name("handshake_hub@127.0.0.1");
+const port_number_type hub_port = 9640;
+
+void send_from_new_node(const private_cluster& cluster, int id)
+{
+  node_ptr my_node = cluster.create_node("handshake_spoke" + boost::lexical_cast<std::string>(id) + "@127.0.0.1");
+  mailbox_ptr mbox = my_node->create_mailbox();
+
+  mbox->send("hub", hub_node_name, make_e_tuple(atom("hello"), pid(mbox->self())));
+
+  // Keep the node alive until the hub has received the message.
+  mbox->receive(10);
+}
+
+void many_nodes_behind_a_stalling_peer(const private_cluster& cluster, mailbox_ptr hub)
+{
+  boost::asio::io_service io_service;
+  boost::asio::ip::tcp::socket stalling(io_service);
+  stalling.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), hub_port));
+
+  const int number_of_nodes = 20;
+  boost::thread_group spokes;
+
+  for(int i = 0; i < number_of_nodes; ++i)
+    spokes.create_thread(boost::bind(&send_from_new_node, boost::cref(cluster), i));
+
+  // Well below the handshake timeout.
+  const time_type_sec tmo = 5;
+  int received = 0;
+
+  try {
+    for(; received < number_of_nodes; ++received) {
+      e_pid spoke;
+
+      if(hub->receive(tmo)->match(make_e_tuple(atom("hello"), pid(&spoke))))
+        hub->send(spoke, atom("bye"));
+    }
+  } catch(const mailbox_receive_tmo&) {
+  }
+
+  check(received == number_of_nodes, "concurrent handshakes behind a stalling peer");
+
+  spokes.join_all();
+}
+
+void simultaneous_connect(const private_cluster& cluster)
+{
+  node_ptr first = cluster.start_node("simultaneous_a@127.0.0.1", 9641);
+  mailbox_ptr first_mbox = first->create_mailbox("simultaneous");
+
+  node_ptr second = cluster.start_node("simultaneous_b@127.0.0.1", 9642);
+  mailbox_ptr second_mbox = second->create_mailbox("simultaneous");
+
+  for(int i = 0; i < 10; ++i) {
+    first_mbox->send("simultaneous", "simultaneous_b@127.0.0.1", int_(i));
+    second_mbox->send("simultaneous", "simultaneous_a@127.0.0.1", int_(i));
+  }
+
+  bool in_order = true;
+
+  for(int i = 0; i < 10; ++i) {
+    int at_first = -1;
+    int at_second = -1;
+
+    in_order = first_mbox->receive(10)->match(int_(&at_first)) && (at_first == i) && in_order;
+    in_order = second_mbox->receive(10)->match(int_(&at_second)) && (at_second == i) && in_order;
+  }
+
+  check(in_order, "a simultaneous connect");
+}
+
+}
+
+int main()
+{
+  const private_cluster cluster;
+
+  node_ptr hub_node = cluster.start_node(hub_node_name, hub_port);
+  mailbox_ptr hub = hub_node->create_mailbox("hub");
+
+  many_nodes_behind_a_stalling_peer(cluster, hub);
+
+  simultaneous_connect(cluster);
+}
@@ -0,0 +1,152 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "tinch_pp/epmd_server.h"
+#include "tinch_pp/node.h"
+#include "tinch_pp/mailbox.h"
+#include "tinch_pp/erlang_types.h"
+#include "tinch_pp/exceptions.h"
+#include "test_support.h"
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+#include <algorithm>
+
+using namespace tinch_pp;
+using namespace tinch_pp::erl;
+using namespace tinch_pp::test;
+namespace asio = boost::asio;
+using boost::asio::ip::tcp;
+
+// USAGE:
+// ======
+// Start this program. No EPMD needed: the program starts a private name server 
+// and lets two nodes, registered there, talk to each other.
+
+namespace {
+
+bool is_registered(const private_cluster& cluster, const std::string& name, port_number_type port)
+{
+  const std::vector<epmd_server::registered_node_type> nodes = cluster.server().registered_nodes();
+
+  return std::find(nodes.begin(), nodes.end(), epmd_server::registered_node_type(name, port)) != nodes.end();
+}
+
+void registration(const private_cluster& cluster, node_ptr first, node_ptr second)
+{
+  check(is_registered(cluster, "embedded_a", 9650) && is_registered(cluster, "embedded_b", 9651), 
+        "registered nodes");
+
+  node_ptr duplicate = cluster.create_node("embedded_a@127.0.0.1");
+  bool refused = false;
+
+  try {
+    duplicate->publish_port(9652);
+  } catch(const tinch_pp_exception&) {
+    refused = true;
+  }
+
+  check(refused, "a refused duplicate");
+}
+
+void message_exchange(node_ptr first, node_ptr second)
+{
+  mailbox_ptr ping = first->create_mailbox();
+  mailbox_ptr pong = second->create_mailbox("pong");
+
+  ping->send("pong", "embedded_b@127.0.0.1", make_e_tuple(atom("ping"), pid(ping->self())));
+
+  e_pid sender;
+  check(pong->receive(5)->match(make_e_tuple(atom("ping"), pid(&sender))), "a message through the name server");
+
+  pong->send(sender, atom("pong"));
+  check(ping->receive(5)->match(atom("pong")), "a reply");
+
+  check(!first->ping_peer("embedded_nobody@127.0.0.1"), "an unknown node");
+}
+
+void names(const private_cluster& cluster)
+{
+  asio::io_service io_service;
+  tcp::socket one_shot(io_service);
+  one_shot.connect(tcp::endpoint(asio::ip::address::from_string("127.0.0.1"), cluster.epmd_port()));
+
+  const char names_req[] = {0, 1, 110};
+  asio::write(one_shot, asio::buffer(names_req));
+
+  std::string response;
+  char buffer[256];
+  boost::system::error_code error;
+
+  while(!error) {
+    const size_t read = one_shot.read_some(asio::buffer(buffer), error);
+    response.append(buffer, read);
+  }
+
+  const port_number_type epmd_port = (static_cast<unsigned char>(response[2]) << 8) | 
+                                      static_cast<unsigned char>(response[3]);
+
+  check((response.size() > 4) && (epmd_port == cluster.epmd_port()), "the port in NAMES_RESP");
+  check(response.substr(4) == "name embedded_a at port 9650\nname embedded_b at port 9651\n", "the names in NAMES_RESP");
+}
+
+void unregistration(const private_cluster& cluster, node_ptr& first)
+{
+  first.reset();
+
+  // The name server notices the closed connection asynchronously.
+  for(int i = 0; (i < 100) && is_registered(cluster, "embedded_a", 9650); ++i)
+    boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+
+  check(!is_registered(cluster, "embedded_a", 9650), "an unregistered node");
+}
+
+void port_in_use(const private_cluster& cluster)
+{
+  bool refused = false;
+
+  try {
+    epmd_server::create(cluster.epmd_port());
+  } catch(const tinch_pp_exception&) {
+    refused = true;
+  }
+
+  check(refused, "a port in use");
+}
+
+}
+
+int main()
+{
+  const private_cluster cluster;
+
+  node_ptr first = cluster.start_node("embedded_a@127.0.0.1", 9650);
+  node_ptr second = cluster.start_node("embedded_b@127.0.0.1", 9651);
+
+  registration(cluster, first, second);
+
+  message_exchange(first, second);
+
+  names(cluster);
+
+  unregistration(cluster, first);
+
+  port_in_use(cluster);
+}
@@ -0,0 +1,91 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "tinch_pp/erlang_types.h"
+#include "tinch_pp/type_makers.h"
+#include <boost/assign/list_of.hpp>
+#include <iostream>
+#include <stdexcept>
+#include <sstream>
+
+using namespace tinch_pp;
+using namespace tinch_pp::erl;
+using namespace boost::assign;
+
+// USAGE:
+// ======
+// Start this program. The program verifies that the encoded size reported by 
+// each type equals the number of bytes it actually serializes to (the send 
+// path reserves exactly that much before serializing).
+
+namespace {
+
+void check_size(const object& term, const std::string& testcase)
+{
+  msg_seq encoded;
+  msg_seq_out_iter out(encoded);
+
+  term.serialize(out);
+
+  if(term.encoded_size() != encoded.size()) {
+    std::ostringstream error;
+    error << testcase << ": encoded_size() = " << term.encoded_size() 
+          << ", serialized " << encoded.size() << " bytes";
+    throw std::runtime_error(error.str());
+  }
+
+  std::cout << "Size of " << testcase << " OK (" << encoded.size() << " bytes)" << std::endl;
+}
+
+}
+
+int main()
+{
+  const e_pid a_pid("encoded_size_test@127.0.0.1", 1, 2, 3);
+  const msg_seq ref_id(12, 'r');
+
+  check_size(int_(42), "small int");
+  check_size(int_(-1), "negative int");
+  check_size(int_(1234567), "large int");
+  check_size(float_(3.14), "float");
+  check_size(atom("hello"), "atom");
+  check_size(pid(a_pid), "pid");
+  check_size(ref(new_reference_type("encoded_size_test@127.0.0.1", 1, ref_id)), "ref");
+  check_size(binary(binary_value_type(binary_value_type::value_type(1000, 'b'))), "binary");
+  check_size(binary(binary_value_type(binary_value_type::value_type(3, 'b'), 4)), "bit-string");
+  check_size(e_string("a string"), "string");
+
+  const std::vector<int_> ints = list_of(int_(1))(int_(1000))(int_(2));
+  check_size(erl::list<int_>(ints), "int list");
+
+  const std::vector<atom> atoms = list_of(atom("a"))(atom("bc"));
+  check_size(erl::list<atom>(atoms), "atom list");
+
+  check_size(make_e_tuple(atom("tagged"), int_(256), make_e_tuple(e_string("nested"), pid(a_pid))), 
+             "nested tuple");
+
+  e_map::value_type associations;
+  associations.push_back(std::make_pair(make_atom("id"), make_int(4711)));
+  associations.push_back(std::make_pair(make_atom("name"), make_string("a name")));
+  check_size(e_map(associations), "map");
+
+  check_size(make_e_tuple(atom("reply"), e_map(associations)), "tuple with a map");
+}
@@ -0,0 +1,296 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "impl/epmd_port_cache.h"
+#include "tinch_pp/node.h"
+#include "test_support.h"
+#include <boost/asio.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/cstdint.hpp>
+#include <vector>
+
+using namespace tinch_pp;
+using namespace tinch_pp::test;
+namespace asio = boost::asio;
+using boost::asio::ip::tcp;
+
+// USAGE:
+// ======
+// Start this program. The program looks up ports through an epmd_port_cache, 
+// backed by a fake EPMD that counts the PORT_PLEASE2_REQs it gets. It also ensures 
+// that a node forgets a port it failed to connect to.
+
+namespace {
+
+const port_number_type known_port = 4711;
+
+// Knows a single node, "known". The reply is delayed, so that concurrent lookups overlap.
+class fake_epmd
+{
+public:
+  fake_epmd()
+    : acceptor(io_service, tcp::endpoint(asio::ip::address::from_string("127.0.0.1"), 0)),
+      queries(0),
+      stopped(false),
+      server(boost::bind(&fake_epmd::serve, this))
+  {
+  }
+
+  ~fake_epmd()
+  {
+    {
+      boost::lock_guard<boost::mutex> lock(queries_mutex);
+      stopped = true;
+    }
+
+    // Wake up the server, blocked in accept.
+    tcp::socket wake_up(io_service);
+    wake_up.connect(acceptor.local_endpoint());
+
+    server.join();
+  }
+
+  port_number_type port() const
+  {
+    return acceptor.local_endpoint().port();
+  }
+
+  int number_of_queries()
+  {
+    boost::lock_guard<boost::mutex> lock(queries_mutex);
+
+    return queries;
+  }
+
+private:
+  void serve()
+  {
+    for(;;) {
+      tcp::socket one_shot(io_service);
+      acceptor.accept(one_shot);
+
+      {
+        boost::lock_guard<boost::mutex> lock(queries_mutex);
+
+        if(stopped)
+          return;
+      }
+
+      unsigned char header[2];
+      asio::read(one_shot, asio::buffer(header));
+
+      std::vector<char> request((header[0] << 8) | header[1]);
+      asio::read(one_shot, asio::buffer(request));
+
+      {
+        boost::lock_guard<boost::mutex> lock(queries_mutex);
+        ++queries;
+      }
+
+      boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+
+      const std::string name(request.begin() + 1, request.end());
+
+      if(name == "known") {
+        // 119, result, port, node type, protocol, highest and lowest version, name and extra.
+        const unsigned char response[] = {119, 0, known_port >> 8, known_port & 0xFF, 72, 0, 0, 5, 0, 5, 
+                                          0, 5, 'k', 'n', 'o', 'w', 'n', 0, 0};
+        asio::write(one_shot, asio::buffer(response));
+      } else {
+        const unsigned char response[] = {119, 1};
+        asio::write(one_shot, asio::buffer(response));
+      }
+    }
+  }
+
+  asio::io_service io_service;
+  tcp::acceptor acceptor;
+
+  boost::mutex queries_mutex;
+  int queries;
+  bool stopped;
+
+  boost::thread server;
+};
+
+class lookup_result
+{
+public:
+  lookup_result()
+    : done(false)
+  {
+  }
+
+  void set(const boost::optional<port_number_type>& a_port, const std::string& a_failure)
+  {
+    {
+      boost::lock_guard<boost::mutex> lock(result_mutex);
+
+      done = true;
+      port = a_port;
+      failure = a_failure;
+    }
+    result_cond.notify_all();
+  }
+
+  boost::optional<port_number_type> wait()
+  {
+    boost::unique_lock<boost::mutex> lock(result_mutex);
+
+    while(!done)
+      result_cond.wait(lock);
+
+    return port;
+  }
+
+  std::string failure_reason() 
+  {
+    wait();
+
+    return failure;
+  }
+
+private:
+  boost::mutex result_mutex;
+  boost::condition_variable result_cond;
+  bool done;
+  boost::optional<port_number_type> port;
+  std::string failure;
+};
+
+boost::optional<port_number_type> lookup(epmd_port_cache& cache, const std::string& node)
+{
+  lookup_result result;
+
+  cache.async_lookup(node, boost::bind(&lookup_result::set, &result, ::_1, ::_2));
+
+  return result.wait();
+}
+
+void concurrent_lookups(epmd_port_cache& cache, fake_epmd& epmd)
+{
+  const size_t number_of_lookups = 50;
+  std::vector<boost::shared_ptr<lookup_result> > results;
+
+  for(size_t i = 0; i < number_of_lookups; ++i) {
+    results.push_back(boost::shared_ptr<lookup_result>(new lookup_result));
+    cache.async_lookup("known@127.0.0.1", boost::bind(&lookup_result::set, results.back(), ::_1, ::_2));
+  }
+
+  bool all_found = true;
+
+  for(size_t i = 0; i < number_of_lookups; ++i)
+    all_found = (results[i]->wait() == known_port) && all_found;
+
+  check(all_found, "concurrent lookups");
+  check(epmd.number_of_queries() == 1, "concurrent lookups sharing one request");
+
+  check(lookup(cache, "known@127.0.0.1") == known_port, "a cached lookup");
+  check(epmd.number_of_queries() == 1, "a cached lookup without request");
+}
+
+void failed_lookups(epmd_port_cache& cache, fake_epmd& epmd)
+{
+  check(!lookup(cache, "unknown@127.0.0.1"), "an unknown node");
+  check(!lookup(cache, "unknown@127.0.0.1"), "a cached unknown node");
+  check(epmd.number_of_queries() == 2, "a negatively cached lookup without request");
+}
+
+void forgotten_port(epmd_port_cache& cache, fake_epmd& epmd)
+{
+  cache.forget("known@127.0.0.1");
+
+  check(lookup(cache, "known@127.0.0.1") == known_port, "a forgotten port");
+  check(epmd.number_of_queries() == 3, "a forgotten port looked up again");
+}
+
+// Nothing listens at the known port => each connect fails, and the port is forgotten.
+void refused_port(fake_epmd& epmd)
+{
+  node_ptr own = node::create("forgetting@127.0.0.1", "abcdef", epmd.port());
+
+  const int queries_before = epmd.number_of_queries();
+
+  own->ping_peer("known@127.0.0.1");
+  own->ping_peer("known@127.0.0.1");
+
+  check(epmd.number_of_queries() == queries_before + 2, "a refused port looked up again");
+}
+
+void expired_port(asio::io_service& io_service, fake_epmd& epmd)
+{
+  epmd_port_cache short_lived(io_service, epmd.port(), 
+                              boost::posix_time::milliseconds(100), boost::posix_time::milliseconds(100));
+
+  const int queries_before = epmd.number_of_queries();
+
+  lookup(short_lived, "known@127.0.0.1");
+  boost::this_thread::sleep(boost::posix_time::milliseconds(200));
+  lookup(short_lived, "known@127.0.0.1");
+
+  check(epmd.number_of_queries() == queries_before + 2, "an expired port");
+}
+
+void unreachable_epmd(asio::io_service& io_service)
+{
+  // Nothing listens on this port.
+  tcp::acceptor closed(io_service, tcp::endpoint(asio::ip::address::from_string("127.0.0.1"), 0));
+  const port_number_type closed_port = closed.local_endpoint().port();
+  closed.close();
+
+  epmd_port_cache cache(io_service, closed_port, boost::posix_time::seconds(60), boost::posix_time::seconds(2));
+
+  lookup_result result;
+  cache.async_lookup("known@127.0.0.1", boost::bind(&lookup_result::set, &result, ::_1, ::_2));
+
+  check(!result.wait() && !result.failure_reason().empty(), "an unreachable EPMD");
+}
+
+}
+
+int main()
+{
+  fake_epmd epmd;
+
+  asio::io_service io_service;
+  asio::io_service::work keep_running(io_service);
+  boost::thread async_io(boost::bind(&asio::io_service::run, &io_service));
+
+  {
+    epmd_port_cache cache(io_service, epmd.port(), boost::posix_time::seconds(60), boost::posix_time::seconds(60));
+
+    concurrent_lookups(cache, epmd);
+
+    failed_lookups(cache, epmd);
+
+    forgotten_port(cache, epmd);
+  }
+
+  refused_port(epmd);
+
+  expired_port(io_service, epmd);
+
+  unreachable_epmd(io_service);
+
+  io_service.stop();
+  async_io.join();
+}
@@ -0,0 +1,188 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "tinch_pp/node.h"
+#include "tinch_pp/mailbox.h"
+#include "tinch_pp/erlang_types.h"
+#include "impl/term_index.h"
+#include "impl/ext_term_grammar.h"
+#include "test_support.h"
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <vector>
+
+using namespace tinch_pp;
+using namespace tinch_pp::erl;
+using namespace tinch_pp::test;
+
+// USAGE:
+// ======
+// Start this program. The program sends a large, nested message between two 
+// mailboxes on the same node and matches it against several patterns in turn, 
+// the way a receive with multiple clauses does. The matches after the first 
+// one skip the subterms of the message through its index.
+
+namespace {
+
+void match_several_clauses(mailbox_ptr sender, mailbox_ptr receiver);
+
+void match_captured_subterms(mailbox_ptr sender, mailbox_ptr receiver);
+
+void match_concurrently(mailbox_ptr sender, mailbox_ptr receiver);
+
+void index_built_once();
+
+}
+
+int main()
+{
+  node_ptr my_node = node::create("index_test@127.0.0.1", "qwerty");
+
+  mailbox_ptr sender = my_node->create_mailbox("sender");
+  mailbox_ptr receiver = my_node->create_mailbox("receiver");
+
+  match_several_clauses(sender, receiver);
+
+  match_captured_subterms(sender, receiver);
+
+  match_concurrently(sender, receiver);
+
+  index_built_once();
+}
+
+namespace {
+
+std::vector<int_> make_numbers(size_t size)
+{
+  std::vector<int_> numbers;
+
+  for(size_t i = 0; i < size; ++i)
+    numbers.push_back(int_(static_cast<boost::int32_t>(i * 1000)));
+
+  return numbers;
+}
+
+void send_reply(mailbox_ptr sender)
+{
+  sender->send("receiver", make_e_tuple(atom("reply"), 
+                                        make_e_tuple(atom("numbers"), make_list(make_numbers(10000))),
+                                        e_string("the end")));
+}
+
+void match_several_clauses(mailbox_ptr sender, mailbox_ptr receiver)
+{
+  send_reply(sender);
+
+  const matchable_ptr msg = receiver->receive();
+
+  std::string text;
+
+  check(!msg->match(make_e_tuple(atom("request"), any(), any())), "{request, _, _} doesn't match");
+  check(!msg->match(make_e_tuple(atom("reply"), any())), "{reply, _} doesn't match");
+  check(!msg->match(make_e_tuple(atom("reply"), any(), e_string("another end"))), "{reply, _, \"another end\"} doesn't match");
+  check(!msg->match(make_e_tuple(atom("reply"), any(), atom("the_end"))), "{reply, _, the_end} doesn't match");
+  check(msg->match(make_e_tuple(atom("reply"), any(), e_string(&text))) && (text == "the end"), "{reply, _, Text}");
+}
+
+void match_captured_subterms(mailbox_ptr sender, mailbox_ptr receiver)
+{
+  send_reply(sender);
+
+  const matchable_ptr msg = receiver->receive();
+
+  matchable_ptr result;
+  matchable_ptr numbers;
+  std::vector<int_> received;
+
+  check(msg->match(make_e_tuple(atom("reply"), any(&result), any())), "{reply, Result, _}");
+  check(result->match(make_e_tuple(atom("numbers"), any(&numbers))), "{numbers, Numbers}");
+  check(numbers->match(make_list(&received)) && (received.size() == 10000), "the captured list");
+  check((received.front().value() == 0) && (received.back().value() == 9999 * 1000), "the captured elements");
+
+  // The same message again, now through the index built above.
+  matchable_ptr again;
+  std::vector<int_> received_again;
+
+  check(msg->match(make_e_tuple(atom("reply"), any(&again), e_string("the end"))), "{reply, Result, \"the end\"}");
+  check(again->match(make_e_tuple(atom("numbers"), make_list(&received_again))) && (received_again.size() == 10000) && (received_again.back().value() == 9999 * 1000), "the captured list again");
+}
+
+void match_clauses(matchable_ptr msg, size_t iterations, bool& matched)
+{
+  for(size_t i = 0; matched && (i < iterations); ++i) {
+    std::string text;
+
+    matched = !msg->match(make_e_tuple(atom("reply"), any(), atom("the_end"))) &&
+              msg->match(make_e_tuple(atom("reply"), any(), e_string(&text))) && (text == "the end");
+  }
+}
+
+// The first of the threads to skip a subterm builds the index; the others wait for it.
+void match_concurrently(mailbox_ptr sender, mailbox_ptr receiver)
+{
+  send_reply(sender);
+
+  const matchable_ptr msg = receiver->receive();
+
+  const size_t nr_of_threads = 4;
+  bool matched[nr_of_threads];
+  boost::thread_group threads;
+
+  for(size_t i = 0; i < nr_of_threads; ++i) {
+    matched[i] = true;
+    threads.create_thread(boost::bind(match_clauses, msg, 100, boost::ref(matched[i])));
+  }
+
+  threads.join_all();
+
+  check(std::count(matched, matched + nr_of_threads, true) == nr_of_threads, "the same message matched by several threads");
+}
+
+msg_seq encode(const object& term)
+{
+  msg_seq encoded;
+  msg_seq_out_iter out(encoded);
+
+  term.serialize(out);
+
+  return encoded;
+}
+
+// Once built, the index is used as it is. We verify that by destroying the 
+// indexed term: a parse would fail, but the term is still found in the index.
+void index_built_once()
+{
+  msg_seq frame = encode(make_e_tuple(atom("reply"), make_e_tuple(atom("numbers"), make_list(make_numbers(100))), 
+                                      e_string("the end")));
+  const size_t list_offset = 2 + encode(atom("reply")).size() + 2 + encode(atom("numbers")).size();
+
+  const term_index index(0);
+  const term_index::node* list = index.find(frame, list_offset);
+
+  check((0 != list) && (type_tag::list == list->tag) && (list->offset == list_offset), "a subterm in the index");
+
+  frame[list_offset] = 0;
+
+  check(index.find(frame, list_offset) == list, "the index reused as it is");
+}
+
+}
@@ -0,0 +1,142 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "tinch_pp/node.h"
+#include "tinch_pp/mailbox.h"
+#include "tinch_pp/erlang_types.h"
+#include "impl/matchable_seq.h"
+#include "test_support.h"
+#include <boost/assign/list_of.hpp>
+#include <vector>
+#include <list>
+
+using namespace tinch_pp;
+using namespace tinch_pp::erl;
+using namespace tinch_pp::test;
+using namespace boost::assign;
+
+// USAGE:
+// ======
+// Start this program. The program sends strings and lists between two 
+// mailboxes on the same node and matches them in different ways.
+
+namespace {
+
+void match_long_string(mailbox_ptr sender, mailbox_ptr receiver);
+
+void match_string_as_int_list(mailbox_ptr sender, mailbox_ptr receiver);
+
+void match_int_list(mailbox_ptr sender, mailbox_ptr receiver);
+
+void reject_corrupt_list_length();
+
+}
+
+int main()
+{
+  node_ptr my_node = node::create("list_test@127.0.0.1", "qwerty");
+
+  mailbox_ptr sender = my_node->create_mailbox("sender");
+  mailbox_ptr receiver = my_node->create_mailbox("receiver");
+
+  match_long_string(sender, receiver);
+
+  match_string_as_int_list(sender, receiver);
+
+  match_int_list(sender, receiver);
+
+  reject_corrupt_list_length();
+}
+
+namespace {
+
+std::string make_text(size_t size)
+{
+  std::string text;
+
+  for(size_t i = 0; i < size; ++i)
+    text.push_back(static_cast<char>('a' + i % 26));
+
+  return text;
+}
+
+void match_long_string(mailbox_ptr sender, mailbox_ptr receiver)
+{
+  const std::string text = make_text(1024);
+  std::string almost_text = text;
+  almost_text[almost_text.size() - 1] = '!';
+
+  sender->send("receiver", make_e_tuple(atom("text"), e_string(text)));
+
+  const matchable_ptr msg = receiver->receive();
+
+  std::string matched_text = "overwritten";
+
+  check(!msg->match(make_e_tuple(atom("text"), e_string(almost_text))), "no match for a different string");
+  check(!msg->match(make_e_tuple(atom("text"), e_string(text.substr(1)))), "no match for a shorter string");
+  check(msg->match(make_e_tuple(atom("text"), e_string(text))), "{text, \"abc...\"}");
+  check(msg->match(make_e_tuple(atom("text"), e_string(&matched_text))) && (matched_text == text), "{text, Text}");
+  check(msg->match(make_e_tuple(atom("text"), e_string(erl::any()))), "{text, _}");
+}
+
+void match_string_as_int_list(mailbox_ptr sender, mailbox_ptr receiver)
+{
+  // A string is a list of small integers => it can be assigned to one.
+  sender->send("receiver", e_string("abc"));
+
+  const matchable_ptr msg = receiver->receive();
+
+  std::vector<int_> as_vector;
+  std::list<int_> as_list;
+
+  check(msg->match(make_list(&as_vector)) && (as_vector.size() == 3) && (as_vector[2].value() == 'c'), "string as std::vector<int_>");
+  check(msg->match(make_list(&as_list)) && (as_list.size() == 3) && (as_list.front().value() == 'a'), "string as std::list<int_>");
+}
+
+void match_int_list(mailbox_ptr sender, mailbox_ptr receiver)
+{
+  const std::vector<int_> numbers = list_of(int_(1))(int_(1000))(int_(-42));
+
+  sender->send("receiver", make_e_tuple(atom("numbers"), make_list(numbers)));
+
+  const matchable_ptr msg = receiver->receive();
+
+  std::vector<int_> matched;
+  const std::list<int_> numbers_as_list(numbers.begin(), numbers.end());
+
+  check(msg->match(make_e_tuple(atom("numbers"), make_list(numbers))), "{numbers, [1, 1000, -42]}");
+  check(msg->match(make_e_tuple(atom("numbers"), make_list(numbers_as_list))), "{numbers, [1, 1000, -42]} (std::list)");
+  check(msg->match(make_e_tuple(atom("numbers"), make_list(&matched))) && 
+        (matched.size() == numbers.size()) && (matched[1].value() == 1000), "{numbers, Numbers}");
+}
+
+// The list claims 4294967295 elements, but the message holds a single one.
+void reject_corrupt_list_length()
+{
+  const unsigned char encoded[] = {108, 0xff, 0xff, 0xff, 0xff, 97, 1, 106};
+  const matchable_seq msg(msg_seq(encoded, encoded + sizeof encoded));
+
+  std::vector<int_> matched;
+
+  check(!msg.match(make_list(&matched)) && (matched.capacity() <= 3), "a list longer than the message");
+}
+
+}
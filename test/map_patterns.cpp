@@ -0,0 +1,206 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "tinch_pp/node.h"
+#include "tinch_pp/mailbox.h"
+#include "tinch_pp/erlang_types.h"
+#include "test_support.h"
+#include <boost/assign/list_of.hpp>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <algorithm>
+
+using namespace tinch_pp;
+using namespace tinch_pp::erl;
+using namespace tinch_pp::test;
+using namespace boost::assign;
+
+// USAGE:
+// ======
+// 1. Simply run the program - no need to start Erlang (EPMD) for this test!
+//
+// DESCRIPTION:
+// ============
+// This testcase sends maps between two mailboxes on the same tinch++ node and 
+// matches them with partial map patterns and through a map_view.
+
+namespace {
+
+e_map::value_type make_person();
+
+void match_partial_pattern(mailbox_ptr sender, mailbox_ptr receiver);
+
+void match_missing_key(mailbox_ptr sender, mailbox_ptr receiver);
+
+void match_through_view(mailbox_ptr sender, mailbox_ptr receiver);
+
+void match_any_map(mailbox_ptr sender, mailbox_ptr receiver);
+
+void view_from_threads(mailbox_ptr sender, mailbox_ptr receiver);
+
+void view_corrupt_map();
+
+}
+
+int main()
+{
+  node_ptr my_node = node::create("map_test@127.0.0.1", "qwerty");
+
+  mailbox_ptr sender = my_node->create_mailbox("sender");
+  mailbox_ptr receiver = my_node->create_mailbox("receiver");
+
+  match_partial_pattern(sender, receiver);
+
+  match_missing_key(sender, receiver);
+
+  match_through_view(sender, receiver);
+
+  match_any_map(sender, receiver);
+
+  view_from_threads(sender, receiver);
+
+  view_corrupt_map();
+}
+
+namespace {
+
+e_map::association_type association(object_ptr key, object_ptr value)
+{
+  return std::make_pair(key, value);
+}
+
+// #{id => 42, name => "Joe", languages => [erlang, cpp]}
+e_map::value_type make_person()
+{
+  const std::list<object_ptr> languages = list_of(make_atom("erlang"))(make_atom("cpp"));
+  const object_ptr languages_list(new list<object_ptr>(languages));
+
+  const e_map::value_type person = list_of(association(make_atom("id"), make_int(42)))
+                                          (association(make_atom("name"), make_string("Joe")))
+                                          (association(make_atom("languages"), languages_list));
+  return person;
+}
+
+void match_partial_pattern(mailbox_ptr sender, mailbox_ptr receiver)
+{
+  sender->send("receiver", make_e_tuple(atom("person"), e_map(make_person())));
+
+  const matchable_ptr msg = receiver->receive();
+
+  boost::int32_t id = 0;
+  const e_map::value_type wanted = list_of(association(make_atom("id"), object_ptr(new int_(&id))));
+
+  check(msg->match(make_e_tuple(atom("person"), e_map(wanted))) && (42 == id), "{person, #{id := Id}}");
+}
+
+void match_missing_key(mailbox_ptr sender, mailbox_ptr receiver)
+{
+  sender->send("receiver", e_map(make_person()));
+
+  const matchable_ptr msg = receiver->receive();
+
+  const e_map::value_type wanted = list_of(association(make_atom("id"), make_int(42)))
+                                          (association(make_atom("age"), object_ptr(new erl::any())));
+
+  check(!msg->match(e_map(wanted)), "no match for #{id := 42, age := _}");
+}
+
+void match_through_view(mailbox_ptr sender, mailbox_ptr receiver)
+{
+  sender->send("receiver", e_map(make_person()));
+
+  const matchable_ptr msg = receiver->receive();
+
+  map_view person;
+  std::string name;
+
+  check(msg->match(e_map(&person)) && (3 == person.size()), "map_view of size 3");
+
+  check(person.match(atom("name"), e_string(&name)) && ("Joe" == name), "map_view name := \"Joe\"");
+
+  check(!person.has_key(atom("age")), "map_view without age");
+
+  const matchable_ptr id = person.find(atom("id"));
+
+  check(id && id->match(int_(42)), "map_view id := 42");
+}
+
+void match_any_map(mailbox_ptr sender, mailbox_ptr receiver)
+{
+  sender->send("receiver", make_e_tuple(atom("person"), e_map(make_person())));
+
+  const matchable_ptr msg = receiver->receive();
+
+  matchable_ptr person;
+
+  check(msg->match(make_e_tuple(atom("person"), erl::any(&person))), "{person, _}");
+
+  const e_map::value_type wanted = list_of(association(make_atom("name"), make_string("Joe")));
+
+  check(person->match(e_map(wanted)), "any #{name := \"Joe\"}");
+}
+
+void look_up_name(const map_view& person, bool& found)
+{
+  for(size_t i = 0; found && (i < 100); ++i) {
+    std::string name;
+
+    found = person.match(atom("name"), e_string(&name)) && ("Joe" == name);
+  }
+}
+
+// The first look-up indexes the map; the copies of a view share that index.
+void view_from_threads(mailbox_ptr sender, mailbox_ptr receiver)
+{
+  sender->send("receiver", e_map(make_person()));
+
+  const matchable_ptr msg = receiver->receive();
+
+  map_view person;
+  check(msg->match(e_map(&person)), "map_view to share");
+
+  const size_t nr_of_threads = 4;
+  bool found[nr_of_threads];
+  const std::vector<map_view> copies(nr_of_threads, person);
+  boost::thread_group threads;
+
+  for(size_t i = 0; i < nr_of_threads; ++i) {
+    found[i] = true;
+    threads.create_thread(boost::bind(look_up_name, boost::cref((i % 2) ? person : copies[i]), boost::ref(found[i])));
+  }
+
+  threads.join_all();
+
+  check(std::count(found, found + nr_of_threads, true) == nr_of_threads, "map_view looked up by several threads");
+}
+
+// The map claims 4294967295 associations, but holds a single one.
+void view_corrupt_map()
+{
+  const char encoded[] = {116, '\xff', '\xff', '\xff', '\xff', 100, 0, 1, 'a', 97, 1};
+
+  map_view corrupt;
+  corrupt.assign(msg_seq(encoded, encoded + sizeof encoded));
+
+  check(!corrupt.has_key(atom("a")), "map_view of a corrupt map");
+}
+
+}
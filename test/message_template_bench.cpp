@@ -0,0 +1,174 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "tinch_pp/erlang_types.h"
+#include "tinch_pp/message_template.h"
+#include "tinch_pp/exceptions.h"
+#include "test_support.h"
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace tinch_pp;
+using namespace tinch_pp::erl;
+using namespace tinch_pp::test;
+
+// USAGE:
+// ======
+// Start this program, optionally with the number of iterations to benchmark 
+// (default 1000000). The program encodes a typical metric message, the way 
+// the mailbox does before a send, in two ways: by building an e_tuple per 
+// send and by filling a pre-encoded message_template. Both have to produce 
+// the same bytes.
+
+namespace {
+
+const std::string metric_name = "cpu_load_of_the_primary_database_server";
+
+// As the mailbox does it: reserve once, then serialize.
+msg_seq encode(const object& term)
+{
+  msg_seq encoded;
+  encoded.reserve(term.encoded_size());
+  msg_seq_out_iter out(encoded);
+
+  term.serialize(out);
+
+  return encoded;
+}
+
+binary_value_type make_name()
+{
+  return binary_value_type(binary_value_type::value_type(metric_name.begin(), metric_name.end()));
+}
+
+msg_seq encode_tuple(const binary_value_type& name, const e_pid& node, boost::int32_t value, boost::int32_t timestamp)
+{
+  return encode(make_e_tuple(atom("metric"), binary(name), pid(node), int_(value), int_(timestamp)));
+}
+
+msg_seq encode_template(const message_template& metric, const e_pid& node, boost::int32_t value, boost::int32_t timestamp)
+{
+  return encode(metric.fill(pid(node), int_(value), int_(timestamp)));
+}
+
+template<typename Encoder>
+double time_encoding(Encoder encoder, size_t iterations)
+{
+  using namespace boost::posix_time;
+
+  size_t total_size = 0;
+  const ptime start = microsec_clock::universal_time();
+
+  for(size_t i = 0; i < iterations; ++i)
+    total_size += encoder(static_cast<boost::int32_t>(i)).size();
+
+  const time_duration elapsed = microsec_clock::universal_time() - start;
+
+  if((iterations > 0) && (total_size == 0))
+    throw std::runtime_error("Nothing encoded!");
+
+  return (iterations == 0) ? 0.0 : (elapsed.total_microseconds() * 1000.0) / iterations;
+}
+
+struct tuple_encoder
+{
+  tuple_encoder(const binary_value_type& a_name, const e_pid& a_node) 
+    : name(a_name), node(a_node) {}
+
+  msg_seq operator()(boost::int32_t i) const { return encode_tuple(name, node, i, 1000000 + i); }
+
+  const binary_value_type& name;
+  const e_pid& node;
+};
+
+struct template_encoder
+{
+  template_encoder(const message_template& a_metric, const e_pid& a_node) 
+    : metric(a_metric), node(a_node) {}
+
+  msg_seq operator()(boost::int32_t i) const { return encode_template(metric, node, i, 1000000 + i); }
+
+  const message_template& metric;
+  const e_pid& node;
+};
+
+// Constructs (and fills) a template of its own as it's serialized within another template.
+class templated_value : public object
+{
+public:
+  virtual void serialize(msg_seq_out_iter& out) const
+  {
+    const message_template inner(make_e_tuple(atom("inner"), hole()));
+
+    inner.fill(int_(1)).serialize(out);
+  }
+
+  virtual size_t encoded_size() const { return encode(make_e_tuple(atom("inner"), int_(1))).size(); }
+
+  virtual bool match(msg_seq_iter& f, const msg_seq_iter& l) const { return false; }
+};
+
+bool fill_is_rejected(const message_template& metric)
+{
+  try {
+    encode(metric.fill(int_(1)));
+  } catch(const tinch_pp_exception&) {
+    return true;
+  }
+
+  return false;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  const size_t iterations = (argc > 1) ? boost::lexical_cast<size_t>(argv[1]) : 1000000;
+
+  const binary_value_type name = make_name();
+  const e_pid node("tinch_pp@127.0.0.1", 42, 0, 1);
+
+  const message_template metric(make_e_tuple(atom("metric"), binary(name), hole(), hole(), hole()));
+
+  check(3 == metric.number_of_holes(), "number of holes");
+  check(encode_tuple(name, node, 5, 6) == encode_template(metric, node, 5, 6), "small values");
+  check(encode_tuple(name, node, -1, 123456789) == encode_template(metric, node, -1, 123456789), "large values");
+  check(fill_is_rejected(metric), "wrong number of values");
+
+  const message_template nested(make_e_tuple(hole(), make_e_tuple(atom("nested"), hole()), atom("end")));
+  check(encode(make_e_tuple(int_(1), make_e_tuple(atom("nested"), e_string("filled")), atom("end"))) == 
+        encode(nested.fill(int_(1), e_string("filled"))), "nested holes");
+
+  const message_template outer(make_e_tuple(atom("outer"), templated_value(), hole()));
+  check((1 == outer.number_of_holes()) && 
+        (encode(make_e_tuple(atom("outer"), make_e_tuple(atom("inner"), int_(1)), int_(2))) == encode(outer.fill(int_(2)))), 
+        "a template constructed within another one");
+
+  const double tuple_ns = time_encoding(tuple_encoder(name, node), iterations);
+  const double template_ns = time_encoding(template_encoder(metric, node), iterations);
+
+  std::cout << "Encoded a message of " << encode_tuple(name, node, 0, 0).size() << " bytes " << iterations << " times:" << std::endl;
+  std::cout << "  e_tuple per send: " << tuple_ns << " ns/message" << std::endl;
+  std::cout << "  message_template: " << template_ns << " ns/message" << std::endl;
+}
@@ -0,0 +1,162 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "tinch_pp/node.h"
+#include "tinch_pp/mailbox.h"
+#include "tinch_pp/erlang_types.h"
+#include "tinch_pp/exceptions.h"
+#include "test_support.h"
+#include <boost/thread.hpp>
+
+using namespace tinch_pp;
+using namespace tinch_pp::erl;
+using namespace tinch_pp::test;
+
+// USAGE:
+// ======
+// Start this program. No EPMD needed: the nodes register at a private name server.
+// The program restarts a peer node and verifies that we're told about it (nodedown, 
+// broken links) and that the connection is re-established in the background (nodeup).
+
+namespace {
+
+const std::string own_name("monitoring_own@127.0.0.1");
+const std::string peer_name("monitored_peer@127.0.0.1");
+
+void node_up(node_ptr own, mailbox_ptr watcher)
+{
+  check(own->ping_peer(peer_name), "a connected peer");
+
+  check(watcher->receive(5)->match(make_e_tuple(atom("nodeup"), atom(peer_name))), "nodeup as connected");
+}
+
+void node_down(node_ptr& peer, mailbox_ptr watcher, mailbox_ptr linked)
+{
+  // Nobody on the peer node knows about this pid => only a lost connection breaks the link.
+  const e_pid remote_pid(peer_name, 4711, 0, 1);
+  linked->link(remote_pid);
+
+  peer.reset();
+
+  check(watcher->receive(5)->match(make_e_tuple(atom("nodedown"), atom(peer_name))), "nodedown as the peer dies");
+
+  std::string reason;
+  e_pid broken;
+
+  try {
+    linked->receive(5);
+  } catch(const link_broken& link_error) {
+    reason = link_error.reason();
+    broken = link_error.broken_pid();
+  }
+
+  check((reason == "noconnection") && (broken == remote_pid), "a link broken by a lost connection");
+}
+
+void reconnect(const private_cluster& cluster, node_ptr own, node_ptr& peer, mailbox_ptr watcher)
+{
+  // Let a few attempts fail before the peer comes back (on another port).
+  boost::this_thread::sleep(boost::posix_time::milliseconds(300));
+  check(!is_connected(own, peer_name), "no connection to a dead peer");
+
+  peer = cluster.start_node(peer_name, 9662);
+
+  check(watcher->receive(10)->match(make_e_tuple(atom("nodeup"), atom(peer_name))), "nodeup as reconnected in the background");
+  check(is_connected(own, peer_name), "a restarted peer reconnected");
+}
+
+// The peer restarts without us noticing (e.g. its host rebooted) and connects to us 
+// while we still hold the old connection.
+void replaced_connection(const private_cluster& cluster, node_ptr own, node_ptr& peer, mailbox_ptr watcher)
+{
+  // The stale node mustn't win the connection back.
+  peer->set_reconnect_backoff(0, 0);
+
+  node_ptr restarted = cluster.create_node(peer_name);
+  mailbox_ptr receiver = restarted->create_mailbox("receiver");
+
+  check(restarted->ping_peer(own_name), "a restarted peer connected while the old connection is up");
+
+  check(watcher->receive(5)->match(make_e_tuple(atom("nodedown"), atom(peer_name))), "nodedown for the stale connection");
+  check(watcher->receive(5)->match(make_e_tuple(atom("nodeup"), atom(peer_name))), "nodeup for the new connection");
+
+  bool quiet = false;
+
+  try {
+    watcher->receive(1);
+  } catch(const mailbox_receive_tmo&) {
+    quiet = true;
+  }
+
+  check(quiet, "one nodedown and one nodeup as the connection is replaced");
+
+  mailbox_ptr sender = own->create_mailbox();
+  sender->send("receiver", peer_name, atom("to_the_new_connection"));
+
+  check(receiver->receive(5)->match(atom("to_the_new_connection")), "sends go to the new connection");
+
+  peer = restarted;
+}
+
+void unsubscribe(node_ptr& peer, mailbox_ptr watcher)
+{
+  watcher->monitor_nodes(false);
+
+  peer.reset();
+
+  bool quiet = false;
+
+  try {
+    watcher->receive(1);
+  } catch(const mailbox_receive_tmo&) {
+    quiet = true;
+  }
+
+  check(quiet, "no events after unsubscribing");
+}
+
+}
+
+int main()
+{
+  const private_cluster cluster;
+
+  node_ptr own = cluster.create_node(own_name);
+  own->publish_port(9660);
+  own->set_reconnect_backoff(50, 400);
+
+  node_ptr peer = cluster.start_node(peer_name, 9661);
+
+  mailbox_ptr watcher = own->create_mailbox();
+  watcher->monitor_nodes(true);
+
+  mailbox_ptr linked = own->create_mailbox();
+
+  node_up(own, watcher);
+
+  node_down(peer, watcher, linked);
+
+  reconnect(cluster, own, peer, watcher);
+
+  replaced_connection(cluster, own, peer, watcher);
+
+  unsubscribe(peer, watcher);
+}
@@ -0,0 +1,93 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "impl/node_reconnector.h"
+#include "impl/constants.h"
+#include "test_support.h"
+#include <boost/asio.hpp>
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/cstdint.hpp>
+
+using namespace tinch_pp;
+using namespace tinch_pp::test;
+namespace asio = boost::asio;
+
+// USAGE:
+// ======
+// Start this program. The program reconnects a node through a node_reconnector, 
+// backed by a fake connect function that counts the attempts.
+
+namespace {
+
+// Succeeds with the given attempt (never, in case of 0).
+class counting_connector
+{
+public:
+  explicit counting_connector(boost::uint32_t a_successful_attempt)
+    : successful_attempt(a_successful_attempt),
+      attempts(0) {}
+
+  void connect(const std::string& node_name, const node_reconnector::outcome_fn_type& outcome_fn)
+  {
+    ++attempts;
+    outcome_fn(attempts == successful_attempt);
+  }
+
+  boost::uint32_t attempts_made() const { return attempts; }
+
+private:
+  const boost::uint32_t successful_attempt;
+  boost::uint32_t attempts;
+};
+
+// Runs until the reconnector has no more attempts scheduled.
+boost::uint32_t attempts_to_reconnect(boost::uint32_t successful_attempt, int times_lost)
+{
+  asio::io_service io_service;
+  counting_connector connector(successful_attempt);
+
+  node_reconnector reconnector(io_service, boost::bind(&counting_connector::connect, &connector, _1, _2));
+  reconnector.set_backoff(1, 2);
+
+  for(int i = 0; i < times_lost; ++i) {
+    reconnector.connection_lost("peer@127.0.0.1");
+
+    io_service.run();
+    io_service.reset();
+  }
+
+  return connector.attempts_made();
+}
+
+}
+
+int main()
+{
+  const boost::uint32_t max_attempts = constants::reconnect_max_attempts;
+
+  check(attempts_to_reconnect(3, 1) == 3, "reconnected at the third attempt");
+
+  check(attempts_to_reconnect(0, 1) == max_attempts, 
+        "given up after " + boost::lexical_cast<std::string>(max_attempts) + " attempts");
+
+  check(attempts_to_reconnect(0, 2) == 2 * max_attempts, "retried as lost again after giving up");
+}
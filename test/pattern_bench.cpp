@@ -0,0 +1,161 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "tinch_pp/erlang_types.h"
+#include "impl/term_decoder.h"
+#include "test_support.h"
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+using namespace tinch_pp;
+using namespace tinch_pp::erl;
+using namespace tinch_pp::test;
+
+// USAGE:
+// ======
+// Start this program, optionally with the number of iterations to benchmark 
+// (default 1000000). The program matches a typical message against the same 
+// pattern in two ways: through an e_tuple, where the elements are matched 
+// inline, and through the dynamic erl::object interface, where each element 
+// is matched by a virtual call. Both have to bind the same values.
+// Finally, it captures a large nested term through erl::any.
+
+namespace {
+
+msg_seq encode(const object& term)
+{
+  msg_seq encoded;
+  msg_seq_out_iter out(encoded);
+
+  term.serialize(out);
+
+  return encoded;
+}
+
+// A tuple of runtime-composed elements, matched the way e_tuple used to do it.
+class dynamic_tuple : public object
+{
+public:
+  explicit dynamic_tuple(const std::vector<object_ptr>& an_elements)
+    : elements(an_elements) {}
+
+  virtual void serialize(msg_seq_out_iter& out) const {} // used for matching only
+
+  virtual bool match(msg_seq_iter& f, const msg_seq_iter& l) const
+  {
+    size_t arity = 0;
+    bool matched = decoder::decode_small_tuple_head(f, l, arity) && (arity == elements.size());
+
+    for(size_t i = 0; matched && (i < elements.size()); ++i)
+      matched = elements[i]->match(f, l);
+
+    return matched;
+  }
+
+private:
+  std::vector<object_ptr> elements;
+};
+
+struct bindings
+{
+  bindings() : id(0), quantity(0) {}
+
+  boost::int32_t id;
+  std::string side;
+  e_pid from;
+  boost::int32_t quantity;
+};
+
+template<typename Pattern>
+double time_matching(msg_seq& msg, const Pattern& pattern, size_t iterations)
+{
+  using namespace boost::posix_time;
+
+  const ptime start = microsec_clock::universal_time();
+
+  for(size_t i = 0; i < iterations; ++i) {
+    msg_seq_iter f = msg.begin();
+
+    if(!pattern.match(f, msg.end()))
+      throw std::runtime_error("Failed to match the benchmark message!");
+  }
+
+  const time_duration elapsed = microsec_clock::universal_time() - start;
+
+  return (iterations == 0) ? 0.0 : (elapsed.total_microseconds() * 1000.0) / iterations;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  const size_t iterations = (argc > 1) ? boost::lexical_cast<size_t>(argv[1]) : 1000000;
+
+  const e_pid trader("tinch_pp@127.0.0.1", 42, 0, 1);
+  msg_seq msg = encode(make_e_tuple(atom("order"), int_(4711), atom("buy"), pid(trader), int_(100000)));
+
+  bindings inlined;
+  const e_tuple<boost::fusion::tuple<atom, int_, atom, pid, int_> > static_pattern = 
+    make_e_tuple(atom("order"), int_(&inlined.id), atom(&inlined.side), pid(&inlined.from), int_(&inlined.quantity));
+
+  bindings dynamic;
+  std::vector<object_ptr> elements;
+  elements.push_back(object_ptr(new atom("order")));
+  elements.push_back(object_ptr(new int_(&dynamic.id)));
+  elements.push_back(object_ptr(new atom(&dynamic.side)));
+  elements.push_back(object_ptr(new pid(&dynamic.from)));
+  elements.push_back(object_ptr(new int_(&dynamic.quantity)));
+  const dynamic_tuple dynamic_pattern(elements);
+
+  const double static_ns = time_matching(msg, static_pattern, iterations);
+  const double dynamic_ns = time_matching(msg, dynamic_pattern, iterations);
+
+  check((inlined.id == 4711) && (inlined.side == "buy") && (inlined.from == trader) && (inlined.quantity == 100000), "e_tuple bindings");
+  check((dynamic.id == inlined.id) && (dynamic.side == inlined.side) && 
+        (dynamic.from == inlined.from) && (dynamic.quantity == inlined.quantity), "erl::object bindings");
+
+  std::cout << "Matched a message of " << msg.size() << " bytes " << iterations << " times:" << std::endl;
+  std::cout << "  e_tuple (inline):      " << static_ns << " ns/match" << std::endl;
+  std::cout << "  erl::object (virtual): " << dynamic_ns << " ns/match" << std::endl;
+
+  std::vector<int_> values;
+  for(boost::int32_t i = 0; i < 100; ++i)
+    values.push_back(int_(i * 1000));
+
+  msg_seq nested = encode(make_e_tuple(atom("reply"), 
+                                       make_e_tuple(erl::list<int_>(values), e_string("nested"), 
+                                                    make_e_tuple(atom("deeper"), pid(trader), float_(1.5)))));
+  matchable_ptr reply_part;
+  const e_tuple<boost::fusion::tuple<atom, any> > capturing_pattern = make_e_tuple(atom("reply"), any(&reply_part));
+
+  const double any_ns = time_matching(nested, capturing_pattern, iterations);
+
+  std::vector<int_> matched_values;
+  std::string matched_string;
+  check(reply_part->match(make_e_tuple(erl::list<int_>(&matched_values), e_string(&matched_string), any())) &&
+        (matched_values.size() == values.size()) && (matched_values.back().value() == values.back().value()) && 
+        (matched_string == "nested"), "any capture");
+
+  std::cout << "Captured a nested term of " << nested.size() << " bytes through any(): " << any_ns << " ns/match" << std::endl;
+}
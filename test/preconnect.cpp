@@ -0,0 +1,142 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "tinch_pp/node.h"
+#include "tinch_pp/mailbox.h"
+#include "tinch_pp/erlang_types.h"
+#include "test_support.h"
+#include <boost/asio.hpp>
+#include <boost/lexical_cast.hpp>
+#include <iostream>
+
+using namespace tinch_pp;
+using namespace tinch_pp::erl;
+using namespace tinch_pp::test;
+
+// USAGE:
+// ======
+// Start this program. No EPMD needed: the nodes register at a private name server.
+// The program starts a few peers and connects to them, and to a missing one, up front.
+
+namespace {
+
+const size_t number_of_peers = 4;
+
+std::string peer_name(size_t i)
+{
+  return "preconnect_peer" + boost::lexical_cast<std::string>(i) + "@127.0.0.1";
+}
+
+const std::string missing_peer("preconnect_missing@127.0.0.1");
+
+// Nobody answers at this address: the connection attempts aren't refused, they just hang.
+const std::string unroutable_peer("preconnect_blackholed@10.255.255.1");
+
+void preconnect_all(node_ptr own, const std::vector<std::string>& nodes)
+{
+  const preconnect_results_type results = own->preconnect(nodes);
+
+  check(results.size() == nodes.size(), "one result per node");
+
+  bool peers_connected = true;
+
+  for(size_t i = 0; i < number_of_peers; ++i) {
+    std::cout << results[i].node_name << " connected in " << results[i].elapsed_ms << " ms" << std::endl;
+    peers_connected = peers_connected && (results[i].node_name == nodes[i]) && results[i].connected && is_connected(own, nodes[i]);
+  }
+
+  check(peers_connected, "all peers connected up front");
+  check(!results.back().connected && (results.back().node_name == missing_peer), "a missing peer reported");
+
+  // Once connected, a new preconnect is immediate.
+  const preconnect_results_type again = own->preconnect(std::vector<std::string>(1, nodes.front()));
+  check(again.front().connected && (again.front().elapsed_ms < 100), "an already connected peer");
+
+  check(own->preconnect(std::vector<std::string>()).empty(), "no nodes");
+}
+
+void given_up_in_time(node_ptr own, const std::string& peer, const std::string& testcase)
+{
+  const preconnect_results_type results = own->preconnect(std::vector<std::string>(1, peer));
+
+  std::cout << peer << " given up after " << results.front().elapsed_ms << " ms" << std::endl;
+
+  check(!results.front().connected && (results.front().elapsed_ms < 9000), testcase);
+}
+
+// The attempt is given up after net_setuptime (7 s), instead of waiting for the OS to give up on EPMD.
+void unroutable_host(node_ptr own)
+{
+  given_up_in_time(own, unroutable_peer, "an unroutable host given up in time");
+}
+
+// An EPMD that accepts the connection (through the listen backlog), but never answers.
+void silent_epmd()
+{
+  boost::asio::io_service io_service;
+  boost::asio::ip::tcp::acceptor silent(io_service, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), 0));
+
+  node_ptr own = node::create("preconnect_silent@127.0.0.1", private_cluster::cookie(), silent.local_endpoint().port());
+
+  given_up_in_time(own, "preconnect_unanswered@127.0.0.1", "a silent EPMD given up in time");
+}
+
+void keep_retrying(const private_cluster& cluster, node_ptr own)
+{
+  mailbox_ptr watcher = own->create_mailbox();
+  watcher->monitor_nodes(true);
+
+  const preconnect_results_type results = own->preconnect(std::vector<std::string>(1, missing_peer), true);
+  check(!results.front().connected, "a missing peer, retried in the background");
+
+  node_ptr late = cluster.start_node(missing_peer, 9675);
+
+  check(watcher->receive(10)->match(make_e_tuple(atom("nodeup"), atom(missing_peer))), "a late peer connected in the background");
+  check(is_connected(own, missing_peer), "a late peer among the connected nodes");
+}
+
+}
+
+int main()
+{
+  const private_cluster cluster;
+
+  node_ptr own = cluster.create_node("preconnect_own@127.0.0.1");
+  own->set_reconnect_backoff(50, 400);
+
+  std::vector<node_ptr> peers;
+  std::vector<std::string> nodes;
+
+  for(size_t i = 0; i < number_of_peers; ++i) {
+    peers.push_back(cluster.start_node(peer_name(i), 9670 + i));
+    nodes.push_back(peer_name(i));
+  }
+
+  nodes.push_back(missing_peer);
+
+  preconnect_all(own, nodes);
+
+  unroutable_host(own);
+
+  silent_epmd();
+
+  keep_retrying(cluster, own);
+}
@@ -0,0 +1,116 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "tinch_pp/node.h"
+#include "tinch_pp/mailbox.h"
+#include "tinch_pp/erlang_types.h"
+#include "tinch_pp/exceptions.h"
+#include "test_support.h"
+
+using namespace tinch_pp;
+using namespace tinch_pp::erl;
+using namespace tinch_pp::test;
+
+// This program tests the sends to a node we're not yet connected to. The sends 
+// are queued while the connection is established and delivered in order.
+//
+// USAGE:
+// ======
+// Start this program. No EPMD needed: the nodes register at a private name server.
+// It creates two nodes, where the first one sends a burst of messages to the second. 
+// It also ensures that the number of bytes queued is limited, that sends to a 
+// non-existing node don't block and that links to such a node break.
+
+namespace {
+
+void burst_while_connecting(node_ptr sending_node, const std::string& receiving_node_name, mailbox_ptr receiver)
+{
+  const int burst_size = 100;
+
+  mailbox_ptr sender = sending_node->create_mailbox();
+
+  for(int i = 0; i < burst_size; ++i)
+    sender->send("receiver", receiving_node_name, make_e_tuple(atom("seq"), int_(i)));
+
+  bool in_order = true;
+
+  for(int i = 0; i < burst_size; ++i) {
+    int received = -1;
+    in_order = receiver->receive(5)->match(make_e_tuple(atom("seq"), int_(&received))) && (received == i) && in_order;
+  }
+
+  check(in_order, "a burst sent while connecting");
+}
+
+void link_to_unreachable_node(node_ptr sending_node)
+{
+  mailbox_ptr linking = sending_node->create_mailbox();
+
+  const e_pid unreachable("non_existing_node@127.0.0.1", 4711, 0, 1);
+  linking->link(unreachable);
+
+  std::string reason;
+
+  try {
+    linking->receive(5);
+  } catch(const link_broken& broken) {
+    reason = broken.reason();
+  }
+
+  check(reason == "noconnection", "a link to an unreachable node");
+}
+
+void limited_queue(node_ptr sending_node)
+{
+  mailbox_ptr sender = sending_node->create_mailbox();
+
+  sending_node->set_max_pending_bytes(16);
+
+  bool thrown = false;
+
+  try {
+    sender->send("receiver", "non_existing_node@127.0.0.1", e_string(std::string(100, 'x')));
+  } catch(const tinch_pp_exception&) {
+    thrown = true;
+  }
+
+  check(thrown, "a send exceeding the pending bytes");
+}
+
+}
+
+int main()
+{
+  const std::string receiving_node_name("queued_receiver@127.0.0.1");
+  
+  const private_cluster cluster;
+
+  node_ptr receiving_node = cluster.start_node(receiving_node_name, 9632);
+  mailbox_ptr receiver = receiving_node->create_mailbox("receiver");
+
+  node_ptr sending_node = cluster.create_node("queued_sender@127.0.0.1");
+
+  burst_while_connecting(sending_node, receiving_node_name, receiver);
+
+  link_to_unreachable_node(sending_node);
+
+  limited_queue(sending_node);
+}
@@ -0,0 +1,208 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "tinch_pp/node.h"
+#include "tinch_pp/mailbox.h"
+#include "tinch_pp/erlang_types.h"
+#include "tinch_pp/receive_clauses.h"
+#include "test_support.h"
+#include <boost/bind.hpp>
+
+using namespace tinch_pp;
+using namespace tinch_pp::erl;
+using namespace tinch_pp::test;
+
+// USAGE:
+// ======
+// Start this program. The program sends messages of different shapes between 
+// two mailboxes on the same node and dispatches them through one set of 
+// receive clauses, the way an Erlang receive does.
+
+namespace {
+
+void dispatch_to_matching_clause(mailbox_ptr sender, mailbox_ptr receiver);
+
+void first_matching_clause_wins(mailbox_ptr sender, mailbox_ptr receiver);
+
+void no_matching_clause(mailbox_ptr sender, mailbox_ptr receiver);
+
+void compiled_once_per_call_site(mailbox_ptr sender, mailbox_ptr receiver);
+
+void compiled_again_for_other_atoms(mailbox_ptr sender, mailbox_ptr receiver);
+
+}
+
+int main()
+{
+  node_ptr my_node = node::create("receive_test@127.0.0.1", "qwerty");
+
+  mailbox_ptr sender = my_node->create_mailbox("sender");
+  mailbox_ptr receiver = my_node->create_mailbox("receiver");
+
+  dispatch_to_matching_clause(sender, receiver);
+
+  first_matching_clause_wins(sender, receiver);
+
+  no_matching_clause(sender, receiver);
+
+  compiled_once_per_call_site(sender, receiver);
+
+  compiled_again_for_other_atoms(sender, receiver);
+}
+
+namespace {
+
+void record(std::string& handled, const std::string& name)
+{
+  handled = name;
+}
+
+void dispatch_to_matching_clause(mailbox_ptr sender, mailbox_ptr receiver)
+{
+  std::string handled;
+  std::string name;
+  boost::int32_t n = 0;
+  boost::int32_t m = 0;
+  e_pid from;
+
+  const receive_clauses on_message(clause(make_e_tuple(atom("add"), int_(&n), int_(&m)), boost::bind(record, boost::ref(handled), "add")),
+                                   clause(make_e_tuple(atom("hello"), atom(&name)), boost::bind(record, boost::ref(handled), "hello")),
+                                   clause(make_e_tuple(atom("hello"), pid(&from), atom(&name)), boost::bind(record, boost::ref(handled), "hello from")),
+                                   clause(atom("stop"), boost::bind(record, boost::ref(handled), "stop")),
+                                   clause(make_e_tuple(any(), int_(&n)), boost::bind(record, boost::ref(handled), "tagged int")));
+
+  sender->send("receiver", make_e_tuple(atom("hello"), atom("joe")));
+  check(on_message.receive(*receiver) && (handled == "hello") && (name == "joe"), "{hello, Name}");
+
+  sender->send("receiver", make_e_tuple(atom("add"), int_(1), int_(2)));
+  check(on_message.receive(*receiver) && (handled == "add") && (n == 1) && (m == 2), "{add, N, M}");
+
+  // The same compiled clauses, another message => the variables are bound again.
+  sender->send("receiver", make_e_tuple(atom("add"), int_(40), int_(2)));
+  check(on_message.receive(*receiver) && (handled == "add") && (n + m == 42), "{add, N, M} again");
+
+  sender->send("receiver", make_e_tuple(atom("hello"), pid(sender->self()), atom("mike")));
+  check(on_message.receive(*receiver) && (handled == "hello from") && (from == sender->self()) && (name == "mike"), "{hello, From, Name}");
+
+  sender->send("receiver", make_e_tuple(atom("increment"), int_(4711)));
+  check(on_message.receive(*receiver) && (handled == "tagged int") && (n == 4711), "{_, N}");
+
+  sender->send("receiver", atom("stop"));
+  check(on_message.receive(*receiver) && (handled == "stop"), "stop");
+}
+
+void first_matching_clause_wins(mailbox_ptr sender, mailbox_ptr receiver)
+{
+  std::string handled;
+  matchable_ptr rest;
+
+  const receive_clauses on_message(clause(make_e_tuple(atom("data"), e_string("first")), boost::bind(record, boost::ref(handled), "first")),
+                                   clause(make_e_tuple(any(), any(&rest)), boost::bind(record, boost::ref(handled), "any pair")),
+                                   clause(make_e_tuple(atom("data"), any()), boost::bind(record, boost::ref(handled), "data")));
+
+  sender->send("receiver", make_e_tuple(atom("data"), e_string("first")));
+  check(on_message.receive(*receiver) && (handled == "first"), "{data, \"first\"}");
+
+  sender->send("receiver", make_e_tuple(atom("data"), e_string("second")));
+  check(on_message.receive(*receiver) && (handled == "any pair"), "{_, Rest} before {data, _}");
+
+  std::string text;
+  check(rest->match(e_string(&text)) && (text == "second"), "the captured element");
+}
+
+void no_matching_clause(mailbox_ptr sender, mailbox_ptr receiver)
+{
+  std::string handled;
+
+  const receive_clauses on_message(clause(make_e_tuple(atom("ping"), any()), boost::bind(record, boost::ref(handled), "ping")));
+
+  sender->send("receiver", make_e_tuple(atom("pong"), int_(1)));
+  check(!on_message.receive(*receiver) && handled.empty(), "{pong, 1} unhandled");
+
+  sender->send("receiver", make_e_tuple(atom("ping"), int_(1), int_(2)));
+  check(!on_message.receive(*receiver) && handled.empty(), "{ping, 1, 2} unhandled");
+
+  sender->send("receiver", int_(42));
+  check(!on_message.receive(*receiver) && handled.empty(), "42 unhandled");
+}
+
+// The call site below is passed with other variables each time.
+size_t receive_add(mailbox& receiver, std::string& handled, boost::int32_t& n)
+{
+  static compiled_clauses compiled;
+
+  const receive_clauses on_message(compiled,
+                                   clause(make_e_tuple(atom("add"), int_(&n)), boost::bind(record, boost::ref(handled), "add")),
+                                   clause(any(), boost::bind(record, boost::ref(handled), "other")));
+  on_message.receive(receiver);
+
+  return compiled.compilations();
+}
+
+void compiled_once_per_call_site(mailbox_ptr sender, mailbox_ptr receiver)
+{
+  std::string first_handled;
+  boost::int32_t first_n = 0;
+
+  sender->send("receiver", make_e_tuple(atom("add"), int_(1)));
+  check((receive_add(*receiver, first_handled, first_n) == 1) && (first_handled == "add") && (first_n == 1), "compiled at the first pass");
+
+  std::string second_handled;
+  boost::int32_t second_n = 0;
+
+  sender->send("receiver", make_e_tuple(atom("add"), int_(2)));
+  check((receive_add(*receiver, second_handled, second_n) == 1) && (second_handled == "add") && (second_n == 2) && (first_n == 1), 
+        "not compiled again, other variables bound");
+
+  sender->send("receiver", atom("stop"));
+  check((receive_add(*receiver, second_handled, second_n) == 1) && (second_handled == "other"), "the cached clauses dispatch");
+}
+
+// The leading atom of the first pattern is given by the caller => it's part of the key.
+size_t receive_command(mailbox& receiver, const std::string& command, std::string& handled)
+{
+  static compiled_clauses compiled;
+
+  const receive_clauses on_message(compiled,
+                                   clause(make_e_tuple(atom(command), any()), boost::bind(record, boost::ref(handled), command)),
+                                   clause(any(), boost::bind(record, boost::ref(handled), "other")));
+  on_message.receive(receiver);
+
+  return compiled.compilations();
+}
+
+void compiled_again_for_other_atoms(mailbox_ptr sender, mailbox_ptr receiver)
+{
+  std::string handled;
+
+  sender->send("receiver", make_e_tuple(atom("add"), int_(1)));
+  check((receive_command(*receiver, "add", handled) == 1) && (handled == "add"), "{add, _} at the first pass");
+
+  handled.clear();
+  sender->send("receiver", make_e_tuple(atom("sub"), int_(1)));
+  check((receive_command(*receiver, "sub", handled) == 2) && (handled == "sub"), "{sub, _} compiled again");
+
+  handled.clear();
+  sender->send("receiver", make_e_tuple(atom("sub"), int_(2)));
+  check((receive_command(*receiver, "sub", handled) == 2) && (handled == "sub"), "{sub, _} from the cache");
+}
+
+}
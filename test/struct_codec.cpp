@@ -0,0 +1,315 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "tinch_pp/node.h"
+#include "tinch_pp/mailbox.h"
+#include "tinch_pp/erlang_types.h"
+#include "tinch_pp/erl_struct.h"
+#include "impl/matchable_seq.h"
+#include "test_support.h"
+#include <boost/fusion/include/adapt_struct.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/assign/list_of.hpp>
+#include <iostream>
+#include <stdexcept>
+
+using namespace tinch_pp;
+using namespace tinch_pp::erl;
+using namespace tinch_pp::test;
+using namespace boost::assign;
+
+// USAGE:
+// ======
+// Start this program, optionally with the number of iterations to benchmark 
+// (default 1000000). The program sends structs adapted through Boost Fusion 
+// between two mailboxes and decodes them straight into structs again. Finally, 
+// it compares decoding into a struct with matching an e_tuple of assigners.
+
+struct coordinates
+{
+  boost::int32_t x;
+  boost::int32_t y;
+};
+
+struct trade
+{
+  e_atom side;
+  boost::int32_t quantity;
+  std::string item;
+  e_pid trader;
+  coordinates at;
+  std::vector<boost::int32_t> batches;
+  binary_value_type attachment;
+  double price;
+};
+
+// The list assigners of an e_tuple append to their lists => we benchmark without a list.
+struct quote
+{
+  e_atom side;
+  boost::int32_t quantity;
+  std::string item;
+  e_pid trader;
+  coordinates at;
+  binary_value_type attachment;
+  double price;
+};
+
+struct codes
+{
+  std::string name;
+  std::vector<boost::int32_t> values;
+};
+
+struct reading
+{
+  boost::int32_t sensor;
+  double value;
+};
+
+BOOST_FUSION_ADAPT_STRUCT(
+   coordinates,
+   (boost::int32_t, x)
+   (boost::int32_t, y))
+
+BOOST_FUSION_ADAPT_STRUCT(
+   trade,
+   (tinch_pp::e_atom, side)
+   (boost::int32_t, quantity)
+   (std::string, item)
+   (tinch_pp::e_pid, trader)
+   (coordinates, at)
+   (std::vector<boost::int32_t>, batches)
+   (tinch_pp::binary_value_type, attachment)
+   (double, price))
+
+BOOST_FUSION_ADAPT_STRUCT(
+   quote,
+   (tinch_pp::e_atom, side)
+   (boost::int32_t, quantity)
+   (std::string, item)
+   (tinch_pp::e_pid, trader)
+   (coordinates, at)
+   (tinch_pp::binary_value_type, attachment)
+   (double, price))
+
+BOOST_FUSION_ADAPT_STRUCT(
+   codes,
+   (std::string, name)
+   (std::vector<boost::int32_t>, values))
+
+BOOST_FUSION_ADAPT_STRUCT(
+   reading,
+   (boost::int32_t, sensor)
+   (double, value))
+
+namespace {
+
+msg_seq encode(const object& term)
+{
+  msg_seq encoded;
+  msg_seq_out_iter out(encoded);
+
+  term.serialize(out);
+
+  return encoded;
+}
+
+trade make_trade(const e_pid& trader)
+{
+  trade o;
+
+  o.side = e_atom("buy");
+  o.quantity = 100000;
+  o.item = "bananas";
+  o.trader = trader;
+  o.at.x = 3;
+  o.at.y = 4711;
+  o.batches = list_of(1)(2)(300);
+  o.attachment = binary_value_type(binary_value_type::value_type(16, 'a'));
+  o.price = 2.5;
+
+  return o;
+}
+
+bool same_trades(const trade& o1, const trade& o2)
+{
+  return (o1.side.name == o2.side.name) && (o1.quantity == o2.quantity) && (o1.item == o2.item) &&
+         (o1.trader == o2.trader) && (o1.at.x == o2.at.x) && (o1.at.y == o2.at.y) && 
+         (o1.batches == o2.batches) && (o1.attachment == o2.attachment) && (o1.price == o2.price);
+}
+
+void encode_as_tuple(const trade& sent)
+{
+  const std::vector<int_> batches = list_of(int_(1))(int_(2))(int_(300));
+  const msg_seq as_tuple = encode(make_e_tuple(atom("buy"), int_(100000), e_string("bananas"), pid(sent.trader), 
+                                               make_e_tuple(int_(3), int_(4711)), erl::list<int_>(batches), 
+                                               binary(sent.attachment), float_(2.5)));
+
+  check(encode(make_e_struct(sent)) == as_tuple, "a struct is encoded as the corresponding tuple");
+  check(make_e_struct(sent).encoded_size() == as_tuple.size(), "the encoded size of a struct");
+}
+
+void send_and_receive(mailbox_ptr sender, mailbox_ptr receiver, const trade& sent)
+{
+  sender->send("receiver", make_e_struct(sent));
+
+  const matchable_ptr msg = receiver->receive();
+
+  trade received;
+  check(msg->match(make_e_struct(&received)) && same_trades(sent, received), "a received struct");
+  check(msg->match(make_e_struct(sent)), "a struct as value");
+
+  coordinates wrong_arity;
+  check(!msg->match(make_e_struct(&wrong_arity)), "a struct of another arity");
+}
+
+coordinates make_coordinates(boost::int32_t x, boost::int32_t y)
+{
+  coordinates c;
+  c.x = x;
+  c.y = y;
+
+  return c;
+}
+
+// The pattern keeps a copy of its value, which may be a temporary.
+void value_of_temporary()
+{
+  const e_struct<coordinates> pattern = make_e_struct(make_coordinates(3, 4711));
+
+  check(encode(pattern) == encode(make_e_tuple(int_(3), int_(4711))), "a struct made from a temporary");
+}
+
+// Erlang sends the empty string as nil and lists of small integers as strings.
+void decode_compact_lists()
+{
+  const unsigned char encoded[] = {104, 2, 106, 107, 0, 3, 1, 2, 255};
+  const matchable_seq msg(msg_seq(encoded, encoded + sizeof encoded));
+
+  codes decoded;
+  decoded.name = "replaced";
+  const std::vector<boost::int32_t> expected = list_of(1)(2)(255);
+
+  check(msg.match(make_e_struct(&decoded)) && decoded.name.empty() && (decoded.values == expected), 
+        "compact encodings of lists");
+}
+
+// Newer Erlang versions send their floats as NEW_FLOAT_EXT (here 2.5).
+void decode_new_float()
+{
+  const unsigned char encoded[] = {104, 2, 97, 7, 70, 0x40, 0x04, 0, 0, 0, 0, 0, 0};
+  const matchable_seq msg(msg_seq(encoded, encoded + sizeof encoded));
+
+  reading decoded;
+  check(msg.match(make_e_struct(&decoded)) && (decoded.sensor == 7) && (decoded.value == 2.5), "a NEW_FLOAT_EXT");
+}
+
+// A list can't have more elements than the bytes left in the message.
+void reject_corrupt_list_length()
+{
+  const unsigned char encoded[] = {104, 2, 106, 108, 0xff, 0xff, 0xff, 0xff, 97, 1, 106};
+  const matchable_seq msg(msg_seq(encoded, encoded + sizeof encoded));
+
+  codes decoded;
+  check(!msg.match(make_e_struct(&decoded)), "a list longer than the message");
+}
+
+template<typename Pattern>
+double time_decoding(msg_seq& msg, const Pattern& pattern, size_t iterations)
+{
+  using namespace boost::posix_time;
+
+  const ptime start = microsec_clock::universal_time();
+
+  for(size_t i = 0; i < iterations; ++i) {
+    msg_seq_iter f = msg.begin();
+
+    if(!pattern.match(f, msg.end()))
+      throw std::runtime_error("Failed to decode the benchmark message!");
+  }
+
+  const time_duration elapsed = microsec_clock::universal_time() - start;
+
+  return (iterations == 0) ? 0.0 : (elapsed.total_microseconds() * 1000.0) / iterations;
+}
+
+void benchmark(const trade& sent, size_t iterations)
+{
+  quote q;
+  q.side = sent.side;
+  q.quantity = sent.quantity;
+  q.item = sent.item;
+  q.trader = sent.trader;
+  q.at = sent.at;
+  q.attachment = sent.attachment;
+  q.price = sent.price;
+
+  msg_seq msg = encode(make_e_struct(q));
+
+  quote decoded;
+  const double struct_ns = time_decoding(msg, make_e_struct(&decoded), iterations);
+
+  quote assigned;
+  std::string side;
+  const double tuple_ns = time_decoding(msg, make_e_tuple(atom(&side), int_(&assigned.quantity), e_string(&assigned.item), 
+                                                          pid(&assigned.trader), 
+                                                          make_e_tuple(int_(&assigned.at.x), int_(&assigned.at.y)),
+                                                          binary(&assigned.attachment), float_(&assigned.price)), 
+                                        iterations);
+
+  check((decoded.side.name == q.side.name) && (decoded.item == q.item) && (decoded.trader == q.trader) && 
+        (decoded.at.y == q.at.y) && (decoded.attachment == q.attachment) && (decoded.price == q.price) &&
+        (side == q.side.name) && (assigned.item == q.item) && (assigned.at.y == q.at.y), "the benchmark results");
+
+  std::cout << "Decoded a message of " << msg.size() << " bytes " << iterations << " times:" << std::endl;
+  std::cout << "  e_struct:             " << struct_ns << " ns/message" << std::endl;
+  std::cout << "  e_tuple of assigners: " << tuple_ns << " ns/message" << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  const size_t iterations = (argc > 1) ? boost::lexical_cast<size_t>(argv[1]) : 1000000;
+
+  node_ptr my_node = node::create("struct_codec_test@127.0.0.1", "qwerty");
+
+  mailbox_ptr sender = my_node->create_mailbox("sender");
+  mailbox_ptr receiver = my_node->create_mailbox("receiver");
+
+  const trade sent = make_trade(sender->self());
+
+  encode_as_tuple(sent);
+
+  send_and_receive(sender, receiver, sent);
+
+  value_of_temporary();
+
+  decode_compact_lists();
+
+  decode_new_float();
+
+  reject_corrupt_list_length();
+
+  benchmark(sent, iterations);
+}
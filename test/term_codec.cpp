@@ -0,0 +1,152 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "tinch_pp/erlang_types.h"
+#include "tinch_pp/term_codec.h"
+#include "tinch_pp/exceptions.h"
+#include "test_support.h"
+#include <boost/bind.hpp>
+
+using namespace tinch_pp;
+using namespace tinch_pp::erl;
+using namespace tinch_pp::test;
+
+// USAGE:
+// ======
+// Start this program. The program encodes terms into binaries, decodes them back 
+// and streams a large list through a term_encoder in chunks.
+
+namespace {
+
+void round_trip()
+{
+  const msg_seq encoded = term_to_binary(make_e_tuple(atom("stored"), int_(42), e_string("text")));
+
+  check((encoded.size() > 1) && (131 == static_cast<unsigned char>(encoded[0])), "the version magic");
+
+  std::string text;
+  check(binary_to_term(encoded)->match(make_e_tuple(atom("stored"), int_(42), e_string(&text))) && (text == "text"), 
+        "a round trip");
+}
+
+void compressed_round_trip()
+{
+  const std::string large(10000, 'x');
+  const msg_seq encoded = term_to_binary(make_e_tuple(atom("large"), e_string(large)), true);
+
+  check(encoded.size() < large.size(), "a compressed term");
+
+  std::string decoded;
+  check(binary_to_term(encoded)->match(make_e_tuple(atom("large"), e_string(&decoded))) && (decoded == large), 
+        "a compressed round trip");
+
+  check(term_to_binary(atom("small"), true) == term_to_binary(atom("small")), "a term too small to compress");
+}
+
+bool is_rejected(const msg_seq& encoded)
+{
+  try {
+    binary_to_term(encoded);
+  } catch(const tinch_pp_exception&) {
+    return true;
+  }
+
+  return false;
+}
+
+void erroneous_version()
+{
+  msg_seq encoded = term_to_binary(atom("versioned"));
+  encoded[0] = 130;
+
+  check(is_rejected(encoded), "an erroneous version");
+}
+
+void truncated_compressed_term()
+{
+  msg_seq encoded = term_to_binary(e_string(std::string(10000, 'x')), true);
+  encoded.resize(encoded.size() - 10);
+
+  check(is_rejected(encoded), "a truncated compressed term");
+}
+
+struct chunk_collector
+{
+  void add(const char* data, size_t size)
+  {
+    collected.insert(collected.end(), data, data + size);
+    ++chunks;
+  }
+
+  msg_seq collected;
+  size_t chunks;
+};
+
+void streamed_list()
+{
+  const size_t length = 100000;
+  const size_t chunk_size = 4096;
+
+  chunk_collector collector;
+  collector.chunks = 0;
+
+  term_encoder encoder(boost::bind(&chunk_collector::add, &collector, _1, _2), chunk_size);
+
+  encoder.begin_tuple(2);
+  encoder.put(atom("readings"));
+  encoder.begin_list(length);
+
+  for(size_t i = 0; i < length; ++i)
+    encoder.put(int_(static_cast<boost::int32_t>(i)));
+
+  encoder.end_list();
+  encoder.flush();
+
+  check(collector.chunks > 1, "a stream in several chunks");
+
+  list<int_>::list_type readings;
+  
+  for(size_t i = 0; i < length; ++i)
+    readings.push_back(int_(static_cast<boost::int32_t>(i)));
+
+  const msg_seq expected = term_to_binary(make_e_tuple(atom("readings"), list<int_>(readings)));
+
+  check(collector.collected == expected, "a stream equal to term_to_binary");
+
+  list<int_>::list_type decoded;
+  check(binary_to_term(collector.collected)->match(make_e_tuple(atom("readings"), list<int_>(&decoded))) &&
+        (decoded.size() == length), "a decoded stream");
+}
+
+}
+
+int main()
+{
+  round_trip();
+
+  compressed_round_trip();
+
+  erroneous_version();
+
+  truncated_compressed_term();
+
+  streamed_list();
+}
@@ -0,0 +1,119 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "impl/term_compression.h"
+#include "tinch_pp/exceptions.h"
+#include "test_support.h"
+#include <boost/lexical_cast.hpp>
+
+using namespace tinch_pp;
+using namespace tinch_pp::test;
+
+// USAGE:
+// ======
+// Start this program. The program compresses terms, inflates them back and 
+// verifies that corrupt compressed terms are rejected.
+
+namespace {
+
+// Any content will do; zlib doesn't care about the term format.
+msg_seq compressed_term(size_t size)
+{
+  msg_seq compressed;
+  check(deflate_term(msg_seq(size, 'x'), compressed), "a compressed term of size " + boost::lexical_cast<std::string>(size));
+
+  return compressed;
+}
+
+// The uncompressed size is a big-endian dword following the tag.
+void set_uncompressed_size(msg_seq& compressed, boost::uint32_t size)
+{
+  compressed[1] = static_cast<char>(size >> 24);
+  compressed[2] = static_cast<char>(size >> 16);
+  compressed[3] = static_cast<char>(size >> 8);
+  compressed[4] = static_cast<char>(size);
+}
+
+bool is_rejected(msg_seq compressed)
+{
+  msg_seq inflated;
+
+  try {
+    inflate_term(compressed.begin(), compressed.end(), inflated);
+  } catch(const tinch_pp_exception&) {
+    return true;
+  }
+
+  return false;
+}
+
+void valid_terms()
+{
+  // The large term inflates beyond the initial size of the buffer.
+  const size_t sizes[] = {1000, 1000000};
+
+  for(size_t i = 0; i < sizeof sizes / sizeof sizes[0]; ++i) {
+    msg_seq compressed = compressed_term(sizes[i]);
+    msg_seq inflated;
+
+    check(is_compressed_term(compressed.begin(), compressed.end()), "a term tagged as compressed");
+
+    inflate_term(compressed.begin(), compressed.end(), inflated);
+    check(inflated == msg_seq(sizes[i], 'x'), "an inflated term");
+  }
+}
+
+void truncated_term()
+{
+  msg_seq compressed = compressed_term(100000);
+  compressed.resize(compressed.size() / 2);
+
+  check(is_rejected(compressed), "a truncated term");
+}
+
+void oversized_header()
+{
+  msg_seq compressed = compressed_term(1000);
+  set_uncompressed_size(compressed, 0xffffffff);
+
+  check(is_rejected(compressed), "a header claiming 4 GB");
+}
+
+void undersized_header()
+{
+  msg_seq compressed = compressed_term(100000);
+  set_uncompressed_size(compressed, 1000);
+
+  check(is_rejected(compressed), "a header claiming less than the term");
+}
+
+}
+
+int main()
+{
+  valid_terms();
+
+  truncated_term();
+
+  oversized_header();
+
+  undersized_header();
+}
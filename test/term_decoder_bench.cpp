@@ -0,0 +1,269 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "tinch_pp/erlang_types.h"
+#include "impl/term_decoder.h"
+#include "impl/term_conversions.h"
+#include "impl/ext_term_grammar.h"
+#include "test_support.h"
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+using namespace tinch_pp;
+using namespace tinch_pp::erl;
+using namespace tinch_pp::test;
+
+// USAGE:
+// ======
+// Start this program, optionally with the number of iterations to benchmark 
+// (default 100000). The program verifies that the hand-written decoders in 
+// impl/term_decoder.h accept exactly the input of their Spirit grammars, on 
+// complete as well as truncated terms, and then compares the time needed by the 
+// two implementations to decode some realistic messages.
+
+namespace {
+
+void decoders_agree_with_grammars();
+
+void benchmark_decoders(size_t iterations);
+
+}
+
+int main(int argc, char* argv[])
+{
+  const size_t iterations = (argc > 1) ? boost::lexical_cast<size_t>(argv[1]) : 100000;
+
+  decoders_agree_with_grammars();
+
+  benchmark_decoders(iterations);
+}
+
+namespace {
+
+msg_seq encode(const object& term)
+{
+  msg_seq encoded;
+  msg_seq_out_iter out(encoded);
+
+  term.serialize(out);
+
+  return encoded;
+}
+
+// Runs the Spirit grammar and the decoder on the same input and requires them to 
+// agree on the outcome, the decoded attribute and the position where they stopped.
+template<typename Grammar, typename T, typename Decoder>
+bool agree_on(msg_seq& encoded, size_t length, Decoder decode)
+{
+  const msg_seq_iter l = encoded.begin() + length;
+
+  msg_seq_iter grammar_f = encoded.begin();
+  T grammar_attr = T();
+  const bool grammar_success = binary_to_term<Grammar>(grammar_f, l, grammar_attr);
+
+  msg_seq_iter decoder_f = encoded.begin();
+  T decoder_attr = T();
+  const bool decoder_success = decode(decoder_f, l, decoder_attr);
+
+  if(grammar_success != decoder_success)
+    return false;
+
+  // The grammars leave f at an undefined position upon failure.
+  return !grammar_success || ((grammar_f == decoder_f) && (grammar_attr == decoder_attr));
+}
+
+// Every prefix of a term is an incomplete term => the grammar and the decoder 
+// have to fail on them in the same way as they succeed on the complete term.
+template<typename Grammar, typename T, typename Decoder>
+bool agree_on_prefixes(const object& term, Decoder decode)
+{
+  msg_seq encoded = encode(term);
+  bool agree = true;
+
+  for(size_t length = 0; agree && (length <= encoded.size()); ++length)
+    agree = agree_on<Grammar, T>(encoded, length, decode);
+
+  return agree;
+}
+
+bool decode_tuple_head(msg_seq_iter& f, const msg_seq_iter& l, int& arity)
+{
+  size_t parsed = 0;
+  const bool success = decoder::decode_small_tuple_head(f, l, parsed);
+
+  arity = static_cast<int>(parsed);
+
+  return success;
+}
+
+bool decode_binary_value(msg_seq_iter& f, const msg_seq_iter& l, msg_seq& val)
+{
+  msg_seq_iter i = f;
+  size_t length = 0;
+  int padding_bits = 0;
+
+  if(!decoder::decode_binary_head(i, l, length, padding_bits) || (0 != padding_bits) || (decoder::available(i, l) < length))
+    return false;
+
+  val.assign(i, i + length);
+  f = i + length;
+
+  return true;
+}
+
+void decoders_agree_with_grammars()
+{
+  const std::vector<int_> numbers(3, int_(1000));
+  const msg_seq bytes(300, 'x');
+
+  check(agree_on_prefixes<tinch_pp::integer, boost::int32_t>(int_(42), decoder::decode_integer), "small integer");
+  check(agree_on_prefixes<tinch_pp::integer, boost::int32_t>(int_(-4711), decoder::decode_integer), "integer");
+  check(agree_on_prefixes<tinch_pp::integer, boost::int32_t>(atom("no_integer"), decoder::decode_integer), "integer on an atom");
+  check(agree_on_prefixes<atom_ext, std::string>(atom("a_somewhat_longer_atom"), decoder::decode_atom), "atom");
+  check(agree_on_prefixes<atom_ext, std::string>(atom(""), decoder::decode_atom), "empty atom");
+  check(agree_on_prefixes<atom_ext, std::string>(int_(1), decoder::decode_atom), "atom on an integer");
+  check(agree_on_prefixes<pid_ext, e_pid>(pid(e_pid("node@host", 4711, 3, 2)), decoder::decode_pid), "pid");
+  check(agree_on_prefixes<small_tuple_head_ext, int>(make_e_tuple(atom("a"), int_(1)), decode_tuple_head), "tuple head");
+  check(agree_on_prefixes<list_head_ext, size_t>(make_list(numbers), decoder::decode_list_head), "list head");
+  check(agree_on_prefixes<string_head_ext, size_t>(e_string("a string"), decoder::decode_string_head), "string head");
+  check(agree_on_prefixes<binary_ext, msg_seq>(binary(binary_value_type(bytes)), decode_binary_value), "binary");
+}
+
+// A typical RPC request and reply. Each message is decoded term by term, the way 
+// the matching of a pattern like {rpc, Pid, {call, Mod, Fun, [A, B, C]}, Data} does it.
+msg_seq realistic_message()
+{
+  const std::vector<int_> args(3, int_(100000));
+
+  return encode(make_e_tuple(atom("rpc"), 
+                             pid(e_pid("tinch_pp@127.0.0.1", 42, 0, 1)),
+                             make_e_tuple(atom("call"), atom("a_module"), atom("a_function"), make_list(args)),
+                             e_string("some textual data")));
+}
+
+struct grammar_path
+{
+  static bool decode(msg_seq_iter& f, const msg_seq_iter& l)
+  {
+    int arity = 0;
+    size_t length = 0;
+    boost::int32_t n = 0;
+    std::string a_tag, a_module, a_function, a_call;
+    e_pid a_pid;
+
+    bool ok = binary_to_term<small_tuple_head_ext>(f, l, arity) && 
+              binary_to_term<atom_ext>(f, l, a_tag) &&
+              binary_to_term<pid_ext>(f, l, a_pid) &&
+              binary_to_term<small_tuple_head_ext>(f, l, arity) &&
+              binary_to_term<atom_ext>(f, l, a_call) &&
+              binary_to_term<atom_ext>(f, l, a_module) &&
+              binary_to_term<atom_ext>(f, l, a_function) &&
+              binary_to_term<list_head_ext>(f, l, length);
+
+    for(size_t i = 0; ok && (i < length); ++i)
+      ok = binary_to_term<tinch_pp::integer>(f, l, n);
+
+    ok = ok && qi::parse(f, l, qi::byte_(type_tag::nil_ext)) && binary_to_term<string_head_ext>(f, l, length);
+
+    return ok && (decoder::available(f, l) == length);
+  }
+};
+
+struct decoder_path
+{
+  static bool decode(msg_seq_iter& f, const msg_seq_iter& l)
+  {
+    size_t arity = 0;
+    size_t length = 0;
+    boost::int32_t n = 0;
+    std::string a_tag, a_module, a_function, a_call;
+    e_pid a_pid;
+
+    bool ok = decoder::decode_small_tuple_head(f, l, arity) && 
+              decoder::decode_atom(f, l, a_tag) &&
+              decoder::decode_pid(f, l, a_pid) &&
+              decoder::decode_small_tuple_head(f, l, arity) &&
+              decoder::decode_atom(f, l, a_call) &&
+              decoder::decode_atom(f, l, a_module) &&
+              decoder::decode_atom(f, l, a_function) &&
+              decoder::decode_list_head(f, l, length);
+
+    for(size_t i = 0; ok && (i < length); ++i)
+      ok = decoder::decode_integer(f, l, n);
+
+    ok = ok && decoder::decode_nil(f, l) && decoder::decode_string_head(f, l, length);
+
+    return ok && (decoder::available(f, l) == length);
+  }
+};
+
+// The complete matching through erl::object::match, which uses the decoders.
+struct pattern_path
+{
+  static bool decode(msg_seq_iter& f, const msg_seq_iter& l)
+  {
+    e_pid a_pid;
+    std::string a_module, a_function, data;
+    std::vector<int_> args;
+
+    return make_e_tuple(atom("rpc"), pid(&a_pid),
+                        make_e_tuple(atom("call"), atom(&a_module), atom(&a_function), make_list(&args)),
+                        e_string(&data)).match(f, l);
+  }
+};
+
+template<typename Path>
+double time_decoding(msg_seq& msg, size_t iterations)
+{
+  using namespace boost::posix_time;
+
+  const ptime start = microsec_clock::universal_time();
+
+  for(size_t i = 0; i < iterations; ++i) {
+    msg_seq_iter f = msg.begin();
+
+    if(!Path::decode(f, msg.end()))
+      throw std::runtime_error("Failed to decode the benchmark message!");
+  }
+
+  const time_duration elapsed = microsec_clock::universal_time() - start;
+
+  return (iterations == 0) ? 0.0 : (elapsed.total_microseconds() * 1000.0) / iterations;
+}
+
+void benchmark_decoders(size_t iterations)
+{
+  msg_seq msg = realistic_message();
+
+  const double grammar_ns = time_decoding<grammar_path>(msg, iterations);
+  const double decoder_ns = time_decoding<decoder_path>(msg, iterations);
+  const double pattern_ns = time_decoding<pattern_path>(msg, iterations);
+
+  std::cout << "Decoded a message of " << msg.size() << " bytes " << iterations << " times:" << std::endl;
+  std::cout << "  Spirit grammars:  " << grammar_ns << " ns/message" << std::endl;
+  std::cout << "  term decoder:     " << decoder_ns << " ns/message" << std::endl;
+  std::cout << "  object::match:    " << pattern_ns << " ns/message (incl. building the pattern)" << std::endl;
+}
+
+}
@@ -0,0 +1,195 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "tinch_pp/node.h"
+#include "tinch_pp/mailbox.h"
+#include "tinch_pp/erlang_types.h"
+#include "tinch_pp/term_visitor.h"
+#include "impl/matchable_seq.h"
+#include "test_support.h"
+#include <boost/assign/list_of.hpp>
+#include <boost/lexical_cast.hpp>
+#include <sstream>
+#include <stdexcept>
+
+using namespace tinch_pp;
+using namespace tinch_pp::erl;
+using namespace tinch_pp::test;
+using namespace boost::assign;
+
+// USAGE:
+// ======
+// Start this program. The program visits received messages of shapes unknown 
+// to the visitor and renders them in Erlang syntax, as a generic logger would.
+
+namespace {
+
+// Renders the visited terms in Erlang syntax.
+class erlang_printer : public term_visitor
+{
+public:
+  erlang_printer() : first_in_compound(true) {}
+
+  virtual void on_int(boost::int32_t value) { separate(); out << value; }
+
+  virtual void on_float(double value) { separate(); out << value; }
+
+  virtual void on_atom(const char* name, size_t length) { separate(); out.write(name, length); }
+
+  virtual void on_string(const char* chars, size_t length) { separate(); out << '"'; out.write(chars, length); out << '"'; }
+
+  virtual void on_binary(const binary_view& binary) { separate(); out << "<<" << binary.size() << " bytes>>"; }
+
+  virtual void on_pid(const e_pid& pid) { separate(); out << "<" << pid.node_name << "." << pid.id << "." << pid.serial << ">"; }
+
+  virtual void on_tuple_begin(size_t arity) { begin('{'); }
+
+  virtual void on_tuple_end() { end('}'); }
+
+  virtual void on_list_begin(size_t length) { begin('['); }
+
+  virtual void on_list_end() { end(']'); }
+
+  virtual void on_map_begin(size_t arity) { begin('#'); out << '{'; }
+
+  virtual void on_map_end() { end('}'); }
+
+  virtual void on_unsupported(int type_tag, const char* encoded, size_t length) { separate(); out << "?" << type_tag; }
+
+  std::string str() const { return out.str(); }
+
+private:
+  void separate()
+  {
+    if(!first_in_compound)
+      out << ",";
+
+    first_in_compound = false;
+  }
+
+  void begin(char c) { separate(); out << c; first_in_compound = true; }
+
+  void end(char c) { out << c; first_in_compound = false; }
+
+  std::ostringstream out;
+  bool first_in_compound;
+};
+
+std::string printed(const matchable& msg)
+{
+  erlang_printer printer;
+
+  if(!visit(msg, printer))
+    throw std::runtime_error("Failed to visit a well-formed message: " + printer.str());
+
+  return printer.str();
+}
+
+void visit_received_message(mailbox_ptr sender, mailbox_ptr receiver)
+{
+  const std::vector<int_> numbers = list_of(int_(1))(int_(1000))(int_(-3));
+  const binary_value_type blob(binary_value_type::value_type(1024, 'x'));
+
+  e_map::value_type associations;
+  associations.push_back(std::make_pair(make_atom("id"), make_int(4711)));
+
+  sender->send("receiver", make_e_tuple(atom("log"), 
+                                        erl::list<int_>(numbers), 
+                                        e_string("text"), 
+                                        binary(blob), 
+                                        e_map(associations),
+                                        make_e_tuple(),
+                                        pid(sender->self())));
+
+  const matchable_ptr msg = receiver->receive();
+  const std::string expected = "{log,[1,1000,-3],\"text\",<<1024 bytes>>,#{id,4711},{},<" + 
+                               sender->self().node_name + "." + 
+                               boost::lexical_cast<std::string>(sender->self().id) + "." + 
+                               boost::lexical_cast<std::string>(sender->self().serial) + ">}";
+
+  check(expected == printed(*msg), "a received message: " + expected);
+}
+
+// Terms that can't be sent through tinch++, encoded by hand.
+void visit_encoded_terms()
+{
+  const unsigned char encoded[] = {
+    108, 0, 0, 0, 2,                      // [
+      70, 64, 4, 0, 0, 0, 0, 0, 0,        //   2.5 (NEW_FLOAT_EXT),
+      110, 1, 0, 1,                       //   1 (SMALL_BIG_EXT)
+    119, 2, 'o', 'k',                     // | ok] (SMALL_ATOM_UTF8_EXT)
+    106};                                 // (not part of the term)
+  const matchable_seq msg(msg_seq(encoded, encoded + sizeof encoded));
+
+  check("[2.5,?110,ok]" == printed(msg), "an improper list of unsupported types");
+
+  const unsigned char truncated[] = {104, 2, 97, 1};
+  erlang_printer printer;
+
+  check(!visit(matchable_seq(msg_seq(truncated, truncated + sizeof truncated)), printer), "a truncated term");
+
+  msg_seq float_ext;
+  msg_seq_out_iter out(float_ext);
+  float_(0.25).serialize(out);
+
+  check("0.25" == printed(matchable_seq(float_ext)), "a float (FLOAT_EXT)");
+}
+
+// {{{...{1}...}}}
+msg_seq nested_tuples(size_t depth)
+{
+  msg_seq encoded;
+
+  for(size_t i = 0; i < depth; ++i) {
+    encoded.push_back(104);
+    encoded.push_back(1);
+  }
+
+  encoded.push_back(97);
+  encoded.push_back(1);
+
+  return encoded;
+}
+
+void visit_deeply_nested_terms()
+{
+  check(printed(matchable_seq(nested_tuples(1000))).size() == 2 * 1000 + 1, "terms nested 1000 levels deep");
+
+  erlang_printer printer;
+
+  check(!visit(matchable_seq(nested_tuples(1000000)), printer), "terms nested too deep");
+}
+
+}
+
+int main()
+{
+  node_ptr my_node = node::create("term_visitor_test@127.0.0.1", "qwerty");
+
+  mailbox_ptr sender = my_node->create_mailbox("sender");
+  mailbox_ptr receiver = my_node->create_mailbox("receiver");
+
+  visit_received_message(sender, receiver);
+
+  visit_encoded_terms();
+
+  visit_deeply_nested_terms();
+}
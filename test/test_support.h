@@ -0,0 +1,88 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef TEST_SUPPORT_H
+#define TEST_SUPPORT_H
+
+// Shared by the test programs. A test program prints each test case it passes 
+// and throws as soon as one fails, which ctest reports as a failed test.
+#include "tinch_pp/epmd_server.h"
+#include "tinch_pp/node.h"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace tinch_pp {
+namespace test {
+
+inline void check(bool success, const std::string& testcase)
+{
+  if(!success)
+    throw std::runtime_error(testcase + ": failed!");
+
+  std::cout << "Passed " << testcase << std::endl;
+}
+
+inline bool is_connected(node_ptr a_node, const std::string& peer)
+{
+  const std::vector<std::string> connected = a_node->connected_nodes();
+
+  return std::find(connected.begin(), connected.end(), peer) != connected.end();
+}
+
+// The nodes of a test register at, and look each other up through, a private name 
+// server instead of EPMD: no EPMD needed and no clashes with other nodes on the host.
+class private_cluster
+{
+public:
+  private_cluster()
+    : name_server(epmd_server::create(0)) {}
+
+  static std::string cookie() { return "abcdef"; }
+
+  port_number_type epmd_port() const { return name_server->port(); }
+
+  epmd_server& server() const { return *name_server; }
+
+  node_ptr create_node(const std::string& name) const
+  {
+    return node::create(name, cookie(), epmd_port());
+  }
+
+  // Created and published, i.e. accepting connections at the given port.
+  node_ptr start_node(const std::string& name, port_number_type port) const
+  {
+    const node_ptr started = create_node(name);
+    started->publish_port(port);
+
+    return started;
+  }
+
+private:
+  epmd_server_ptr name_server;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,65 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef EPMD_SERVER_H
+#define EPMD_SERVER_H
+
+#include "impl/types.h"
+
+#include <boost/shared_ptr.hpp>
+#include <vector>
+#include <string>
+
+namespace tinch_pp {
+
+class epmd_server;
+typedef boost::shared_ptr<epmd_server> epmd_server_ptr;
+
+/// An EPMD (Erlang Port Mapper Daemon) compatible name server, running within your process.
+/// It serves ALIVE2_REQ, PORT_PLEASE2_REQ and NAMES_REQ, which is what nodes need in order 
+/// to find each other. There are two ways to use it:
+/// 1) As the host's EPMD, at port 4369, for hosts without an Erlang installation.
+///    Erlang nodes on the host use it just like the real EPMD.
+/// 2) As a private registry for tinch++ nodes, at another port. Create the nodes with 
+///    that port (see node::create). Tests and benchmarks then run without any daemon.
+/// The name server serves the nodes until it's destroyed.
+class epmd_server
+{
+public:
+  /// Starts a name server listening at the given port.
+  /// A port of zero picks any free port (see port() below).
+  /// Throws tinch_pp_exception in case the port is in use.
+  static epmd_server_ptr create(port_number_type port = 4369);
+
+  virtual ~epmd_server();
+
+  /// The port this name server listens at.
+  virtual port_number_type port() const = 0;
+
+  typedef std::pair<std::string /* node name, without host */, port_number_type> registered_node_type;
+
+  /// Returns the currently registered nodes and their ports.
+  virtual std::vector<registered_node_type> registered_nodes() const = 0;
+};
+
+}
+
+#endif
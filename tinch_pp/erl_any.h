@@ -24,8 +24,6 @@
 
 #include "erl_object.h"
 #include "matchable.h"
-#include <boost/function.hpp>
-#include <map>
 
 namespace tinch_pp {
 namespace erl {
@@ -56,28 +54,35 @@ public:
 
    explicit any(matchable_ptr* to_assign);
 
+   /// A copy assigns the same matchable as the original (or its own placeholder).
+   any(const any& other);
+
+   any& operator=(const any& other);
+
    virtual bool match(msg_seq_iter& f, const msg_seq_iter& l) const;
 
+   // A pattern only; nothing is ever encoded.
+   virtual size_t encoded_size() const { return 0; }
+
    /// No, this shouldn't be publicly exposed; it's a design flaw.
    /// The function is used internally in the lib to feed data to the matchable in case 
-   /// the client requested it.
-   bool save_matched_bytes(const msg_seq& raw_msg_part) const;
+   /// the client requested it. The bytes [first..last) have to follow the ones 
+   /// captured so far; they are recorded as a position in the matched message, not copied.
+   bool save_matched_bytes(const msg_seq_iter& first, const msg_seq_iter& last) const;
 
 private:
    // Should we be able to serialize an erl_any? Possible, but does it make sense?
    virtual void serialize(msg_seq_out_iter& out) const {} // no implementation!
 
-   typedef boost::function<bool (msg_seq_iter& f, const msg_seq_iter& l, const any&)> term_matcher_type;
-   typedef int term_id_type;
-   typedef std::map<term_id_type, term_matcher_type> dynamic_element_matcher_type;
-
-   static const dynamic_element_matcher_type dynamic_element_matcher;
-
    static bool match_dynamically(msg_seq_iter& f, const msg_seq_iter& l, const any& instance);
 
    matchable_ptr placeholder;
    matchable_ptr* to_assign;
-   mutable msg_seq matched_raw_bytes;
+   // The capture of the outermost match: its start and the number of bytes matched so far.
+   mutable msg_seq_iter capture_start;
+   mutable size_t captured_length;
+   // Set while the elements of a matched term are matched through this instance.
+   mutable bool capturing;
 };
 
 }
@@ -26,18 +26,35 @@
 #include "impl/string_matcher.h"
 #include "erl_object.h"
 #include <boost/bind.hpp>
-#include <list>
+#include <vector>
 #include <algorithm>
 #include <cassert>
 
 namespace tinch_pp {
+namespace detail {
+
+// A list holds its elements either by value or through object_ptr.
+inline size_t encoded_size_of(const erl::object& element)
+{
+  return element.encoded_size();
+}
+
+inline size_t encoded_size_of(const erl::object_ptr& element)
+{
+  return element->encoded_size();
+}
+
+}
+
 namespace erl {
 
+/// The elements are stored contiguously (std::vector). For compatibility, 
+/// a list may also be created from, or assigned to, other sequences (e.g. std::list).
 template<typename T>
 class list : public object
 {
 public:
-  typedef std::list<T> list_type;
+  typedef std::vector<T> list_type;
   typedef list<T> own_type;
 
   list(const list_type& contained)
@@ -49,7 +66,22 @@ public:
 
   list(list_type* contained)
     : to_assign(contained),
-      match_fn(boost::bind(&own_type::assign_matched, ::_1, ::_2, ::_3, contained))
+      match_fn(boost::bind(&own_type::assign_matched<list_type>, ::_1, ::_2, ::_3, contained))
+  {
+  }
+
+  template<typename Sequence>
+  list(const Sequence& contained)
+    : val(contained.begin(), contained.end()),
+      to_assign(0),
+      match_fn(boost::bind(&own_type::match_value, ::_1, ::_2, ::_3))
+  {
+  }
+
+  template<typename Sequence>
+  list(Sequence* contained)
+    : to_assign(0),
+      match_fn(boost::bind(&own_type::assign_matched<Sequence>, ::_1, ::_2, ::_3, contained))
   {
   }
 
@@ -64,6 +96,17 @@ public:
     karma::generate(out, karma::byte_(tinch_pp::type_tag::nil_ext));
   }
 
+  virtual size_t encoded_size() const
+  {
+    // The list head, the elements and the terminating nil.
+    size_t size = 5 + 1;
+
+    for(typename list_type::const_iterator a = val.begin(); a != val.end(); ++a)
+      size += tinch_pp::detail::encoded_size_of(*a);
+
+    return size;
+  }
+
   virtual bool match(msg_seq_iter& f, const msg_seq_iter& l) const
   {
     return match_fn(this, f, l);
@@ -77,13 +120,14 @@ public:
 private:
   static bool match_value(const own_type* self, msg_seq_iter& f, const msg_seq_iter& l)
   {
-    return matcher::match(self->value(), f, l);
+    return matcher::match(self->val, f, l);
   }
 
-  static bool assign_matched(const own_type*, msg_seq_iter& f, const msg_seq_iter& l, list_type* dest)
+  template<typename Sequence>
+  static bool assign_matched(const own_type*, msg_seq_iter& f, const msg_seq_iter& l, Sequence* dest)
   {
     assert(0 != dest);
-    return matcher::assign_match(dest, f, l);
+    return detail::list_matcher<Sequence>::assign_match(dest, f, l);
   }
 
 private:
@@ -100,7 +144,7 @@ template<>
 class list<erl::int_> : public object
 {
 public:
-  typedef std::list<erl::int_> list_type;
+  typedef std::vector<erl::int_> list_type;
   typedef list<erl::int_> own_type;
 
   list(const list_type& contained)
@@ -112,7 +156,22 @@ public:
 
   list(list_type* contained)
     : to_assign(contained),
-      match_fn(boost::bind(&own_type::assign_matched, ::_1, ::_2, ::_3, contained))
+      match_fn(boost::bind(&own_type::assign_matched<list_type>, ::_1, ::_2, ::_3, contained))
+  {
+  }
+
+  template<typename Sequence>
+  list(const Sequence& contained)
+    : val(contained.begin(), contained.end()),
+      to_assign(0),
+      match_fn(boost::bind(&own_type::match_value, ::_1, ::_2, ::_3))
+  {
+  }
+
+  template<typename Sequence>
+  list(Sequence* contained)
+    : to_assign(0),
+      match_fn(boost::bind(&own_type::assign_matched<Sequence>, ::_1, ::_2, ::_3, contained))
   {
   }
 
@@ -127,6 +186,17 @@ public:
     karma::generate(out, karma::byte_(tinch_pp::type_tag::nil_ext));
   }
 
+  virtual size_t encoded_size() const
+  {
+    // The list head, the elements and the terminating nil.
+    size_t size = 5 + 1;
+
+    for(list_type::const_iterator a = val.begin(); a != val.end(); ++a)
+      size += a->encoded_size();
+
+    return size;
+  }
+
   virtual bool match(msg_seq_iter& f, const msg_seq_iter& l) const
   {
     return match_fn(this, f, l);
@@ -144,17 +214,18 @@ private:
     // the values are packed into a string.
     const bool is_packed_as_string = (type_tag::string_ext == *f);
 
-    return is_packed_as_string ? matcher_s::match(self->value(), f, l) : matcher_l::match(self->value(), f, l);
+    return is_packed_as_string ? matcher_s::match(self->val, f, l) : matcher_l::match(self->val, f, l);
   }
 
-  static bool assign_matched(const own_type*, msg_seq_iter& f, const msg_seq_iter& l, list_type* dest)
+  template<typename Sequence>
+  static bool assign_matched(const own_type*, msg_seq_iter& f, const msg_seq_iter& l, Sequence* dest)
   {
     // Erlang has an optimization for sending lists of small values (<=255), where 
     // the values are packed into a string.
     const bool is_packed_as_string = (type_tag::string_ext == *f);
 
     assert(0 != dest);
-    return is_packed_as_string ? matcher_s::assign_match(dest, f, l) : matcher_l::assign_match(dest, f, l);
+    return is_packed_as_string ? matcher_s::assign_match(dest, f, l) : detail::list_matcher<Sequence>::assign_match(dest, f, l);
   }
 
 private:
@@ -170,7 +241,7 @@ private:
 };
 
 template<typename T>
-tinch_pp::erl::list<typename T::value_type> make_list(const T& t) // T is a std::list
+tinch_pp::erl::list<typename T::value_type> make_list(const T& t) // T is a std::vector or std::list
 {
   tinch_pp::erl::list<typename T::value_type> wrapper(t);
 
@@ -178,7 +249,7 @@ tinch_pp::erl::list<typename T::value_type> make_list(const T& t) // T is a std:
 }
 
 template<typename T>
-tinch_pp::erl::list<typename T::value_type> make_list(T* t) // T is a std::list
+tinch_pp::erl::list<typename T::value_type> make_list(T* t) // T is a std::vector or std::list
 {
   tinch_pp::erl::list<typename T::value_type> wrapper(t);
 
@@ -0,0 +1,163 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef ERL_MAP_H
+#define ERL_MAP_H
+
+#include "erlang_value_types.h"
+#include "matchable.h"
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <vector>
+#include <utility>
+
+namespace tinch_pp {
+namespace erl {
+
+class any;
+class map_view;
+
+namespace detail {
+
+// The location of each association in an encoded map (offsets from the start of the map).
+struct map_association
+{
+  size_t key;
+  size_t value;
+  size_t end;
+};
+
+typedef std::vector<map_association> map_index_type;
+
+// Built on the first access to a map_view and shared by its copies (they view 
+// the same map). Concurrent readers race for the build => it's locked.
+struct lazy_map_index
+{
+  lazy_map_index() : built(false) {}
+
+  boost::mutex build_mutex;
+  bool built;
+  map_index_type associations;
+};
+
+}
+
+/// An Erlang map (#{Key => Value}).
+/// The keys and values may be of different types. Thus, they're heap allocated 
+/// (see type_makers.h) in order to provide polymorphic behaviour.
+///
+/// When used in a pattern, an e_map behaves like a map pattern in Erlang: it 
+/// succeeds as long as the received map contains the given keys and their 
+/// values match. Other keys in the received map are simply ignored.
+///
+/// Example:
+///
+/// boost::int32_t id = 0;
+/// e_map::value_type wanted;
+/// wanted.push_back(std::make_pair(make_atom("id"), object_ptr(new int_(&id))));
+///
+/// msg->match(make_e_tuple(atom("reply"), e_map(wanted)))
+///
+/// Succeeds for {reply, #{id => 42, name => "..."}} and assigns 42 to id.
+class e_map : public object
+{
+public:
+  typedef std::pair<object_ptr, object_ptr> association_type;
+  typedef std::vector<association_type> value_type;
+
+  explicit e_map(const value_type& associations);
+
+  /// Used to assign a received map to a map_view during pattern matching.
+  explicit e_map(map_view* to_assign);
+
+  explicit e_map(const any& match_any);
+
+  virtual void serialize(msg_seq_out_iter& out) const;
+
+  virtual size_t encoded_size() const;
+
+  virtual bool match(msg_seq_iter& f, const msg_seq_iter& l) const;
+
+  value_type value() const { return val; }
+
+private:
+  value_type val;
+  map_view* to_assign;
+
+  match_fn_type match_fn;
+};
+
+/// A map_view gives access to a received map.
+/// The map is kept in its encoded form and the keys and values are located 
+/// (not decoded) the first time they're accessed. Thus, looking up a few keys 
+/// in a large map only decodes the values actually asked for.
+///
+/// Example:
+///
+/// map_view reply;
+/// std::string name;
+///
+/// if(msg->match(e_map(&reply)) && reply.match(atom("name"), e_string(&name)))
+///   ...
+class map_view
+{
+public:
+  map_view();
+
+  /// The number of associations in the map.
+  size_t size() const;
+
+  /// Returns true if there's a key matching the given pattern.
+  bool has_key(const object& key) const;
+
+  /// Matches the value associated with the given key against the given pattern.
+  /// Returns false if the key isn't present or the value doesn't match.
+  bool match(const object& key, const object& value) const;
+
+  /// Returns the value associated with the given key as a matchable, intended 
+  /// for further matching. An empty pointer is returned if the key isn't present.
+  matchable_ptr find(const object& key) const;
+
+  /// Replaces the viewed map with the given encoded map (MAP_EXT, without version).
+  /// Invoked when an e_map pattern binds the view.
+  void assign(const msg_seq& encoded_map);
+
+  /// As above, but refers to the encoded map of the given length at the given 
+  /// offset into a shared frame (e.g. the received message) instead of copying it.
+  void assign(const frame_ptr& frame, size_t offset, size_t length);
+
+private:
+  const detail::map_association* locate(const object& key) const;
+
+  msg_seq_iter first() const { return frame->begin() + offset; }
+
+  msg_seq_iter last() const { return first() + length; }
+
+  frame_ptr frame;
+  size_t offset;
+  size_t length;
+  boost::shared_ptr<detail::lazy_map_index> index;
+};
+
+}
+}
+
+#endif
@@ -24,10 +24,28 @@
 
 #include "impl/types.h"
 #include <boost/shared_ptr.hpp>
+#include <string>
 
 namespace tinch_pp {
 namespace erl {
 
+/// What's known about the terms a pattern may match before matching it: their 
+/// type tag, their arity and a literal atom (the atom itself or the first element 
+/// of a tuple). Used to dispatch a message among several patterns without trying 
+/// each one of them (see receive_clauses).
+struct pattern_key
+{
+  enum { unknown = -1 };
+
+  pattern_key() 
+    : tag(unknown), arity(unknown), has_atom(false) {}
+
+  int tag;
+  int arity;
+  bool has_atom;
+  std::string atom;
+};
+
 class object
 {
 public:
@@ -38,10 +56,28 @@ public:
   /// part of a message send, i.e. not intended for clients.
   virtual void serialize(msg_seq_out_iter& out) const = 0;
 
+  /// The exact number of bytes written by serialize. Used to allocate the 
+  /// buffer of an outgoing message once, before serializing into it.
+  /// The default serializes the object to find out; the types of the 
+  /// library calculate it instead.
+  virtual size_t encoded_size() const
+  {
+    msg_seq encoded;
+    msg_seq_out_iter out(encoded);
+
+    serialize(out);
+
+    return encoded.size();
+  }
+
   /// Attempts to match the given sequence [f..l)
   /// This function is typically used by the receive-mechanism and 
   /// not intended for clients.
   virtual bool match(msg_seq_iter& f, const msg_seq_iter& l) const = 0;
+
+  /// Describes the terms this object may match. By default, nothing is known 
+  /// (e.g. erl::any, which matches every term).
+  virtual pattern_key key() const { return pattern_key(); }
 };
 
 typedef boost::shared_ptr<object> object_ptr;
@@ -50,6 +50,8 @@ public:
 
   virtual void serialize(msg_seq_out_iter& out) const;
 
+  virtual size_t encoded_size() const;
+
   virtual bool match(msg_seq_iter& f, const msg_seq_iter& l) const;
 
   std::string value() const { return val; }
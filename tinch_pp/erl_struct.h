@@ -0,0 +1,384 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef ERL_STRUCT_H
+#define ERL_STRUCT_H
+
+#include "erl_object.h"
+#include "erlang_value_types.h"
+#include "impl/term_decoder.h"
+#include "impl/term_encoder.h"
+#include <boost/fusion/include/at_c.hpp>
+#include <boost/fusion/include/size.hpp>
+#include <boost/fusion/include/value_at.hpp>
+#include <boost/fusion/include/is_sequence.hpp>
+#include <boost/utility/enable_if.hpp>
+#include <boost/cstdint.hpp>
+#include <vector>
+#include <string>
+
+namespace tinch_pp {
+
+/// An atom as a member of a struct sent or received through erl::e_struct 
+/// (a std::string member is a string).
+struct e_atom
+{
+  e_atom() {}
+
+  explicit e_atom(const std::string& a_name)
+    : name(a_name) {}
+
+  std::string name;
+};
+
+namespace detail {
+
+// The encoding of each supported member type. A member is decoded straight 
+// into the struct; no intermediate objects are built.
+template<typename T, typename Enable = void>
+struct field_codec;
+
+template<>
+struct field_codec<boost::int32_t>
+{
+  static void encode(msg_seq_out_iter& out, boost::int32_t val) { encoder::encode_integer(out, val); }
+
+  static size_t size(boost::int32_t val) { return encoder::integer_size(val); }
+
+  static bool decode(msg_seq_iter& f, const msg_seq_iter& l, boost::int32_t& val) { return decoder::decode_integer(f, l, val); }
+};
+
+template<>
+struct field_codec<double>
+{
+  static void encode(msg_seq_out_iter& out, double val) { encoder::encode_float(out, val); }
+
+  static size_t size(double) { return encoder::float_size(); }
+
+  static bool decode(msg_seq_iter& f, const msg_seq_iter& l, double& val) 
+  { 
+    return decoder::decode_float(f, l, val) || decoder::decode_new_float(f, l, val); 
+  }
+};
+
+template<>
+struct field_codec<e_atom>
+{
+  static void encode(msg_seq_out_iter& out, const e_atom& val) { encoder::encode_atom(out, val.name); }
+
+  static size_t size(const e_atom& val) { return encoder::atom_size(val.name); }
+
+  static bool decode(msg_seq_iter& f, const msg_seq_iter& l, e_atom& val) { return decoder::decode_atom(f, l, val.name); }
+};
+
+template<>
+struct field_codec<std::string>
+{
+  static void encode(msg_seq_out_iter& out, const std::string& val) { encoder::encode_string(out, val); }
+
+  static size_t size(const std::string& val) { return encoder::string_size(val); }
+
+  // Erlang encodes the empty string as the empty list.
+  static bool decode(msg_seq_iter& f, const msg_seq_iter& l, std::string& val)
+  {
+    size_t length = 0;
+
+    if(decoder::decode_nil(f, l)) {
+      val.clear();
+      return true;
+    }
+
+    if(!decoder::decode_string_head(f, l, length) || (decoder::available(f, l) < length))
+      return false;
+
+    val.assign(f, f + length);
+    f += length;
+
+    return true;
+  }
+};
+
+template<>
+struct field_codec<binary_value_type>
+{
+  static void encode(msg_seq_out_iter& out, const binary_value_type& val) { encoder::encode_binary(out, val); }
+
+  static size_t size(const binary_value_type& val) { return encoder::binary_size(val); }
+
+  static bool decode(msg_seq_iter& f, const msg_seq_iter& l, binary_value_type& val)
+  {
+    size_t length = 0;
+    int padding_bits = 0;
+    msg_seq_iter i = f;
+
+    if(!decoder::decode_binary_head(i, l, length, padding_bits) || (decoder::available(i, l) < length))
+      return false;
+
+    val.padding_bits = padding_bits;
+    val.value.assign(i, i + length);
+    f = i + length;
+
+    return true;
+  }
+};
+
+template<>
+struct field_codec<e_pid>
+{
+  static void encode(msg_seq_out_iter& out, const e_pid& val) { encoder::encode_pid(out, val); }
+
+  static size_t size(const e_pid& val) { return encoder::pid_size(val); }
+
+  static bool decode(msg_seq_iter& f, const msg_seq_iter& l, e_pid& val) { return decoder::decode_pid(f, l, val); }
+};
+
+template<>
+struct field_codec<new_reference_type>
+{
+  static void encode(msg_seq_out_iter& out, const new_reference_type& val) { erl::ref(val).serialize(out); }
+
+  static size_t size(const new_reference_type& val) { return erl::ref(val).encoded_size(); }
+
+  static bool decode(msg_seq_iter& f, const msg_seq_iter& l, new_reference_type& val) { return erl::ref(&val).match(f, l); }
+};
+
+// A vector is a list of its elements.
+template<typename T>
+struct field_codec<std::vector<T> >
+{
+  static void encode(msg_seq_out_iter& out, const std::vector<T>& val)
+  {
+    if(!val.empty()) {
+      encoder::encode_list_head(out, val.size());
+
+      for(typename std::vector<T>::const_iterator i = val.begin(); i != val.end(); ++i)
+        field_codec<T>::encode(out, *i);
+    }
+
+    encoder::encode_nil(out);
+  }
+
+  static size_t size(const std::vector<T>& val)
+  {
+    size_t size = val.empty() ? 0 : 5;
+
+    for(typename std::vector<T>::const_iterator i = val.begin(); i != val.end(); ++i)
+      size += field_codec<T>::size(*i);
+
+    return size + 1;
+  }
+
+  static bool decode(msg_seq_iter& f, const msg_seq_iter& l, std::vector<T>& val)
+  {
+    size_t length = 0;
+
+    val.clear();
+
+    if(decoder::decode_nil(f, l))
+      return true;
+
+    // Erlang sends a list of small integers (0-255) as a string.
+    if(decoder::decode_string_head(f, l, length))
+      return decode_small_integers(f, l, length, val);
+
+    // Each element takes at least a byte; a larger length is corrupt.
+    if(!decoder::decode_list_head(f, l, length) || (decoder::available(f, l) < length))
+      return false;
+
+    val.resize(length);
+
+    for(size_t i = 0; i < length; ++i) {
+      if(!field_codec<T>::decode(f, l, val[i]))
+        return false;
+    }
+
+    return decoder::decode_nil(f, l);
+  }
+
+private:
+  static bool decode_small_integers(msg_seq_iter& f, const msg_seq_iter& l, size_t length, std::vector<boost::int32_t>& val)
+  {
+    if(decoder::available(f, l) < length)
+      return false;
+
+    for(size_t i = 0; i < length; ++i)
+      val.push_back(static_cast<boost::uint8_t>(*f++));
+
+    return true;
+  }
+
+  template<typename Other>
+  static bool decode_small_integers(msg_seq_iter&, const msg_seq_iter&, size_t, std::vector<Other>&)
+  {
+    return false;
+  }
+};
+
+// The members of an adapted struct, from the N:th one and on.
+template<typename Struct, int N = 0, int Size = boost::fusion::result_of::size<Struct>::value>
+struct struct_fields
+{
+  typedef typename boost::fusion::result_of::value_at_c<Struct, N>::type field_type;
+  typedef struct_fields<Struct, N + 1, Size> rest;
+
+  static void encode(msg_seq_out_iter& out, const Struct& s)
+  {
+    field_codec<field_type>::encode(out, boost::fusion::at_c<N>(s));
+    rest::encode(out, s);
+  }
+
+  static size_t size(const Struct& s)
+  {
+    return field_codec<field_type>::size(boost::fusion::at_c<N>(s)) + rest::size(s);
+  }
+
+  static bool decode(msg_seq_iter& f, const msg_seq_iter& l, Struct& s)
+  {
+    return field_codec<field_type>::decode(f, l, boost::fusion::at_c<N>(s)) && rest::decode(f, l, s);
+  }
+};
+
+template<typename Struct, int Size>
+struct struct_fields<Struct, Size, Size>
+{
+  static void encode(msg_seq_out_iter&, const Struct&) {}
+
+  static size_t size(const Struct&) { return 0; }
+
+  static bool decode(msg_seq_iter&, const msg_seq_iter&, Struct&) { return true; }
+};
+
+// Any other struct adapted through BOOST_FUSION_ADAPT_STRUCT is a (nested) tuple.
+template<typename Struct>
+struct field_codec<Struct, typename boost::enable_if<boost::fusion::traits::is_sequence<Struct> >::type>
+{
+  static const size_t arity = boost::fusion::result_of::size<Struct>::value;
+
+  static void encode(msg_seq_out_iter& out, const Struct& val)
+  {
+    encoder::encode_small_tuple_head(out, arity);
+    struct_fields<Struct>::encode(out, val);
+  }
+
+  static size_t size(const Struct& val)
+  {
+    return 2 + struct_fields<Struct>::size(val);
+  }
+
+  static bool decode(msg_seq_iter& f, const msg_seq_iter& l, Struct& val)
+  {
+    size_t parsed_arity = 0;
+
+    return decoder::decode_small_tuple_head(f, l, parsed_arity) && (arity == parsed_arity) &&
+           struct_fields<Struct>::decode(f, l, val);
+  }
+};
+
+}
+
+namespace erl {
+
+/// Sends and receives a struct of your own as a tuple of its members. 
+/// Adapt the struct through BOOST_FUSION_ADAPT_STRUCT, just as tinch++ does 
+/// with its own types, and use e_struct instead of an e_tuple with one 
+/// pattern per member:
+///
+/// struct order { e_atom side; boost::int32_t quantity; std::string item; };
+///
+/// BOOST_FUSION_ADAPT_STRUCT(order, (tinch_pp::e_atom, side)(boost::int32_t, quantity)(std::string, item))
+///
+/// mbox->send(to, make_e_struct(an_order));   // {buy, 100, "bananas"}
+///
+/// order received;
+/// msg->match(make_e_struct(&received));
+///
+/// The supported members are boost::int32_t, double, e_atom, std::string, 
+/// binary_value_type, e_pid, new_reference_type, std::vector (a list) and 
+/// other adapted structs (nested tuples). The members are encoded, and decoded 
+/// straight into the struct, in a single pass. On a failed match, the struct 
+/// may have been partially assigned. A double is matched in either of the 
+/// float formats (FLOAT_EXT and NEW_FLOAT_EXT).
+template<typename Struct>
+class e_struct : public object
+{
+public:
+  explicit e_struct(const Struct& a_val)
+    : val(a_val),
+      to_assign(0) {}
+
+  explicit e_struct(Struct* a_to_assign)
+    : val(),
+      to_assign(a_to_assign) {}
+
+  virtual void serialize(msg_seq_out_iter& out) const
+  {
+    tinch_pp::detail::field_codec<Struct>::encode(out, val);
+  }
+
+  virtual size_t encoded_size() const
+  {
+    return tinch_pp::detail::field_codec<Struct>::size(val);
+  }
+
+  // Matching a value is done on its encoding.
+  virtual bool match(msg_seq_iter& f, const msg_seq_iter& l) const
+  {
+    if(to_assign)
+      return tinch_pp::detail::field_codec<Struct>::decode(f, l, *to_assign);
+
+    msg_seq encoded;
+    msg_seq_out_iter out(encoded);
+    serialize(out);
+
+    return decoder::match_encoded(f, l, std::string(encoded.begin(), encoded.end()));
+  }
+
+  virtual pattern_key key() const
+  {
+    pattern_key k;
+
+    k.tag = type_tag::small_tuple;
+    k.arity = static_cast<int>(tinch_pp::detail::field_codec<Struct>::arity);
+
+    return k;
+  }
+
+private:
+  Struct val;
+  Struct* to_assign;
+};
+
+template<typename Struct>
+e_struct<Struct> make_e_struct(const Struct& val)
+{
+  return e_struct<Struct>(val);
+}
+
+template<typename Struct>
+e_struct<Struct> make_e_struct(Struct* to_assign)
+{
+  return e_struct<Struct>(to_assign);
+}
+
+}
+}
+
+#endif
@@ -24,14 +24,68 @@
 
 #include "erl_object.h"
 #include "impl/ext_term_grammar.h"
+#include "impl/term_decoder.h"
 #include <boost/fusion/tuple/tuple.hpp>
 #include <boost/fusion/algorithm/iteration/for_each.hpp>
 #include <boost/fusion/include/for_each.hpp>
 #include <boost/fusion/algorithm/query/all.hpp>
 #include <boost/fusion/include/all.hpp>
+#include <boost/fusion/sequence/intrinsic/at_c.hpp>
 #include <boost/bind.hpp>
 
 namespace tinch_pp {
+namespace detail {
+
+template<typename Tuple, bool empty = (0 == boost::fusion::tuple_size<Tuple>::value)>
+struct first_element_key
+{
+  static erl::pattern_key get(const Tuple& t) { return boost::fusion::at_c<0>(t).key(); }
+};
+
+template<typename Tuple>
+struct first_element_key<Tuple, true>
+{
+  static erl::pattern_key get(const Tuple&) { return erl::pattern_key(); }
+};
+
+// The elements of a tuple are stored by value => their exact types are known 
+// and we call their match directly (qualified, i.e. not virtually), which 
+// allows the compiler to inline the matching of the whole tuple.
+class match_element
+{
+public:
+  match_element(msg_seq_iter& a_f, const msg_seq_iter& a_l)
+    : f(a_f), l(a_l) {}
+
+  template<typename Element>
+  bool operator()(const Element& e) const
+  {
+    return e.Element::match(f, l);
+  }
+
+private:
+  msg_seq_iter& f;
+  const msg_seq_iter& l;
+};
+
+class add_encoded_size
+{
+public:
+  explicit add_encoded_size(size_t& a_size)
+    : size(a_size) {}
+
+  template<typename Element>
+  void operator()(const Element& e) const
+  {
+    size += e.Element::encoded_size();
+  }
+
+private:
+  size_t& size;
+};
+
+}
+
 namespace erl {
 
 /// A wrapper around boost::fusion::tuple (basically a TR1 representation). 
@@ -65,12 +119,32 @@ public:
     using namespace boost;
 
     size_t parsed_length = 0;
-    small_tuple_head_ext tuple_head_p;
 
-    const bool success = qi::parse(f, l, tuple_head_p, parsed_length);
+    const bool success = decoder::decode_small_tuple_head(f, l, parsed_length);
     const bool tuple_matched = success && (tuple_length == parsed_length);
 
-    return tuple_matched && fusion::all(contained, bind(&object::match, ::_1, boost::ref(f), cref(l)));
+    return tuple_matched && fusion::all(contained, detail::match_element(f, l));
+  }
+
+  virtual size_t encoded_size() const
+  {
+    size_t size = 2;
+
+    boost::fusion::for_each(contained, detail::add_encoded_size(size));
+
+    return size;
+  }
+
+  // Erlang messages are typically tagged by an atom as their first element.
+  virtual pattern_key key() const
+  {
+    pattern_key k = detail::first_element_key<Tuple>::get(contained);
+
+    k.has_atom = k.has_atom && (type_tag::atom_ext == k.tag);
+    k.tag = type_tag::small_tuple;
+    k.arity = static_cast<int>(tuple_length);
+
+    return k;
   }
 
 private:
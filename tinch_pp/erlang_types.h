@@ -30,6 +30,7 @@
 #include "erl_list.h"
 #include "erl_any.h"
 #include "erl_string.h"
+#include "erl_map.h"
 #include "type_makers.h"
 
 #endif
@@ -23,6 +23,7 @@
 #define ERLANG_VALUE_TYPES_H
 
 #include "erl_object.h"
+#include "impl/term_decoder.h"
 #include <boost/function.hpp>
 
 namespace tinch_pp {
@@ -33,6 +34,8 @@ class any;
 // As an object is used in a match, it's either a value-match or a type-match.
 // In the latter case, we want to assign the matched value. That difference 
 // in behaviour is encapsulated by a match_fn.
+// The most frequently matched types (int_, atom, pid) are matched inline 
+// instead; that allows an e_tuple to match its elements without any indirection.
 typedef boost::function<bool (msg_seq_iter&, const msg_seq_iter&)> match_fn_type;
 
 class int_ : public object
@@ -48,7 +51,23 @@ public:
 
   virtual void serialize(msg_seq_out_iter& out) const;
 
-  virtual bool match(msg_seq_iter& f, const msg_seq_iter& l) const;
+  virtual size_t encoded_size() const;
+
+  virtual bool match(msg_seq_iter& f, const msg_seq_iter& l) const
+  {
+    boost::int32_t res = 0;
+
+    if(match_any)
+      return match_as_any(f, l);
+
+    if(!decoder::decode_integer(f, l, res))
+      return false;
+
+    if(to_assign)
+      *to_assign = res;
+
+    return to_assign || (val == res);
+  }
 
   // Special case: Erlang packs a list of small values (<= 255) into a string-sequence.
   // Those values can only be matched by int_.
@@ -57,10 +76,11 @@ public:
   boost::int32_t value() const { return val; }
 
 private:
+  bool match_as_any(msg_seq_iter& f, const msg_seq_iter& l) const;
+
   boost::int32_t val;
   boost::int32_t* to_assign;
-
-  match_fn_type match_fn;
+  const any* match_any;
 };
 
 class pid : public object
@@ -77,15 +97,29 @@ public:
 
   virtual void serialize(msg_seq_out_iter& out) const;
 
-  virtual bool match(msg_seq_iter& f, const msg_seq_iter& l) const;
+  virtual size_t encoded_size() const;
+
+  virtual bool match(msg_seq_iter& f, const msg_seq_iter& l) const
+  {
+    if(match_any)
+      return match_as_any(f, l);
+
+    if(e_pido_assign)
+      return decoder::decode_pid(f, l, *e_pido_assign);
+
+    e_pid res;
+
+    return decoder::decode_pid(f, l, res) && (val == res);
+  }
 
   e_pid value() const { return val; }
 
 private:
+  bool match_as_any(msg_seq_iter& f, const msg_seq_iter& l) const;
+
   e_pid val;
   e_pid* e_pido_assign;
-
-  match_fn_type match_fn;
+  const any* match_any;
 };
 
 class float_ : public object
@@ -102,6 +136,8 @@ public:
 
   virtual void serialize(msg_seq_out_iter& out) const;
 
+  virtual size_t encoded_size() const;
+
   virtual bool match(msg_seq_iter& f, const msg_seq_iter& l) const;
 
   double value() const { return val; }
@@ -126,15 +162,31 @@ public:
 
   virtual void serialize(msg_seq_out_iter& out) const;
 
-  virtual bool match(msg_seq_iter& f, const msg_seq_iter& l) const;
+  virtual size_t encoded_size() const;
+
+  virtual bool match(msg_seq_iter& f, const msg_seq_iter& l) const
+  {
+    if(match_any)
+      return match_as_any(f, l);
+
+    if(to_assign)
+      return decoder::decode_atom(f, l, *to_assign);
+
+    // A literal is compared with its encoding (tag, length and name) in one go.
+    return decoder::match_encoded(f, l, encoded);
+  }
+
+  virtual pattern_key key() const;
 
   std::string value() const { return val; }
 
 private:
+  bool match_as_any(msg_seq_iter& f, const msg_seq_iter& l) const;
+
   std::string val;
+  std::string encoded;
   std::string* to_assign;
-
-  match_fn_type match_fn;
+  const any* match_any;
 };
 
 /// Encode a reference object (an object generated with make_ref/0).
@@ -152,6 +204,8 @@ public:
 
   virtual void serialize(msg_seq_out_iter& out) const;
 
+  virtual size_t encoded_size() const;
+
   virtual bool match(msg_seq_iter& f, const msg_seq_iter& l) const;
 
   new_reference_type value() const { return val; }
@@ -173,10 +227,16 @@ public:
 
   explicit binary(binary_value_type* to_assign);
 
+  /// Binds a view of the matched binary without copying its data; the view 
+  /// refers to the received message (see binary_view).
+  explicit binary(binary_view* to_assign);
+
   explicit binary(const any& match_any);
 
   virtual void serialize(msg_seq_out_iter& out) const;
 
+  virtual size_t encoded_size() const;
+
   virtual bool match(msg_seq_iter& f, const msg_seq_iter& l) const;
 
   binary_value_type value() const { return val; }
@@ -42,6 +42,8 @@ private:
   std::string reason;
 };
 
+/// Raised as an operation is requested through a failed connection, i.e. a node that 
+/// couldn't be reached.
 class connection_io_error : public tinch_pp_exception
 {
 public:
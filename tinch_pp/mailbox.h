@@ -88,10 +88,17 @@ public:
   /// Link to a remote mailbox or Erlang process. 
   /// If the remote process exits, a receive on this mailbox will throw a tinch_pp::link_broken exception. 
   /// Similarly, if this mailbox is closed, the linked process will receive an Erlang exit signal.
+  /// A link to a process on a node that can't be reached breaks with reason noconnection.
   virtual void link(const e_pid& e_pido_link) = 0;
   
   /// Remove a link to a remote mailbox or Erlang process.
   virtual void unlink(const e_pid& e_pido_unlink) = 0;
+
+  /// Subscribe to the status of the connections to other nodes (as net_kernel:monitor_nodes/1).
+  /// As a connection is lost, this mailbox receives {nodedown, Node}; as a node 
+  /// gets connected (e.g. reconnected in the background, see node::set_reconnect_backoff), 
+  /// it receives {nodeup, Node}. Node is an atom with the full node name.
+  virtual void monitor_nodes(bool on) = 0;
 };
 
 }
@@ -0,0 +1,122 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef MESSAGE_TEMPLATE_H
+#define MESSAGE_TEMPLATE_H
+
+#include "erl_object.h"
+#include "impl/types.h"
+#include <boost/array.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/preprocessor/arithmetic/inc.hpp>
+#include <boost/preprocessor/repetition/enum_params.hpp>
+#include <boost/preprocessor/repetition/repeat.hpp>
+#include <boost/preprocessor/repetition/repeat_from_to.hpp>
+#include <vector>
+
+namespace tinch_pp {
+namespace erl {
+
+/// Marks a variable part of a message_template (see below). 
+/// A hole has no encoding of its own; it's filled in on each send.
+class hole : public object
+{
+public:
+  virtual void serialize(msg_seq_out_iter& out) const;
+
+  virtual size_t encoded_size() const { return 0; }
+
+  // A hole is a placeholder for sending, not a pattern.
+  virtual bool match(msg_seq_iter& f, const msg_seq_iter& l) const { return false; }
+};
+
+}
+
+#if !defined(MAX_TEMPLATE_HOLES)
+  #define MAX_TEMPLATE_HOLES 10
+#endif
+
+#define TINCH_PP_ADD_HOLE_VALUE(z, n, unused) values[n] = &v ## n;
+
+#define TINCH_PP_TEMPLATE_FILL(z, n, unused)                         \
+  filled fill(BOOST_PP_ENUM_PARAMS(n, const erl::object& v)) const   \
+  {                                                                  \
+    filled::values_type values;                                      \
+    BOOST_PP_REPEAT(n, TINCH_PP_ADD_HOLE_VALUE, unused)              \
+    return filled(*this, values, n);                                 \
+  }
+
+/// A message of a fixed shape with a few varying fields, pre-encoded once:
+///
+/// const message_template metric(make_e_tuple(atom("metric"), e_string("cpu_load"), erl::hole(), erl::hole()));
+///
+/// while(running)
+///   mbox->send(collector, metric.fill(int_(load()), int_(now())));
+///
+/// The constant parts of the shape are encoded upon construction. A send only 
+/// encodes the values filled into the holes (in the order the holes appear in 
+/// the shape) and copies the constant parts around them as they are.
+class message_template : boost::noncopyable
+{
+public:
+  /// The template filled with values for its holes; this is what you send.
+  /// It refers to the template and to the values, which thus have to outlive it 
+  /// (true for the typical case of filling the template in the call to send).
+  class filled : public erl::object
+  {
+  public:
+    typedef boost::array<const erl::object*, MAX_TEMPLATE_HOLES> values_type;
+
+    virtual void serialize(msg_seq_out_iter& out) const;
+
+    virtual size_t encoded_size() const;
+
+    // A filled template is a message to send, not a pattern.
+    virtual bool match(msg_seq_iter& f, const msg_seq_iter& l) const { return false; }
+
+  private:
+    friend class message_template;
+
+    filled(const message_template& a_owner, const values_type& a_values, size_t a_size);
+
+    const message_template& owner;
+    values_type values;
+  };
+
+  explicit message_template(const erl::object& shape);
+
+  BOOST_PP_REPEAT_FROM_TO(1, BOOST_PP_INC(MAX_TEMPLATE_HOLES), TINCH_PP_TEMPLATE_FILL, ~)
+
+  size_t number_of_holes() const { return hole_offsets.size(); }
+
+private:
+  friend class filled;
+
+  msg_seq encoded;
+  std::vector<size_t> hole_offsets;
+};
+
+#undef TINCH_PP_TEMPLATE_FILL
+#undef TINCH_PP_ADD_HOLE_VALUE
+
+}
+
+#endif
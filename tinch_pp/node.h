@@ -26,6 +26,8 @@
 
 #include <boost/shared_ptr.hpp>
 #include <map>
+#include <vector>
+#include <string>
 
 namespace tinch_pp {
 
@@ -41,6 +43,16 @@ class control_msg;
 class link_operation_dispatcher_type;
 typedef boost::shared_ptr<link_operation_dispatcher_type> link_operation_dispatcher_type_ptr;
 
+/// The outcome of node::preconnect for one node.
+struct preconnect_result
+{
+  std::string node_name;
+  bool connected;
+  boost::uint32_t elapsed_ms; // until connected, or until the attempt failed
+};
+
+typedef std::vector<preconnect_result> preconnect_results_type;
+
 /// A node represents one, distributed C++ node connected to the EPMD.
 /// A node is responsible for establishing connections with other 
 /// nodes on the Erlang infrastructure. There are two ways to estblish connections:
@@ -58,6 +70,11 @@ public:
   /// Typically, this is the first function called in a tinch++ application.
   static node_ptr create(const std::string& node_name, const std::string& cookie);
 
+  /// Creates a node that registers at, and looks up other nodes through, EPMD at the 
+  /// given port instead of the default 4369 (e.g. a private epmd_server, see epmd_server.h).
+  /// All nodes in such a cluster have to use the same port.
+  static node_ptr create(const std::string& node_name, const std::string& cookie, port_number_type epmd_port);
+
   virtual ~node();
 
   //node(const std::string& node_name, const std::string& cookie, int incoming_connections_port);
@@ -80,6 +97,37 @@ public:
 
   /// Returns a vector with the names of all nodes connected to this one.
   virtual std::vector<std::string> connected_nodes() const = 0;
+
+  /// Opt-in compression of outgoing messages: payloads larger than the given number 
+  /// of bytes are zlib compressed before sent (same format as term_to_binary(Term, [compressed])).
+  /// Worth it on links where the network, rather than the CPU, limits the throughput.
+  /// A threshold of zero (the default) disables compression.
+  /// Compressed messages from other nodes are always accepted.
+  virtual void set_compression_threshold(size_t payload_size) = 0;
+
+  /// Messages sent to a node we're not yet connected to are queued while the connection 
+  /// is established. This limits the number of bytes queued per node (16 MB by default); 
+  /// a send exceeding the limit throws tinch_pp_exception. In case the connection attempt 
+  /// fails, the queued messages are dropped.
+  virtual void set_max_pending_bytes(size_t bytes) = 0;
+
+  /// As the connection to a node is lost, the links to its processes are broken 
+  /// (reported as tinch_pp::link_broken with reason noconnection) and the node is 
+  /// reconnected in the background. The first attempt is made after initial_delay_ms; 
+  /// each failed attempt doubles the delay, up to max_delay_ms (both jittered).
+  /// The defaults are 100 ms and 30 s. An initial delay of zero disables the reconnects.
+  /// A node is given up after 20 failed attempts in a row (until it's lost again).
+  /// Subscribe to the outcome through mailbox::monitor_nodes.
+  virtual void set_reconnect_backoff(boost::uint32_t initial_delay_ms, boost::uint32_t max_delay_ms) = 0;
+
+  /// Establishes connections to all the given nodes in parallel and blocks until each 
+  /// attempt has completed. A node not connected within 7 seconds (as net_setuptime in Erlang), 
+  /// counted from its EPMD lookup to the end of the handshake, is given up.
+  /// Intended for the start of a service: the connection setup is paid for before 
+  /// the first message to each node. Returns the outcome per node, in the given order.
+  /// With keep_retrying, the nodes that couldn't be connected are retried in the 
+  /// background, as lost nodes are (see set_reconnect_backoff and mailbox::monitor_nodes).
+  virtual preconnect_results_type preconnect(const std::vector<std::string>& nodes, bool keep_retrying = false) = 0;
 };
 
 }
@@ -0,0 +1,196 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef RECEIVE_CLAUSES_H
+#define RECEIVE_CLAUSES_H
+
+#include "erl_object.h"
+#include "matchable.h"
+#include "impl/types.h"
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/preprocessor/arithmetic/inc.hpp>
+#include <boost/preprocessor/repetition/enum_params.hpp>
+#include <boost/preprocessor/repetition/repeat.hpp>
+#include <boost/preprocessor/repetition/repeat_from_to.hpp>
+#include <map>
+#include <vector>
+#include <string>
+
+namespace tinch_pp {
+
+class mailbox;
+
+/// A clause of a receive: a pattern and the handler to invoke once a message 
+/// matches the pattern. The variables bound by the pattern are assigned 
+/// before the handler is invoked.
+class clause
+{
+public:
+  typedef boost::function<void ()> handler_type;
+
+  template<typename Pattern>
+  clause(const Pattern& a_pattern, const handler_type& a_handler)
+    : pattern(new Pattern(a_pattern)),
+      handler(a_handler) {}
+
+  erl::object_ptr pattern;
+  handler_type handler;
+};
+
+namespace detail {
+
+typedef std::vector<size_t> clause_indices;
+
+struct atom_branch
+{
+  std::map<std::string, clause_indices> atoms;
+  clause_indices otherwise;
+};
+
+struct arity_branch
+{
+  std::map<int, atom_branch> arities;
+  atom_branch otherwise;
+};
+
+struct decision_tree
+{
+  std::map<int, arity_branch> tags;
+  arity_branch otherwise;
+};
+
+}
+
+/// The compiled receive_clauses of one call site, compiled as the clauses are first 
+/// constructed there and reused by each later construction:
+///
+/// while(running) {
+///   static compiled_clauses compiled; // one per call site
+///
+///   const receive_clauses on_message(compiled, 
+///                                    clause(make_e_tuple(atom("add"), int_(&n)), add_handler),
+///                                    clause(any(), unexpected_handler));
+///   on_message.receive(*mbox);
+/// }
+///
+/// The decision tree depends on the keys of the patterns only (their type tags, arities 
+/// and leading atoms), not on the variables they bind. A pass with other keys than the 
+/// cached ones (e.g. a leading atom given by a variable) compiles the clauses again; the 
+/// new tree replaces the cached one.
+class compiled_clauses : boost::noncopyable
+{
+public:
+  compiled_clauses();
+
+  /// The number of times the clauses were compiled (one, unless their keys changed).
+  size_t compilations() const;
+
+private:
+  friend class receive_clauses;
+
+  boost::shared_ptr<const detail::decision_tree> tree_for(const std::vector<clause>& clauses);
+
+  boost::shared_ptr<const detail::decision_tree> tree;
+  std::vector<erl::pattern_key> keys;
+  size_t compilations_;
+  mutable boost::mutex tree_mutex;
+};
+
+#if !defined(MAX_RECEIVE_CLAUSES)
+  #define MAX_RECEIVE_CLAUSES 10
+#endif
+
+#define TINCH_PP_ADD_CLAUSE(z, n, unused) clauses.push_back(c ## n);
+
+#define TINCH_PP_RECEIVE_CLAUSES_CTOR(z, n, unused)             \
+  receive_clauses(BOOST_PP_ENUM_PARAMS(n, const clause& c))     \
+  {                                                             \
+    BOOST_PP_REPEAT(n, TINCH_PP_ADD_CLAUSE, unused)             \
+    tree = compile(clauses);                                    \
+  }
+
+#define TINCH_PP_RECEIVE_CLAUSES_CACHED_CTOR(z, n, unused)      \
+  receive_clauses(compiled_clauses& compiled,                   \
+                  BOOST_PP_ENUM_PARAMS(n, const clause& c))     \
+  {                                                             \
+    BOOST_PP_REPEAT(n, TINCH_PP_ADD_CLAUSE, unused)             \
+    tree = compiled.tree_for(clauses);                          \
+  }
+
+/// The equivalent of an Erlang receive with several clauses:
+///
+/// std::string name;
+/// boost::int32_t n = 0;
+///
+/// const receive_clauses on_message(clause(make_e_tuple(atom("add"), int_(&n)), add_handler),
+///                                  clause(make_e_tuple(atom("hello"), atom(&name)), hello_handler),
+///                                  clause(any(), unexpected_handler));
+/// while(running)
+///   on_message.receive(*mbox);
+///
+/// The patterns are compiled once into a decision tree on the type tag, the arity 
+/// and the leading atom of the terms they match. A message is dispatched by a 
+/// single look-up in the tree, after which only the clauses that may match it are 
+/// tried (in the order given). As in Erlang, the first matching clause wins.
+///
+/// The compilation is done upon construction. Construct the receive_clauses once 
+/// per call site (e.g. before the receive loop or as a member of your actor), 
+/// not once per message. Where that's not an option (e.g. the clauses bind 
+/// variables local to the loop), pass a compiled_clauses cache instead.
+class receive_clauses
+{
+public:
+  explicit receive_clauses(const std::vector<clause>& clauses);
+
+  receive_clauses(compiled_clauses& compiled, const std::vector<clause>& clauses);
+
+  BOOST_PP_REPEAT_FROM_TO(1, BOOST_PP_INC(MAX_RECEIVE_CLAUSES), TINCH_PP_RECEIVE_CLAUSES_CTOR, ~)
+
+  BOOST_PP_REPEAT_FROM_TO(1, BOOST_PP_INC(MAX_RECEIVE_CLAUSES), TINCH_PP_RECEIVE_CLAUSES_CACHED_CTOR, ~)
+
+  /// Invokes the handler of the first clause matching the given message.
+  /// Returns false in case no clause matched.
+  bool dispatch(const matchable& msg) const;
+
+  /// Receives one message from the mailbox and dispatches it.
+  bool receive(mailbox& mbox) const;
+
+  /// As above, but throws a tinch_pp::receive_tmo_exception in case no message 
+  /// arrives within the given time.
+  bool receive(mailbox& mbox, time_type_sec tmo) const;
+
+private:
+  static boost::shared_ptr<const detail::decision_tree> compile(const std::vector<clause>& clauses);
+
+  std::vector<clause> clauses;
+  boost::shared_ptr<const detail::decision_tree> tree;
+};
+
+#undef TINCH_PP_RECEIVE_CLAUSES_CACHED_CTOR
+#undef TINCH_PP_RECEIVE_CLAUSES_CTOR
+#undef TINCH_PP_ADD_CLAUSE
+
+}
+
+#endif
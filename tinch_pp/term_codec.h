@@ -0,0 +1,99 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef TERM_CODEC_H
+#define TERM_CODEC_H
+
+#include "erl_object.h"
+#include "matchable.h"
+#include "impl/types.h"
+#include <boost/function.hpp>
+#include <boost/utility.hpp>
+
+namespace tinch_pp {
+
+/// Encodes the given term in the external term format, prefixed by the version 
+/// magic (131), just as erlang:term_to_binary/1 does. Use it to store terms (e.g. 
+/// in files) or to pass them through other channels than the distribution.
+/// A compressed term is only produced if it's actually smaller.
+msg_seq term_to_binary(const erl::object& term, bool compressed = false);
+
+/// Decodes an encoding produced by term_to_binary (here or in Erlang), compressed 
+/// or not. The returned matchable is matched just as a received message.
+/// Throws tinch_pp_exception in case the encoding doesn't start with the version magic, 
+/// or in case a compressed term is corrupt.
+matchable_ptr binary_to_term(const msg_seq& encoded);
+
+/// Receives the encoded bytes of a term_encoder in consecutive chunks.
+typedef boost::function<void (const char* data, size_t size)> chunk_sink_type;
+
+/// Encodes a term piece by piece and passes the encoding on to a sink in chunks. 
+/// Thus, a large term (typically a huge list) never has to be built, or encoded, 
+/// as a whole in memory:
+///
+/// term_encoder encoder(write_to_file);
+///
+/// encoder.begin_tuple(2);
+/// encoder.put(atom("readings"));
+/// encoder.begin_list(number_of_readings);
+///
+/// while(read_next(reading))
+///   encoder.put(int_(reading));
+///
+/// encoder.end_list();
+/// encoder.flush();
+///
+/// The version magic is written upon construction, followed by the pieces in the 
+/// order given. The client is responsible for putting as many elements as told in 
+/// begin_tuple and begin_list. The result is the encoding of term_to_binary.
+class term_encoder : boost::noncopyable
+{
+public:
+  /// The bytes are passed on to the sink once at least chunk_size bytes are encoded.
+  explicit term_encoder(const chunk_sink_type& sink, size_t chunk_size = 64 * 1024);
+
+  /// Encodes a complete term.
+  void put(const erl::object& term);
+
+  /// Starts a tuple. The given number of elements have to follow.
+  void begin_tuple(size_t arity);
+
+  /// Starts a list. The given number of elements have to follow, then end_list.
+  void begin_list(size_t length);
+
+  /// Terminates a list started by begin_list (a proper list, ending in nil).
+  void end_list();
+
+  /// Passes the bytes encoded so far on to the sink.
+  /// Call it once the term is complete; nothing is flushed upon destruction.
+  void flush();
+
+private:
+  void flush_full_chunk();
+
+  chunk_sink_type sink;
+  size_t chunk_size;
+  msg_seq chunk;
+};
+
+}
+
+#endif
@@ -0,0 +1,96 @@
+// Copyright (c) 2010, Adam Petersen <adam@adampetersen.se>. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+//   1. Redistributions of source code must retain the above copyright notice, this list of
+//      conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright notice, this list
+//      of conditions and the following disclaimer in the documentation and/or other materials
+//      provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY Adam Petersen ``AS IS'' AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Adam Petersen OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef TERM_VISITOR_H
+#define TERM_VISITOR_H
+
+#include "matchable.h"
+#include "impl/types.h"
+#include <boost/cstdint.hpp>
+
+namespace tinch_pp {
+
+/// A term_visitor is notified of each term in a message, in the order the terms 
+/// are encoded. It's intended for clients that don't know the shape of their 
+/// messages up front (e.g. loggers or bridges to other formats).
+///
+/// The compound terms are reported as a begin, their elements and an end:
+///
+/// {hello, [1, 2], <<"abc">>}
+///
+/// on_tuple_begin(3), on_atom("hello"), on_list_begin(2), on_int(1), on_int(2), 
+/// on_list_end(), on_binary(<<"abc">>), on_tuple_end()
+///
+/// The tail of an improper list is visited as the last element, before on_list_end.
+/// A string is Erlang's compact encoding of a list of bytes and an empty list has 
+/// no elements. The keys and values of a map are visited alternately.
+///
+/// Atoms and strings are passed as pointers into the message, valid during the 
+/// call only. Binaries are passed as views on the message (see binary_view). 
+/// Thus, nothing is copied; only pids and references are decoded into their 
+/// value types.
+///
+/// Override the notifications you're interested in; the others ignore their terms.
+class term_visitor
+{
+public:
+  virtual ~term_visitor() {}
+
+  virtual void on_int(boost::int32_t value) {}
+
+  virtual void on_float(double value) {}
+
+  virtual void on_atom(const char* name, size_t length) {}
+
+  virtual void on_string(const char* chars, size_t length) {}
+
+  virtual void on_binary(const binary_view& binary) {}
+
+  virtual void on_pid(const e_pid& pid) {}
+
+  virtual void on_reference(const new_reference_type& reference) {}
+
+  virtual void on_tuple_begin(size_t arity) {}
+
+  virtual void on_tuple_end() {}
+
+  virtual void on_list_begin(size_t length) {}
+
+  virtual void on_list_end() {}
+
+  virtual void on_map_begin(size_t arity) {}
+
+  virtual void on_map_end() {}
+
+  /// Terms that tinch++ doesn't decode (e.g. big integers, funs and ports) are 
+  /// passed in their encoded form, including the type tag.
+  virtual void on_unsupported(int type_tag, const char* encoded, size_t length) {}
+};
+
+/// Walks the given message once, notifying the visitor of each term.
+/// Returns false in case the message isn't a well-formed term, or in case its terms 
+/// are nested more than 1000 levels deep. In that case, the visitor has been 
+/// notified of the terms preceding the malformed (or too deeply nested) one.
+bool visit(const matchable& msg, term_visitor& visitor);
+
+}
+
+#endif